@@ -0,0 +1,449 @@
+/***********************************************************************************************
+ * Name:        BenchmarkDr.cpp
+ * Description: This driver compares the hash table's probing policies side by side. For
+ *              each load factor it fills a table of the same number of slots with movies
+ *              from the CSV catalog (repeated under new release years when the catalog is
+ *              too small) and times inserts, successful and failed lookups, and a round of
+ *              deletes followed by reinserts. probes/ins is the average number of slots
+ *              probed past a movie's home slot (16-slot groups for the swiss policy).
+ *              It then times recommendations read from the rating lists against a full
+ *              table scan, before and after a round of rating changes, and batched
+ *              lookups against looped single-key lookups for batches of 16 to 4096 keys.
+ *              Last, it times paging through recommendations with a cursor, page 1 against
+ *              page 20, and against recomputing the whole list up to the requested page,
+ *              and checks that the three policies hand out the same IDs and find the same
+ *              movies through a long run of inserts and deletes near their load limits.
+ *              Usage: Benchmark [csvFile] [slots]
+***********************************************************************************************/
+#include <iostream>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include "Movie.h"
+#include "Viewer.h"
+#include "HashType.h"
+#include "WireFormat.h"
+
+using namespace std;
+typedef chrono::steady_clock Clock;
+
+// Function prototypes
+vector<Movie> makeWorkload(const vector<Movie>& catalog, int count, int yearOffset);
+template <class Table>
+void benchmarkTable(const string& name, const vector<Movie>& movies, const vector<Movie>& misses, int slots);
+double nanosecondsPer(Clock::time_point start, size_t operations);
+void benchmarkRecommendations(const vector<Movie>& catalog);
+void benchmarkPaging(const vector<Movie>& catalog);
+template <class Table>
+void benchmarkBatches(const string& name, const vector<Movie>& catalog, int slots);
+vector<Viewer> makeViewers();
+template <class Table>
+vector<MovieId> churnTable(const vector<Movie>& pool, int capacity, int minStored, int maxStored, bool& consistent);
+bool checkChurn(const vector<Movie>& catalog);
+
+int main(int argc, char* argv[]) {
+    string filename = argc > 1 ? argv[1] : "movieData.csv";
+    // 131071 is a prime of the form 4k+3, so quadratic probing can reach every slot
+    int slots = argc > 2 ? atoi(argv[2]) : 131071;
+
+    vector<Movie> catalog = ReadMovieCSV(filename);
+    if (catalog.empty()) {
+        cerr << "Error: No movies to benchmark with!" << endl;
+        return 1;
+    }
+
+    const double loadFactors[] = { 0.5, 0.75, 0.9 };
+    for (double loadFactor : loadFactors) {
+        int count = static_cast<int>(loadFactor * slots);
+        vector<Movie> movies = makeWorkload(catalog, count, 0);
+        vector<Movie> misses = makeWorkload(catalog, count, 5000);  // same titles, unused years
+
+        cout << "\nLoad factor " << loadFactor << " (" << count << " movies, " << slots << " slots)" << endl;
+        printf("%-12s %7s %12s %12s %12s %12s %12s\n", "policy", "load", "probes/ins",
+            "insert ns", "hit ns", "miss ns", "churn ns");
+        benchmarkTable<HashType>("quadratic", movies, misses, slots);
+        benchmarkTable<RobinHoodHashType>("robin-hood", movies, misses, slots);
+        benchmarkTable<SwissHashType>("swiss", movies, misses, slots);
+    }
+
+    benchmarkRecommendations(catalog);
+    benchmarkBatches<HashType>("quadratic", catalog, slots);
+    benchmarkBatches<SwissHashType>("swiss", catalog, slots);
+    benchmarkPaging(catalog);
+    return checkChurn(catalog) ? 0 : 1;
+}
+
+/**
+ * Builds count distinct movies by cycling through the catalog, moving each
+ * pass to a new range of release years.
+ *
+ * @param catalog The movies read from the CSV file.
+ * @param count The number of movies to build.
+ * @param yearOffset Added to every release year.
+ * @return The movies, in a random order.
+ */
+vector<Movie> makeWorkload(const vector<Movie>& catalog, int count, int yearOffset) {
+    vector<Movie> movies;
+    movies.reserve(count);
+    for (int i = 0; i < count; i++) {
+        const Movie& base = catalog[i % catalog.size()];
+        int pass = i / static_cast<int>(catalog.size());
+        movies.push_back(Movie(base.GetTitle(), base.GetYear() + yearOffset + 10000 * pass, base.GetGenre(),
+            base.GetDirector(), base.GetCast(), base.GetRuntime(), base.GetRating()));
+    }
+    shuffle(movies.begin(), movies.end(), mt19937(7));
+    return movies;
+}
+
+/**
+ * Times the operations of one table type and prints a row of results.
+ *
+ * @param name The probing policy's name.
+ * @param movies The movies to insert.
+ * @param misses Movies that are never inserted.
+ * @param slots The capacity the table is created with.
+ */
+template <class Table>
+void benchmarkTable(const string& name, const vector<Movie>& movies, const vector<Movie>& misses, int slots) {
+    Table table(slots);
+    if (static_cast<int>(movies.size()) > table.GetMaxItems()) {
+        printf("%-12s %7s  past the policy's load limit of %d movies\n", name.c_str(), "-", table.GetMaxItems());
+        return;
+    }
+
+    Clock::time_point start = Clock::now();
+    for (const Movie& movie : movies)
+        table.InsertMovie(movie);
+    double insertTime = nanosecondsPer(start, movies.size());
+
+    bool found;
+    Movie retrieved;
+    long hits = 0;
+    start = Clock::now();
+    for (const Movie& movie : movies) {
+        table.RetrieveMovie(movie, found, retrieved);
+        hits += found;
+    }
+    double hitTime = nanosecondsPer(start, movies.size());
+
+    start = Clock::now();
+    for (const Movie& movie : misses) {
+        table.RetrieveMovie(movie, found, retrieved);
+        hits += found;
+    }
+    double missTime = nanosecondsPer(start, misses.size());
+
+    // Delete and reinsert a quarter of the movies, leaving tombstones or shifted runs behind
+    size_t churn = movies.size() / 4;
+    start = Clock::now();
+    for (size_t i = 0; i < churn; i++)
+        table.DeleteMovie(movies[i]);
+    for (size_t i = 0; i < churn; i++)
+        table.InsertMovie(movies[i]);
+    double churnTime = nanosecondsPer(start, 2 * churn);
+
+    if (hits != static_cast<long>(movies.size()) || table.GetNumItems() != static_cast<int>(movies.size()))
+        cerr << "Error: " << name << " lost movies (" << hits << " hits)!" << endl;
+
+    printf("%-12s %7.3f %12.3f %12.1f %12.1f %12.1f %12.1f\n", name.c_str(),
+        static_cast<double>(table.GetNumItems()) / table.GetNumSlots(),
+        static_cast<double>(table.GetNumCollisions()) / (movies.size() + churn),
+        insertTime, hitTime, missTime, churnTime);
+}
+
+/**
+ * Converts the time since start into nanoseconds per operation.
+ *
+ * @param start When the timed loop began.
+ * @param operations The number of operations the loop ran.
+ * @return The average nanoseconds per operation.
+ */
+double nanosecondsPer(Clock::time_point start, size_t operations) {
+    return chrono::duration<double, nano>(Clock::now() - start).count() / max<size_t>(1, operations);
+}
+
+/**
+ * Times the rating-list recommendations against a scan of the whole table for
+ * a few viewers, checking that both give the same movies.
+ *
+ * @param catalog The movies read from the CSV file.
+ */
+void benchmarkRecommendations(const vector<Movie>& catalog) {
+    const int k = 10;
+    const int rounds = 200;
+    HashType table;
+    for (const Movie& movie : catalog)
+        table.InsertMovie(movie);
+
+    mt19937 random(11);
+    for (int pass = 0; pass < 2; pass++) {
+        if (pass == 1) {
+            // Rerate a few thousand movies so the lists have to reorder
+            uniform_real_distribution<double> rating(0.0, 10.0);
+            for (int i = 0; i < 5000; i++)
+                table.UpdateRating(catalog[random() % catalog.size()], rating(random));
+        }
+
+        cout << "\nTop " << k << " recommendations" << (pass == 0 ? "" : " after 5000 rating changes")
+            << " (" << table.GetNumItems() << " movies)" << endl;
+        printf("%-8s %14s %14s %8s\n", "viewer", "scan us", "lists us", "same");
+        for (const Viewer& viewer : makeViewers()) {
+            vector<Movie> scanned, listed;
+            Clock::time_point start = Clock::now();
+            for (int i = 0; i < rounds; i++)
+                scanned = table.GetRecommendations<PopularityBlendedPolicy>(viewer, ScoringContext(), k);
+            double scanTime = nanosecondsPer(start, rounds) / 1000.0;
+
+            start = Clock::now();
+            for (int i = 0; i < rounds; i++)
+                listed = table.RecommendTopRated(viewer, k);
+            double listTime = nanosecondsPer(start, rounds) / 1000.0;
+
+            printf("%-8s %14.1f %14.2f %8s\n", viewer.GetViewerName().c_str(), scanTime, listTime,
+                scanned == listed ? "yes" : "NO");
+        }
+    }
+}
+
+/**
+ * Builds the family of viewers used by the recommender driver.
+ *
+ * @return The viewers.
+ */
+vector<Viewer> makeViewers() {
+    Viewer mom("Mom", 38);
+    mom.AddPreferredGenre("Romance");
+    mom.AddPreferredGenre("Drama");
+    mom.AddToWatchlist("The Notebook");
+    mom.AddToWatchlist("27 Dresses");
+
+    Viewer dad("Dad", 40);
+    dad.AddPreferredGenre("SciFi");
+    dad.AddFavoriteDirector("Steven Spielberg");
+    dad.AddToWatchlist("Jurassic Park");
+    dad.AddToWatchlist("Inception");
+    dad.AddToWatchlist("E.T. The Extra-Terrestrial");
+
+    Viewer daughter("Cindy", 8);
+    daughter.AddPreferredGenre("Kids&Family");
+    daughter.AddToWatchlist("Finding Nemo");
+    daughter.AddToWatchlist("Toy Story 3");
+    daughter.AddToWatchlist("Frozen");
+
+    Viewer teenageSon("Dan", 15);
+    teenageSon.AddPreferredGenre("Action");
+    teenageSon.AddPreferredGenre("Comedy");
+    teenageSon.AddFavoriteDirector("Joss Whedon");
+    teenageSon.AddToWatchlist("Avengers: Infinity War");
+    teenageSon.AddToWatchlist("The Hunger Games: Catching Fire");
+
+    return { mom, dad, daughter, teenageSon };
+}
+
+/**
+ * Times batched lookups against the same keys looked up one at a time, in a
+ * table three quarters full.
+ *
+ * @param name The probing policy's name.
+ * @param catalog The movies read from the CSV file.
+ * @param slots The capacity the table is created with.
+ */
+template <class Table>
+void benchmarkBatches(const string& name, const vector<Movie>& catalog, int slots) {
+    const int numQueries = 1 << 16;
+    const int rounds = 8;
+    vector<Movie> movies = makeWorkload(catalog, slots * 3 / 4, 0);
+    Table table(slots);
+    for (const Movie& movie : movies)
+        table.InsertMovie(movie);
+
+    mt19937 random(13);
+    vector<Movie> queries;
+    for (int i = 0; i < numQueries; i++)
+        queries.push_back(movies[random() % movies.size()]);
+
+    cout << "\nBatched lookups, " << name << " probing (" << table.GetNumItems()
+        << " movies, million lookups/second)" << endl;
+    printf("%-8s %14s %14s %14s %14s\n", "batch", "ids loop", "ids batch", "movies loop", "movies batch");
+    const int batchSizes[] = { 16, 64, 256, 1024, 4096 };
+    for (int batchSize : batchSizes) {
+        // Slice the queries into batches up front so the timed loops copy nothing
+        vector<vector<Movie>> batches;
+        for (int start = 0; start < numQueries; start += batchSize)
+            batches.push_back(vector<Movie>(queries.begin() + start, queries.begin() + min(numQueries, start + batchSize)));
+
+        long hits = 0;
+        Clock::time_point start = Clock::now();
+        for (int round = 0; round < rounds; round++) {
+            for (const vector<Movie>& batch : batches) {
+                for (const Movie& movie : batch)
+                    hits += table.FindMovieId(movie) != NO_MOVIE;
+            }
+        }
+        double idLoop = 1000.0 / nanosecondsPer(start, static_cast<size_t>(numQueries) * rounds);
+
+        start = Clock::now();
+        for (int round = 0; round < rounds; round++) {
+            for (const vector<Movie>& batch : batches) {
+                for (MovieId id : table.FindMovieIds(batch))
+                    hits += id != NO_MOVIE;
+            }
+        }
+        double idBatch = 1000.0 / nanosecondsPer(start, static_cast<size_t>(numQueries) * rounds);
+
+        bool found;
+        Movie retrieved;
+        start = Clock::now();
+        for (const vector<Movie>& batch : batches) {
+            for (const Movie& movie : batch) {
+                table.RetrieveMovie(movie, found, retrieved);
+                hits += found;
+            }
+        }
+        double movieLoop = 1000.0 / nanosecondsPer(start, numQueries);
+
+        vector<bool> foundMany;
+        vector<Movie> retrievedMany;
+        start = Clock::now();
+        for (const vector<Movie>& batch : batches) {
+            table.RetrieveMany(batch, foundMany, retrievedMany);
+            hits += count(foundMany.begin(), foundMany.end(), true);
+        }
+        double movieBatch = 1000.0 / nanosecondsPer(start, numQueries);
+
+        if (hits != 2L * numQueries * (rounds + 1))
+            cerr << "Error: " << name << " batched lookups missed movies!" << endl;
+        printf("%-8d %14.2f %14.2f %14.2f %14.2f\n", batchSize, idLoop, idBatch, movieLoop, movieBatch);
+    }
+}
+
+/**
+ * Times pages of recommendations fetched with a cursor, the first page against
+ * the twentieth, and the twentieth against recomputing the top 200 and keeping
+ * the last 10, checking that the pages put together match one long list.
+ *
+ * @param catalog The movies read from the CSV file.
+ */
+void benchmarkPaging(const vector<Movie>& catalog) {
+    const int pageSize = 10;
+    const int numPages = 25;
+    const int deepPage = 20;
+    const int rounds = 2000;
+    HashType table;
+    for (const Movie& movie : catalog)
+        table.InsertMovie(movie);
+
+    cout << "\nPages of " << pageSize << " recommendations (" << table.GetNumItems() << " movies)" << endl;
+    printf("%-8s %8s %14s %14s %14s %8s\n", "viewer", "pages", "page 1 us", "page 20 us", "recompute us", "same");
+    for (const Viewer& viewer : makeViewers()) {
+        // Walk every page once, saving the cursor the deep page starts from
+        RecommendationCursor cursor, deepCursor;
+        vector<MovieId> paged;
+        int pages = 0;
+        while (pages < numPages && !cursor.done) {
+            if (pages == deepPage - 1)
+                deepCursor = cursor;
+            vector<MovieId> page = table.NextRecommendationIds(viewer, cursor, pageSize);
+            if (page.empty())
+                break;
+            paged.insert(paged.end(), page.begin(), page.end());
+            pages++;
+        }
+        bool same = paged == table.RecommendTopRatedIds(viewer, numPages * pageSize);
+
+        size_t sink = 0;
+        Clock::time_point start = Clock::now();
+        for (int i = 0; i < rounds; i++) {
+            RecommendationCursor first;
+            sink += table.NextRecommendationIds(viewer, first, pageSize).size();
+        }
+        double firstTime = nanosecondsPer(start, rounds) / 1000.0;
+
+        start = Clock::now();
+        for (int i = 0; i < rounds; i++) {
+            RecommendationCursor deep = deepCursor;
+            sink += table.NextRecommendationIds(viewer, deep, pageSize).size();
+        }
+        double deepTime = nanosecondsPer(start, rounds) / 1000.0;
+
+        // Without a cursor, page 20 means computing pages 1 to 20 again
+        start = Clock::now();
+        for (int i = 0; i < rounds; i++)
+            sink += table.RecommendTopRatedIds(viewer, deepPage * pageSize).size();
+        double recomputeTime = nanosecondsPer(start, rounds) / 1000.0;
+
+        printf("%-8s %8d %14.2f %14.2f %14.2f %8s\n", viewer.GetViewerName().c_str(), pages, firstTime,
+            pages >= deepPage ? deepTime : 0.0, recomputeTime, same && sink > 0 ? "yes" : "NO");
+    }
+}
+
+/**
+ * Runs a fixed sequence of inserts and deletes on one table type, keeping
+ * the number of movies stored near the table's load limit, so deletes
+ * leave tombstones that push it past that limit and force rehashes.
+ *
+ * @param pool The movies inserted and deleted.
+ * @param capacity The capacity the table is created with.
+ * @param minStored Deletes stop at this many movies.
+ * @param maxStored Inserts stop at this many movies.
+ * @param consistent Cleared if an insert fails or a lookup disagrees with
+ *                   which movies are stored.
+ * @return Every ID the table handed out or deleted, then, every 5000
+ *         operations, the ID it finds for each movie of the pool.
+ */
+template <class Table>
+vector<MovieId> churnTable(const vector<Movie>& pool, int capacity, int minStored, int maxStored, bool& consistent) {
+    Table table(capacity);
+    vector<bool> stored(pool.size(), false);
+    vector<MovieId> observed;
+    mt19937 random(11);
+    int numStored = 0;
+    for (int op = 1; op <= 100000; op++) {
+        size_t i = random() % pool.size();
+        if (!stored[i] && numStored < maxStored) {
+            observed.push_back(table.InsertMovie(pool[i]));
+            consistent = consistent && observed.back() != NO_MOVIE;
+            stored[i] = true;
+            numStored++;
+        }
+        else if (stored[i] && numStored > minStored) {
+            observed.push_back(table.FindMovieId(pool[i]));
+            table.DeleteMovie(pool[i]);
+            stored[i] = false;
+            numStored--;
+        }
+        if (op % 5000 == 0) {
+            vector<MovieId> ids = table.FindMovieIds(pool);
+            for (size_t j = 0; j < pool.size(); j++)
+                consistent = consistent && (ids[j] != NO_MOVIE) == stored[j];
+            observed.insert(observed.end(), ids.begin(), ids.end());
+        }
+    }
+    return observed;
+}
+
+/**
+ * Checks that the three probing policies behave the same under churn: the
+ * same IDs handed out and the same movies found, with nothing lost to
+ * tombstones or rehashing. The second run uses 16 slots, where quadratic
+ * probe sequences reach only some of the slots and the table has to grow.
+ *
+ * @param catalog The movies read from the CSV file.
+ * @return True if all three tables agree.
+ */
+bool checkChurn(const vector<Movie>& catalog) {
+    vector<Movie> pool = makeWorkload(catalog, 5000, 0);
+    // 4099 is a prime of the form 4k+3 for quadratic probing; 4096 fills the swiss groups
+    bool consistent = true;
+    vector<MovieId> quadratic = churnTable<HashType>(pool, 4099, 2600, 3000, consistent);
+    bool same = consistent && quadratic == churnTable<RobinHoodHashType>(pool, 4096, 2600, 3000, consistent) &&
+        quadratic == churnTable<SwissHashType>(pool, 4096, 2600, 3000, consistent) && consistent;
+
+    vector<Movie> small(pool.begin(), pool.begin() + 100);
+    quadratic = churnTable<HashType>(small, 16, 8, 12, consistent);
+    same = same && quadratic == churnTable<RobinHoodHashType>(small, 16, 8, 12, consistent) &&
+        quadratic == churnTable<SwissHashType>(small, 16, 8, 12, consistent) && consistent;
+    cout << "\nProbing policies agree under churn: " << (same ? "yes" : "NO") << endl;
+    return same;
+}
@@ -0,0 +1,144 @@
+/***********************************************************************************************
+ * Name:        CoWatchDr.cpp
+ * Description: This driver builds the item-item co-watch graph from a synthetic population
+ *              of viewers and uses it to recommend movies. Each synthetic viewer has a favorite
+ *              genre and watches 5 to 40 movies, most from that genre, skewed toward the
+ *              popular end of the catalog. The driver reports build time on one thread and on
+ *              every core, the graph's size and memory, and Dad's "viewers who watched this
+ *              also watched" recommendations.
+ *              Usage: CoWatch [numViewers] [neighbours] [numThreads]
+***********************************************************************************************/
+#include <iostream>
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <random>
+#include <thread>
+#include "Movie.h"
+#include "Viewer.h"
+#include "HashType.h"
+#include "CoWatchGraph.h"
+#include "WireFormat.h"
+
+using namespace std;
+typedef chrono::steady_clock Clock;
+
+// Function prototypes
+vector<vector<MovieId>> makeHistories(const HashType& movieTable, int numViewers);
+double secondsSince(Clock::time_point start);
+
+int main(int argc, char* argv[]) {
+    int numViewers = argc > 1 ? atoi(argv[1]) : 1000000;
+    int neighbours = argc > 2 ? atoi(argv[2]) : COWATCH_NEIGHBOURS;
+    int numThreads = argc > 3 ? atoi(argv[3]) : static_cast<int>(max(1u, thread::hardware_concurrency()));
+
+    HashType movieTable;
+    for (const Movie& movie : ReadMovieCSV("movieData.csv"))
+        movieTable.InsertMovie(movie);
+    MovieId numMovies = static_cast<MovieId>(movieTable.GetNumItems());
+
+    Clock::time_point start = Clock::now();
+    vector<vector<MovieId>> histories = makeHistories(movieTable, numViewers);
+    size_t numWatches = 0;
+    for (const vector<MovieId>& history : histories)
+        numWatches += history.size();
+    cout << "Generated " << numViewers << " viewers with " << numWatches << " watches in "
+        << secondsSince(start) << " seconds (" << numWatches * sizeof(MovieId) / (1 << 20) << " MB of history)." << endl;
+
+    CoWatchGraph graph;
+    start = Clock::now();
+    graph.Build(histories, numMovies, neighbours, 1);
+    double oneThread = secondsSince(start);
+    cout << "Built on 1 thread in " << oneThread << " seconds." << endl;
+    if (numThreads > 1) {
+        start = Clock::now();
+        graph.Build(histories, numMovies, neighbours, numThreads);
+        double allThreads = secondsSince(start);
+        cout << "Built on " << numThreads << " threads in " << allThreads << " seconds ("
+            << oneThread / allThreads << "x)." << endl;
+    }
+    cout << "Graph: " << graph.GetNumEdges() << " edges, " << graph.GetMemoryBytes() / 1024 << " KB in CSR form; "
+        << "the build held " << graph.GetBuildBytes() / (1 << 20) << " MB besides the histories." << endl;
+
+    // Dad's watchlist, resolved to movie IDs
+    Viewer dad("Dad", 40);
+    dad.AddPreferredGenre("SciFi");
+    dad.AddFavoriteDirector("Steven Spielberg");
+    for (const char* title : { "Jurassic Park", "Inception", "E.T. The Extra-Terrestrial" }) {
+        dad.AddToWatchlist(title);
+        dad.AddWatchedMovie(movieTable.ResolveTitle(title));
+    }
+
+    MovieId jurassicPark = movieTable.ResolveTitle("Jurassic Park");
+    cout << "\nViewers who watched Jurassic Park also watched:" << endl;
+    vector<ScoredMovie> similar = graph.GetNeighbours(jurassicPark);
+    for (size_t i = 0; i < similar.size() && i < 5; i++) {
+        const Movie& movie = movieTable.GetMovie(similar[i].first);
+        cout << "  " << movie.GetTitle() << " (" << movie.GetYear() << ", " << movie.GetGenre()
+            << ") weight " << similar[i].second << endl;
+    }
+
+    start = Clock::now();
+    vector<ScoredMovie> scored = graph.Recommend(dad, NUM_RECOMMENDATIONS);
+    double queryTime = secondsSince(start);
+    vector<Movie> recommended;
+    for (const ScoredMovie& movie : scored)
+        recommended.push_back(movieTable.GetMovie(movie.first));
+    cout << "\nCo-watch recommendations (" << queryTime * 1e6 << " us):" << endl;
+    movieTable.PrintRecommendations(dad, recommended);
+    return 0;
+}
+
+/**
+ * Builds synthetic watch histories. Each viewer picks a favorite genre in
+ * proportion to the genre's size and draws 80% of their movies from it; the
+ * rest come from the whole catalog. Draws favor the first movies of a list,
+ * so every genre has a few popular titles and a long tail.
+ *
+ * @param movieTable The catalog viewers watch from.
+ * @param numViewers The number of viewers to build.
+ * @return One history of distinct movie IDs per viewer.
+ */
+vector<vector<MovieId>> makeHistories(const HashType& movieTable, int numViewers) {
+    map<string, vector<MovieId>> byGenre;
+    vector<MovieId> all;
+    for (MovieId id = 0; id < static_cast<MovieId>(movieTable.GetNumItems()); id++) {
+        byGenre[movieTable.GetMovie(id).GetGenre()].push_back(id);
+        all.push_back(id);
+    }
+    vector<const vector<MovieId>*> genres;
+    vector<double> genreWeights;
+    for (const pair<const string, vector<MovieId>>& genre : byGenre) {
+        genres.push_back(&genre.second);
+        genreWeights.push_back(static_cast<double>(genre.second.size()));
+    }
+
+    mt19937 random(2025);
+    discrete_distribution<int> pickGenre(genreWeights.begin(), genreWeights.end());
+    uniform_real_distribution<double> uniform(0.0, 1.0);
+    auto skewed = [&](const vector<MovieId>& list) {
+        double u = uniform(random);
+        return list[static_cast<size_t>(u * u * u * list.size())];
+    };
+
+    vector<vector<MovieId>> histories(numViewers);
+    for (vector<MovieId>& history : histories) {
+        const vector<MovieId>& favorite = *genres[pickGenre(random)];
+        int length = 5 + static_cast<int>(random() % 36);
+        for (int i = 0; i < length; i++)
+            history.push_back(uniform(random) < 0.8 ? skewed(favorite) : skewed(all));
+        sort(history.begin(), history.end());
+        history.erase(unique(history.begin(), history.end()), history.end());
+    }
+    return histories;
+}
+
+/**
+ * Measures the time since start.
+ *
+ * @param start The starting time.
+ * @return The seconds elapsed.
+ */
+double secondsSince(Clock::time_point start) {
+    return chrono::duration<double>(Clock::now() - start).count();
+}
@@ -0,0 +1,309 @@
+/**
+ * CoWatchGraph.h
+ * The CoWatchGraph class answers "viewers who watched X also watched Y". It
+ * is built from viewer watch histories (lists of MovieIds) into a sparse
+ * item-item graph: each movie keeps its M strongest neighbours, weighted by
+ * the cosine of the two movies' viewer sets,
+ *   co-watches(a, b) / sqrt(viewers(a) * viewers(b)),
+ * so a pair of blockbusters does not outrank a pair of niche movies that are
+ * nearly always watched together. The graph is stored in compressed sparse
+ * row (CSR) form: one offset per movie into flat neighbour and weight arrays.
+ *
+ * Building runs on several threads in three steps:
+ *   1. Each thread counts the movies in its share of the viewers; the counts
+ *      are merged into the offsets of a movie -> viewers index, which every
+ *      thread then fills for its own viewers without locking.
+ *   2. Threads take movies in small batches and count co-watches for each
+ *      one into a thread-local dense array, keeping the top M neighbours.
+ *   3. The per-movie rows are packed into the CSR arrays.
+ **/
+
+#ifndef COWATCHGRAPH_H
+#define COWATCHGRAPH_H
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "Movie.h"
+#include "Viewer.h"
+
+using namespace std;
+
+const int COWATCH_NEIGHBOURS = 50;   // default neighbours kept per movie
+const int COWATCH_MIN_COUNT = 2;     // default co-watches needed to keep a pair
+const int COWATCH_BATCH = 64;        // movies a build thread takes at a time
+
+typedef pair<MovieId, float> ScoredMovie;  // movie ID and its weight or score
+
+class CoWatchGraph {
+public:
+    // Class constructor, for an empty graph
+    CoWatchGraph();
+
+    void Build(const vector<vector<MovieId>>& histories, MovieId numMovies, int neighbours = COWATCH_NEIGHBOURS,
+        int numThreads = 0, int minCount = COWATCH_MIN_COUNT);
+    // Function: Builds the graph from viewer watch histories.
+    // Pre:  No history repeats a movie. IDs at or above numMovies are ignored.
+    // Post: Every movie has at most neighbours neighbours, each co-watched by
+    //       at least minCount viewers, strongest first. numThreads = 0 uses
+    //       every core.
+
+    MovieId GetNumMovies() const;
+    // Function: Gets the size of the movie ID range the graph covers.
+
+    size_t GetNumEdges() const;
+    // Function: Gets the number of stored (movie, neighbour) pairs.
+
+    size_t GetMemoryBytes() const;
+    // Function: Gets the memory held by the CSR arrays.
+
+    size_t GetBuildBytes() const;
+    // Function: Gets the most memory the last Build held at once, besides
+    //           the histories and the finished graph.
+
+    vector<ScoredMovie> GetNeighbours(MovieId id) const;
+    // Function: Gets the movies most often watched together with a movie.
+    // Post: Function value = neighbours with their weights, strongest first.
+
+    vector<ScoredMovie> ScoreCandidates(vector<MovieId> history, int k) const;
+    // Function: Scores unwatched movies against a watch history.
+    // Post: Function value = up to k movies not in history, ordered by the sum
+    //       of their weights to the movies in history (highest first).
+
+    vector<ScoredMovie> Recommend(const Viewer& viewer, int k) const;
+    // Function: Scores unwatched movies against a Viewer's watched movie IDs.
+    // Post: Same as ScoreCandidates for the Viewer's watched movies.
+
+private:
+    MovieId numMovies;              // IDs covered are [0, numMovies)
+    vector<uint32_t> rowStart;      // numMovies + 1 offsets into the arrays below
+    vector<MovieId> neighbourIds;   // neighbours of every movie, row after row
+    vector<float> weights;          // weight of each neighbour
+    size_t buildBytes;              // transient memory of the last build
+};
+
+CoWatchGraph::CoWatchGraph() : numMovies(0), rowStart(1, 0), buildBytes(0) {
+}
+
+void CoWatchGraph::Build(const vector<vector<MovieId>>& histories, MovieId numMovies, int neighbours,
+    int numThreads, int minCount) {
+    // Function: Builds the graph from viewer watch histories.
+    // Pre:  No history repeats a movie. IDs at or above numMovies are ignored.
+    // Post: Every movie has at most neighbours neighbours, each co-watched by
+    //       at least minCount viewers, strongest first. numThreads = 0 uses
+    //       every core.
+    if (numThreads <= 0)
+        numThreads = max(1u, thread::hardware_concurrency());
+    this->numMovies = numMovies;
+    size_t numViewers = histories.size();
+
+    // 1. Count each thread's share of the viewers per movie, then merge the
+    //    counts into the offsets of the movie -> viewers index
+    vector<vector<uint32_t>> localCounts(numThreads, vector<uint32_t>(numMovies, 0));
+    auto viewerRange = [&](int t) {
+        return make_pair(numViewers * t / numThreads, numViewers * (t + 1) / numThreads);
+    };
+    vector<thread> threads;
+    for (int t = 0; t < numThreads; t++) {
+        threads.push_back(thread([&, t]() {
+            pair<size_t, size_t> range = viewerRange(t);
+            for (size_t v = range.first; v < range.second; v++) {
+                for (MovieId id : histories[v]) {
+                    if (id < numMovies)
+                        localCounts[t][id]++;
+                }
+            }
+        }));
+    }
+    for (thread& worker : threads)
+        worker.join();
+    threads.clear();
+
+    vector<uint64_t> viewerStart(static_cast<size_t>(numMovies) + 1, 0);
+    for (MovieId id = 0; id < numMovies; id++) {
+        uint64_t position = viewerStart[id];
+        for (int t = 0; t < numThreads; t++) {
+            uint32_t count = localCounts[t][id];
+            localCounts[t][id] = static_cast<uint32_t>(position - viewerStart[id]);  // thread's offset in the row
+            position += count;
+        }
+        viewerStart[id + 1] = position;
+    }
+
+    // The histories are also copied into one flat array, so reading a viewer's
+    // history in step 2 is one cache miss instead of two
+    vector<uint64_t> historyStart(numViewers + 1, 0);
+    for (size_t v = 0; v < numViewers; v++)
+        historyStart[v + 1] = historyStart[v] + histories[v].size();
+    vector<MovieId> historyIds(historyStart[numViewers]);
+    vector<uint32_t> viewersOf(viewerStart[numMovies]);
+    for (int t = 0; t < numThreads; t++) {
+        threads.push_back(thread([&, t]() {
+            pair<size_t, size_t> range = viewerRange(t);
+            for (size_t v = range.first; v < range.second; v++) {
+                copy(histories[v].begin(), histories[v].end(), historyIds.begin() + historyStart[v]);
+                for (MovieId id : histories[v]) {
+                    if (id < numMovies)
+                        viewersOf[viewerStart[id] + localCounts[t][id]++] = static_cast<uint32_t>(v);
+                }
+            }
+        }));
+    }
+    for (thread& worker : threads)
+        worker.join();
+    threads.clear();
+    localCounts.clear();
+
+    // 2. Count co-watches one movie at a time and keep the strongest neighbours.
+    //    Popular movies cost far more than rare ones, so threads take small
+    //    batches from a shared counter instead of fixed ranges
+    vector<float> inverseRoot(numMovies, 0.0f);  // 1 / sqrt(viewers) of each movie
+    for (MovieId id = 0; id < numMovies; id++) {
+        if (viewerStart[id + 1] > viewerStart[id])
+            inverseRoot[id] = static_cast<float>(1.0 / sqrt(static_cast<double>(viewerStart[id + 1] - viewerStart[id])));
+    }
+    vector<vector<ScoredMovie>> rows(numMovies);
+    atomic<MovieId> nextMovie(0);
+    for (int t = 0; t < numThreads; t++) {
+        threads.push_back(thread([&]() {
+            const MovieId range = numMovies;  // a local, so stores to coWatches cannot alias it
+            const uint32_t threshold = static_cast<uint32_t>(max(1, minCount));
+            vector<uint32_t> coWatches(range, 0);  // thread-local accumulator
+            vector<MovieId> touched;
+            vector<ScoredMovie> candidates;
+            while (true) {
+                MovieId first = nextMovie.fetch_add(COWATCH_BATCH);
+                if (first >= range)
+                    break;
+                MovieId last = min(range, first + COWATCH_BATCH);
+                for (MovieId a = first; a < last; a++) {
+                    uint32_t* counts = coWatches.data();
+                    for (uint64_t i = viewerStart[a]; i < viewerStart[a + 1]; i++) {
+                        uint32_t viewer = viewersOf[i];
+                        const MovieId* watched = historyIds.data() + historyStart[viewer];
+                        const MovieId* end = historyIds.data() + historyStart[viewer + 1];
+                        for (; watched != end; watched++) {
+                            MovieId b = *watched;
+                            if (b < range && counts[b]++ == 0)
+                                touched.push_back(b);
+                        }
+                    }
+
+                    // a is in every one of its viewers' histories; drop it here
+                    // instead of testing for it on every co-watch
+                    candidates.clear();
+                    counts[a] = 0;
+                    float rootA = inverseRoot[a];
+                    for (MovieId b : touched) {
+                        if (counts[b] >= threshold)
+                            candidates.push_back(ScoredMovie(b, counts[b] * rootA * inverseRoot[b]));
+                        counts[b] = 0;
+                    }
+                    touched.clear();
+
+                    // Strongest first, lower ID on ties so the build is deterministic
+                    auto stronger = [](const ScoredMovie& x, const ScoredMovie& y) {
+                        return x.second != y.second ? x.second > y.second : x.first < y.first;
+                    };
+                    size_t keep = min(candidates.size(), static_cast<size_t>(max(0, neighbours)));
+                    partial_sort(candidates.begin(), candidates.begin() + keep, candidates.end(), stronger);
+                    rows[a].assign(candidates.begin(), candidates.begin() + keep);
+                }
+            }
+        }));
+    }
+    for (thread& worker : threads)
+        worker.join();
+
+    size_t rowBytes = 0;
+    for (const vector<ScoredMovie>& row : rows)
+        rowBytes += row.capacity() * sizeof(ScoredMovie) + sizeof(row);
+    // The movie -> viewers index, the flat histories, the rows, the inverse roots,
+    // and one dense counter array per thread
+    buildBytes = viewersOf.size() * sizeof(uint32_t) + viewerStart.size() * sizeof(uint64_t) +
+        historyIds.size() * sizeof(MovieId) + historyStart.size() * sizeof(uint64_t) + rowBytes +
+        static_cast<size_t>(numThreads) * numMovies * (sizeof(uint32_t) + sizeof(float));
+
+    // 3. Pack the rows into the CSR arrays
+    rowStart.assign(static_cast<size_t>(numMovies) + 1, 0);
+    for (MovieId id = 0; id < numMovies; id++)
+        rowStart[id + 1] = rowStart[id] + static_cast<uint32_t>(rows[id].size());
+    neighbourIds.resize(rowStart[numMovies]);
+    weights.resize(rowStart[numMovies]);
+    for (MovieId id = 0; id < numMovies; id++) {
+        for (size_t i = 0; i < rows[id].size(); i++) {
+            neighbourIds[rowStart[id] + i] = rows[id][i].first;
+            weights[rowStart[id] + i] = rows[id][i].second;
+        }
+    }
+}
+
+MovieId CoWatchGraph::GetNumMovies() const {
+    // Function: Gets the size of the movie ID range the graph covers.
+    return numMovies;
+}
+
+size_t CoWatchGraph::GetNumEdges() const {
+    // Function: Gets the number of stored (movie, neighbour) pairs.
+    return neighbourIds.size();
+}
+
+size_t CoWatchGraph::GetMemoryBytes() const {
+    // Function: Gets the memory held by the CSR arrays.
+    return rowStart.size() * sizeof(uint32_t) + neighbourIds.size() * sizeof(MovieId) + weights.size() * sizeof(float);
+}
+
+size_t CoWatchGraph::GetBuildBytes() const {
+    // Function: Gets the most memory the last Build held at once, besides
+    //           the histories and the finished graph.
+    return buildBytes;
+}
+
+vector<ScoredMovie> CoWatchGraph::GetNeighbours(MovieId id) const {
+    // Function: Gets the movies most often watched together with a movie.
+    // Post: Function value = neighbours with their weights, strongest first.
+    vector<ScoredMovie> neighbours;
+    if (id >= numMovies)
+        return neighbours;
+    for (uint32_t i = rowStart[id]; i < rowStart[id + 1]; i++)
+        neighbours.push_back(ScoredMovie(neighbourIds[i], weights[i]));
+    return neighbours;
+}
+
+vector<ScoredMovie> CoWatchGraph::ScoreCandidates(vector<MovieId> history, int k) const {
+    // Function: Scores unwatched movies against a watch history.
+    // Post: Function value = up to k movies not in history, ordered by the sum
+    //       of their weights to the movies in history (highest first).
+    sort(history.begin(), history.end());
+    unordered_map<MovieId, float> scores;
+    for (MovieId watched : history) {
+        if (watched >= numMovies)
+            continue;
+        for (uint32_t i = rowStart[watched]; i < rowStart[watched + 1]; i++)
+            scores[neighbourIds[i]] += weights[i];
+    }
+
+    vector<ScoredMovie> ranked;
+    for (const pair<const MovieId, float>& score : scores) {
+        if (!binary_search(history.begin(), history.end(), score.first))
+            ranked.push_back(score);
+    }
+    auto higher = [](const ScoredMovie& x, const ScoredMovie& y) {
+        return x.second != y.second ? x.second > y.second : x.first < y.first;
+    };
+    size_t keep = min(ranked.size(), static_cast<size_t>(max(0, k)));
+    partial_sort(ranked.begin(), ranked.begin() + keep, ranked.end(), higher);
+    ranked.resize(keep);
+    return ranked;
+}
+
+vector<ScoredMovie> CoWatchGraph::Recommend(const Viewer& viewer, int k) const {
+    // Function: Scores unwatched movies against a Viewer's watched movie IDs.
+    // Post: Same as ScoreCandidates for the Viewer's watched movies.
+    return ScoreCandidates(viewer.GetWatchedMovies(), k);
+}
+#endif
@@ -0,0 +1,466 @@
+/**
+ * DurableCatalog.h
+ * The DurableCatalog class wraps a HashType so that catalog mutations survive
+ * a crash. Every InsertMovie, DeleteMovie and UpdateRating is recorded in a
+ * write-ahead log ("<path>.wal") and applied to the table under one lock, so
+ * the log holds the mutations in the order they were applied, and the table
+ * never shows a mutation the log refused. Deletes and updates are checked,
+ * logged and only then applied; an insert is applied first, since only the
+ * table knows whether it has room, and undone if the log refuses it. A
+ * mutation can wait until its record is on disk or return at once and leave
+ * it to the next group commit.
+ *
+ * Checkpoint writes every live movie, with its ID, and the next ID to give
+ * to a snapshot ("<path>.snapshot", written to a temporary file and renamed
+ * into place) and then compacts the log down to the records the snapshot
+ * does not cover. A mutation that
+ * finds the log over checkpointBytes starts a checkpoint on a background
+ * thread, so it does not wait for the snapshot to be written. Recovery loads the
+ * snapshot and replays only the log records after its LSN, so it reads at
+ * most one catalog and one log tail no matter how long the catalog has been
+ * running. Logged inserts carry their IDs too, so every movie comes back
+ * under the ID it had, and a deleted movie's ID is not given out again.
+ **/
+
+#ifndef DURABLECATALOG_H
+#define DURABLECATALOG_H
+
+#include <atomic>
+#include <cstdio>
+#include <iostream>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "HashType.h"
+#include "WireFormat.h"
+#include "WriteAheadLog.h"
+
+using namespace std;
+
+const uint32_t SNAPSHOT_MAGIC = 0x50414E53;            // "SNAP"
+const size_t DEFAULT_CHECKPOINT_BYTES = 64 << 20;      // log size that triggers a checkpoint
+const char SNAPSHOT_NEXT_ID = 'N';  // snapshot record; payload: the ID the next inserted movie gets
+
+string EncodeCatalogMovie(MovieId id, const Movie& movie) {
+    // Function: Encodes a movie with its ID, the payload of an insert record.
+    // Post: Function value = the ID and the encoded movie separated by FIELD_SEPARATOR.
+    return to_string(id) + FIELD_SEPARATOR + EncodeMovie(movie);
+}
+
+bool DecodeCatalogMovie(const string& payload, MovieId& id, Movie& movie) {
+    // Function: Decodes a payload written by EncodeCatalogMovie.
+    // Post: Returns true and sets id and movie if payload is well formed.
+    //       Otherwise, returns false.
+    size_t tab = payload.find(FIELD_SEPARATOR);
+    if (tab == string::npos || !DecodeMovie(payload.substr(tab + 1), movie))
+        return false;
+    try {
+        size_t used;
+        unsigned long value = stoul(payload.substr(0, tab), &used);
+        if (used != tab || value >= NO_MOVIE)
+            return false;
+        id = static_cast<MovieId>(value);
+    }
+    catch (const exception&) {
+        return false;
+    }
+    return true;
+}
+
+class DurableCatalog {
+public:
+    // Class constructor, for a table of the given capacity
+    DurableCatalog(int capacity = MAX_ITEMS);
+
+    // Class destructor, makes every mutation durable and closes the log
+    ~DurableCatalog();
+
+    bool Open(const string& path);
+    // Function: Recovers the catalog stored at path, or starts an empty one.
+    // Post: Returns true if the snapshot (if any) was loaded and the log
+    //       replayed. Otherwise, prints an error and returns false.
+
+    void Close();
+    // Function: Waits for a background checkpoint, makes every mutation
+    //           durable and closes the log.
+    // Post: The catalog is empty and closed.
+
+    uint64_t InsertMovie(const Movie& movie, bool wait = true);
+    // Function: Adds a movie and records it in the log.
+    // Pre:  Catalog is open.
+    // Post: Function value = the mutation's LSN, or 0 if the table refused
+    //       the movie or the log failed. With wait, the mutation is on disk
+    //       when the function returns.
+
+    uint64_t DeleteMovie(const Movie& movie, bool wait = true);
+    // Function: Deletes the movie whose key matches movie's key and records it.
+    // Pre:  Catalog is open.
+    // Post: Function value = the mutation's LSN, or 0 if no movie matched or
+    //       the log failed. With wait, the mutation is on disk on return.
+
+    uint64_t UpdateRating(const Movie& movie, double rating, bool wait = true);
+    // Function: Changes the rating of the movie whose key matches movie's key
+    //           and records it.
+    // Pre:  Catalog is open.
+    // Post: Function value = the mutation's LSN, or 0 if no movie matched or
+    //       the log failed. With wait, the mutation is on disk on return.
+
+    bool Sync();
+    // Function: Waits until every mutation so far is on disk.
+    // Post: Returns true once they are; false if the log failed.
+
+    bool Checkpoint();
+    // Function: Writes a snapshot of the catalog and compacts the log.
+    // Post: Returns true if the snapshot is durable and the log holds only
+    //       the mutations made after it. Mutations may run meanwhile; other
+    //       checkpoints wait for this one.
+
+    void SetCheckpointBytes(size_t bytes);
+    // Function: Sets the log size at which a mutation triggers a checkpoint.
+    // Post: 0 turns automatic checkpoints off.
+
+    void RetrieveMovie(const Movie& searchMovie, bool& found, Movie& retrievedMovie) const;
+    // Function: Retrieves the movie whose key matches searchMovie's key.
+    // Post: Same as HashType::RetrieveMovie.
+
+    vector<Movie> GetMovies() const;
+    // Function: Gets every movie in the catalog, in ID order.
+
+    MovieId FindMovieId(const Movie& searchMovie) const;
+    // Function: Finds the ID of the movie whose key matches searchMovie's key.
+    // Post: Same as HashType::FindMovieId; IDs survive recovery.
+
+    vector<Movie> RecommendTopRated(const Viewer& viewer, int k) const;
+    // Function: Recommends up to k movies for a Viewer from the rating lists.
+    // Post: Same as HashType::RecommendTopRated.
+
+    int GetNumItems() const;
+    // Function: Determines the number of movies in the catalog.
+
+    size_t GetSnapshotMovies() const;
+    // Function: Gets the number of movies the last Open loaded from the snapshot.
+
+    size_t GetReplayedRecords() const;
+    // Function: Gets the number of log records the last Open replayed.
+
+    WriteAheadLog& GetLog();
+    // Function: Gets the catalog's log, for its statistics and group window.
+
+private:
+    bool Replay(const WalRecord& record);
+    // Function: Applies a logged mutation to the table.
+    // Post: Returns true if the record was well formed and applied.
+
+    uint64_t Finish(uint64_t lsn, bool wait);
+    // Function: Completes a mutation after it has been logged.
+    // Post: Starts a background checkpoint when the log has outgrown
+    //       checkpointBytes and none is running.
+    //       Function value = lsn, or 0 if it should be durable and is not.
+
+    string path;                    // catalog path; files are path + ".wal" and ".snapshot"
+    HashType table;                 // the catalog in memory
+    mutable shared_mutex tableMutex;  // mutations exclusive, reads shared
+    WriteAheadLog log;              // mutations since the snapshot
+    atomic<size_t> checkpointBytes; // log size that triggers a checkpoint (0 = never)
+    atomic<bool> checkpointing;     // a background checkpoint is running
+    thread checkpointer;            // the latest background checkpoint
+    mutex checkpointMutex;          // one checkpoint writes the snapshot at a time
+    size_t snapshotMovies;          // movies loaded from the snapshot by Open
+    size_t replayedRecords;         // log records replayed by Open
+};
+
+// Class constructor
+DurableCatalog::DurableCatalog(int capacity) : table(capacity), checkpointBytes(DEFAULT_CHECKPOINT_BYTES),
+    checkpointing(false) {
+    snapshotMovies = replayedRecords = 0;
+}
+
+// Class destructor
+DurableCatalog::~DurableCatalog() {
+    Close();
+}
+
+bool DurableCatalog::Open(const string& catalogPath) {
+    // Function: Recovers the catalog stored at path, or starts an empty one.
+    // Post: Returns true if the snapshot (if any) was loaded and the log
+    //       replayed. Otherwise, prints an error and returns false.
+    Close();
+    path = catalogPath;
+
+    // A snapshot is renamed into place only once it is complete, so any
+    // damage in it is reported rather than skipped
+    uint64_t snapshotLsn = 0;
+    int fd = open((path + ".snapshot").c_str(), O_RDONLY);
+    if (fd >= 0) {
+        struct stat info;
+        string bytes;
+        vector<WalRecord> movies;
+        bool loaded = fstat(fd, &info) == 0 && ReadFileBytes(fd, 0, static_cast<size_t>(info.st_size), bytes) &&
+            DecodeWalHeader(bytes, SNAPSHOT_MAGIC, snapshotLsn) &&
+            ParseWalRecords(bytes, WAL_HEADER, movies) == bytes.size();
+        close(fd);
+        for (size_t i = 0; loaded && i < movies.size(); i++) {
+            loaded = Replay(movies[i]);
+            snapshotMovies += movies[i].op == WAL_INSERT;
+        }
+        if (!loaded) {
+            cerr << "Error: The snapshot " << path << ".snapshot is damaged!" << endl;
+            Close();
+            return false;
+        }
+    }
+
+    // Replay the log tail; records the snapshot already covers are skipped
+    vector<WalRecord> records;
+    if (!log.Open(path + ".wal", records, snapshotLsn)) {
+        Close();
+        return false;
+    }
+    for (const WalRecord& record : records) {
+        if (record.lsn <= snapshotLsn)
+            continue;
+        if (!Replay(record))
+            cerr << "Error: Could not replay log record " << record.lsn << " of " << path << ".wal" << endl;
+        replayedRecords++;
+    }
+    return true;
+}
+
+void DurableCatalog::Close() {
+    // Function: Waits for a background checkpoint, makes every mutation
+    //           durable and closes the log.
+    // Post: The catalog is empty and closed.
+    if (checkpointer.joinable())
+        checkpointer.join();
+    log.Close();
+    unique_lock<shared_mutex> lock(tableMutex);
+    table.MakeEmpty();
+    snapshotMovies = replayedRecords = 0;
+}
+
+bool DurableCatalog::Replay(const WalRecord& record) {
+    // Function: Applies a logged mutation to the table.
+    // Post: Returns true if the record was well formed and applied.
+    Movie movie;
+    if (record.op == WAL_INSERT) {
+        // The movie gets back the ID it was logged with
+        MovieId id;
+        return DecodeCatalogMovie(record.payload, id, movie) && table.RestoreMovie(movie, id) != NO_MOVIE;
+    }
+    else if (record.op == SNAPSHOT_NEXT_ID) {
+        try {
+            table.ReserveIds(static_cast<MovieId>(stoul(record.payload)));
+        }
+        catch (const exception&) {
+            return false;
+        }
+        return true;
+    }
+    else if (record.op == WAL_DELETE) {
+        if (!DecodeMovie(record.payload, movie) || table.FindMovieId(movie) == NO_MOVIE)
+            return false;
+        table.DeleteMovie(movie);
+        return true;
+    }
+    else if (record.op == WAL_UPDATE) {
+        size_t tab = record.payload.rfind(FIELD_SEPARATOR);
+        if (tab == string::npos || !DecodeMovie(record.payload.substr(0, tab), movie) ||
+            table.FindMovieId(movie) == NO_MOVIE)
+            return false;
+        try {
+            table.UpdateRating(movie, stod(record.payload.substr(tab + 1)));
+        }
+        catch (const exception&) {
+            return false;
+        }
+        return true;
+    }
+    return false;
+}
+
+uint64_t DurableCatalog::InsertMovie(const Movie& movie, bool wait) {
+    // Function: Adds a movie and records it in the log.
+    // Pre:  Catalog is open.
+    // Post: Function value = the mutation's LSN, or 0 if the table refused
+    //       the movie or the log failed. With wait, the mutation is on disk
+    //       when the function returns.
+    uint64_t lsn;
+    {
+        unique_lock<shared_mutex> lock(tableMutex);
+        MovieId id = table.InsertMovie(movie);
+        if (id == NO_MOVIE)
+            return 0;
+        lsn = log.Append(WAL_INSERT, EncodeCatalogMovie(id, movie));
+        if (lsn == 0)
+            table.DeleteMovieId(id);  // the log refused it; its ID is left unused
+    }
+    return Finish(lsn, wait);
+}
+
+uint64_t DurableCatalog::DeleteMovie(const Movie& movie, bool wait) {
+    // Function: Deletes the movie whose key matches movie's key and records it.
+    // Pre:  Catalog is open.
+    // Post: Function value = the mutation's LSN, or 0 if no movie matched or
+    //       the log failed. With wait, the mutation is on disk on return.
+    uint64_t lsn;
+    {
+        unique_lock<shared_mutex> lock(tableMutex);
+        if (table.FindMovieId(movie) == NO_MOVIE)
+            return 0;
+        lsn = log.Append(WAL_DELETE, EncodeMovie(movie));
+        if (lsn != 0)
+            table.DeleteMovie(movie);
+    }
+    return Finish(lsn, wait);
+}
+
+uint64_t DurableCatalog::UpdateRating(const Movie& movie, double rating, bool wait) {
+    // Function: Changes the rating of the movie whose key matches movie's key
+    //           and records it.
+    // Pre:  Catalog is open.
+    // Post: Function value = the mutation's LSN, or 0 if no movie matched or
+    //       the log failed. With wait, the mutation is on disk on return.
+    uint64_t lsn;
+    {
+        unique_lock<shared_mutex> lock(tableMutex);
+        if (table.FindMovieId(movie) == NO_MOVIE)
+            return 0;
+        lsn = log.Append(WAL_UPDATE, EncodeMovie(movie) + FIELD_SEPARATOR + EncodeRating(rating));
+        if (lsn != 0)
+            table.UpdateRating(movie, rating);
+    }
+    return Finish(lsn, wait);
+}
+
+uint64_t DurableCatalog::Finish(uint64_t lsn, bool wait) {
+    // Function: Completes a mutation after it has been logged.
+    // Post: Starts a background checkpoint when the log has outgrown
+    //       checkpointBytes and none is running.
+    //       Function value = lsn, or 0 if it should be durable and is not.
+    if (lsn == 0)
+        return 0;
+    size_t limit = checkpointBytes.load(memory_order_relaxed);
+    if (limit != 0 && log.GetFileBytes() > limit && !checkpointing.exchange(true)) {
+        // Only the caller that set checkpointing touches the thread; the
+        // previous checkpoint has finished, so joining it does not block
+        if (checkpointer.joinable())
+            checkpointer.join();
+        checkpointer = thread([this]() {
+            Checkpoint();
+            checkpointing.store(false);
+        });
+    }
+    if (wait && !log.WaitDurable(lsn))
+        return 0;
+    return lsn;
+}
+
+bool DurableCatalog::Sync() {
+    // Function: Waits until every mutation so far is on disk.
+    // Post: Returns true once they are; false if the log failed.
+    return log.Sync();
+}
+
+bool DurableCatalog::Checkpoint() {
+    // Function: Writes a snapshot of the catalog and compacts the log.
+    // Post: Returns true if the snapshot is durable and the log holds only
+    //       the mutations made after it. Mutations may run meanwhile; other
+    //       checkpoints wait for this one.
+    lock_guard<mutex> checkpointLock(checkpointMutex);
+
+    // Copy the catalog, its IDs and the LSN it reflects under the lock; the
+    // slow encoding and writing happen after it is released
+    vector<Movie> movies;
+    vector<MovieId> ids;
+    MovieId nextId;
+    uint64_t lsn;
+    {
+        shared_lock<shared_mutex> lock(tableMutex);
+        nextId = table.GetNextId();
+        for (MovieId id = 0; id < nextId; id++) {
+            if (table.HasMovie(id)) {
+                movies.push_back(table.GetMovie(id));
+                ids.push_back(id);
+            }
+        }
+        lsn = log.GetLastLsn();
+    }
+
+    // The next ID comes last, so IDs of movies deleted from the end of the
+    // catalog are not given out again after recovery
+    string bytes = EncodeWalHeader(SNAPSHOT_MAGIC, lsn);
+    for (size_t i = 0; i < movies.size(); i++)
+        AppendWalRecord(bytes, lsn, WAL_INSERT, EncodeCatalogMovie(ids[i], movies[i]));
+    AppendWalRecord(bytes, lsn, SNAPSHOT_NEXT_ID, to_string(nextId));
+
+    string snapshotPath = path + ".snapshot";
+    string temporaryPath = snapshotPath + ".tmp";
+    int fd = open(temporaryPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    bool written = fd >= 0 && WriteFileBytes(fd, bytes.data(), bytes.size()) && fsync(fd) == 0;
+    if (fd >= 0)
+        close(fd);
+    if (!written || rename(temporaryPath.c_str(), snapshotPath.c_str()) != 0 || !SyncDirectoryOf(snapshotPath)) {
+        cerr << "Error: Could not write the snapshot " << snapshotPath << "!" << endl;
+        return false;
+    }
+
+    // A crash from here on is safe: recovery skips log records the snapshot covers
+    return log.Compact(lsn);
+}
+
+void DurableCatalog::SetCheckpointBytes(size_t bytes) {
+    // Function: Sets the log size at which a mutation triggers a checkpoint.
+    // Post: 0 turns automatic checkpoints off.
+    checkpointBytes.store(bytes, memory_order_relaxed);
+}
+
+void DurableCatalog::RetrieveMovie(const Movie& searchMovie, bool& found, Movie& retrievedMovie) const {
+    // Function: Retrieves the movie whose key matches searchMovie's key.
+    // Post: Same as HashType::RetrieveMovie.
+    shared_lock<shared_mutex> lock(tableMutex);
+    table.RetrieveMovie(searchMovie, found, retrievedMovie);
+}
+
+vector<Movie> DurableCatalog::GetMovies() const {
+    // Function: Gets every movie in the catalog, in ID order.
+    shared_lock<shared_mutex> lock(tableMutex);
+    return table.GetMovies();
+}
+
+MovieId DurableCatalog::FindMovieId(const Movie& searchMovie) const {
+    // Function: Finds the ID of the movie whose key matches searchMovie's key.
+    // Post: Same as HashType::FindMovieId; IDs survive recovery.
+    shared_lock<shared_mutex> lock(tableMutex);
+    return table.FindMovieId(searchMovie);
+}
+
+vector<Movie> DurableCatalog::RecommendTopRated(const Viewer& viewer, int k) const {
+    // Function: Recommends up to k movies for a Viewer from the rating lists.
+    // Post: Same as HashType::RecommendTopRated.
+    shared_lock<shared_mutex> lock(tableMutex);
+    return table.RecommendTopRated(viewer, k);
+}
+
+int DurableCatalog::GetNumItems() const {
+    // Function: Determines the number of movies in the catalog.
+    shared_lock<shared_mutex> lock(tableMutex);
+    return table.GetNumItems();
+}
+
+size_t DurableCatalog::GetSnapshotMovies() const {
+    // Function: Gets the number of movies the last Open loaded from the snapshot.
+    return snapshotMovies;
+}
+
+size_t DurableCatalog::GetReplayedRecords() const {
+    // Function: Gets the number of log records the last Open replayed.
+    return replayedRecords;
+}
+
+WriteAheadLog& DurableCatalog::GetLog() {
+    // Function: Gets the catalog's log, for its statistics and group window.
+    return log;
+}
+#endif
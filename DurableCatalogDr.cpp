@@ -0,0 +1,236 @@
+/***********************************************************************************************
+ * Name:        DurableCatalogDr.cpp
+ * Description: This driver measures the durable catalog. It loads the movie catalog through the
+ *              write-ahead log, then has 1 to maxWriters threads update ratings and wait for each
+ *              update to reach disk, with and without a group commit window, reporting mutations
+ *              per second, mutations per sync and the lag from mutation to disk. It then writes a
+ *              checkpoint, makes more changes, tears the last log record as a crash would, and
+ *              recovers the catalog from the snapshot and the log tail, checking that every movie
+ *              keeps its ID and that a deleted movie's ID is not given out again. Last, it checks that
+ *              recovery drops a last record that was cut short or whose CRC no longer
+ *              matches, and keeps everything before it.
+ *              Usage: DurableCatalog [path] [numMutations] [maxWriters]
+***********************************************************************************************/
+#include <iostream>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <thread>
+#include "Movie.h"
+#include "DurableCatalog.h"
+#include "WireFormat.h"
+
+using namespace std;
+typedef chrono::steady_clock Clock;
+
+// Function prototypes
+void benchmarkMutations(DurableCatalog& catalog, const vector<Movie>& catalogMovies, int numMutations,
+    int numWriters, int windowMicros, bool wait);
+bool sameMovies(const vector<Movie>& expected, const vector<Movie>& actual);
+bool checkDamagedTail(const string& path, const Movie& movie, bool truncate);
+double secondsSince(Clock::time_point start);
+
+int main(int argc, char* argv[]) {
+    string path = argc > 1 ? argv[1] : "catalog";
+    int numMutations = argc > 2 ? atoi(argv[2]) : 10000;
+    int maxWriters = argc > 3 ? atoi(argv[3]) : 16;
+
+    // Start from nothing so the numbers below describe this run
+    remove((path + ".wal").c_str());
+    remove((path + ".snapshot").c_str());
+
+    vector<Movie> catalogMovies = ReadMovieCSV("movieData.csv");
+    if (catalogMovies.empty())
+        return 1;
+    DurableCatalog catalog;
+    if (!catalog.Open(path))
+        return 1;
+
+    Clock::time_point start = Clock::now();
+    for (const Movie& movie : catalogMovies)
+        catalog.InsertMovie(movie, false);
+    catalog.Sync();
+    cout << "Loaded " << catalog.GetNumItems() << " movies through the log in " << secondsSince(start)
+        << " seconds; the log holds " << catalog.GetLog().GetFileBytes() / 1024 << " KB." << endl;
+
+    // Each writer waits for its own update to be durable, so a sync is shared
+    // only by the writers that were waiting at the same time
+    cout << "\nWriters  Window(us)  Mutations/s  Per sync  Mean lag(us)  Max lag(us)" << endl;
+    for (int window : { 0, 1000 }) {
+        for (int writers = 1; writers <= maxWriters; writers *= 2)
+            benchmarkMutations(catalog, catalogMovies, numMutations, writers, window, true);
+    }
+    cout << "\nWithout waiting for the disk:" << endl;
+    benchmarkMutations(catalog, catalogMovies, numMutations * 10, 1, 0, false);
+
+    // The snapshot leaves out a movie deleted from the end of the catalog, but
+    // must still keep its ID from being given out again
+    MovieId deletedId = catalog.FindMovieId(catalogMovies.back());
+    catalog.DeleteMovie(catalogMovies.back());
+
+    size_t logBytes = catalog.GetLog().GetFileBytes();
+    start = Clock::now();
+    bool checkpointed = catalog.Checkpoint();
+    cout << "\nCheckpoint " << (checkpointed ? "written" : "FAILED") << " in " << secondsSince(start)
+        << " seconds; the log shrank from " << logBytes / 1024 << " KB to "
+        << catalog.GetLog().GetFileBytes() / 1024 << " KB." << endl;
+
+    // Keep changing the catalog after the checkpoint, then stop as if crashed
+    mt19937 random(11);
+    for (int i = 0; i < 1000; i++) {
+        const Movie& movie = catalogMovies[random() % catalogMovies.size()];
+        catalog.UpdateRating(movie, (random() % 1000) / 100.0, false);
+    }
+    for (size_t i = 0; i < 100; i++)
+        catalog.DeleteMovie(catalogMovies[i * 7], false);
+    catalog.Sync();
+    vector<Movie> expected = catalog.GetMovies();
+    vector<MovieId> expectedIds;
+    for (const Movie& movie : catalogMovies)
+        expectedIds.push_back(catalog.FindMovieId(movie));
+    catalog.Close();
+
+    // A crash in the middle of a write leaves a partial record at the end
+    FILE* wal = fopen((path + ".wal").c_str(), "ab");
+    if (wal) {
+        const char torn[] = { 42, 0, 0, 0, 't', 'o', 'r', 'n' };
+        fwrite(torn, 1, sizeof(torn), wal);
+        fclose(wal);
+    }
+
+    DurableCatalog recovered;
+    start = Clock::now();
+    if (!recovered.Open(path))
+        return 1;
+    cout << "Recovered " << recovered.GetNumItems() << " movies in " << secondsSince(start) << " seconds ("
+        << recovered.GetSnapshotMovies() << " from the snapshot, " << recovered.GetReplayedRecords()
+        << " log records replayed)." << endl;
+    bool matches = sameMovies(expected, recovered.GetMovies());
+    for (size_t i = 0; matches && i < catalogMovies.size(); i++)
+        matches = recovered.FindMovieId(catalogMovies[i]) == expectedIds[i];
+    cout << "Recovered catalog matches the one before the crash, IDs included: " << (matches ? "yes" : "no") << endl;
+
+    // A movie inserted after recovery must not get the ID of one deleted before
+    Movie newcomer("Recovery Check", 2099, "Drama", "Nobody", "Nobody", 90, 5.0);
+    bool freshId = recovered.InsertMovie(newcomer) != 0 && recovered.FindMovieId(newcomer) > deletedId;
+    cout << "A movie inserted after recovery gets a new ID: " << (freshId ? "yes" : "no") << endl;
+    recovered.DeleteMovie(newcomer);
+    recovered.Close();
+
+    bool truncated = checkDamagedTail(path, catalogMovies[1], true);
+    cout << "Recovery drops a truncated last record: " << (truncated ? "yes" : "no") << endl;
+    bool corrupt = checkDamagedTail(path, catalogMovies[1], false);
+    cout << "Recovery drops a last record with a bad CRC: " << (corrupt ? "yes" : "no") << endl;
+    return matches && freshId && truncated && corrupt ? 0 : 1;
+}
+
+/**
+ * Changes one rating, damages the log record that holds the change, and
+ * reopens the catalog, which should come back as it was before the change.
+ *
+ * @param path The catalog path.
+ * @param movie A movie in the catalog, whose rating is changed.
+ * @param truncate Whether to cut the record short (true) or flip its last
+ *                 byte so the CRC no longer matches (false).
+ * @return True if the reopened catalog equals the one before the change.
+ */
+bool checkDamagedTail(const string& path, const Movie& movie, bool truncate) {
+    vector<Movie> expected;
+    {
+        DurableCatalog catalog;
+        if (!catalog.Open(path))
+            return false;
+        expected = catalog.GetMovies();
+        bool found;
+        Movie stored;
+        catalog.RetrieveMovie(movie, found, stored);
+        if (!found || catalog.UpdateRating(movie, stored.GetRating() < 5.0 ? 9.5 : 0.5) == 0)
+            return false;
+    }
+
+    string walPath = path + ".wal";
+    FILE* wal = fopen(walPath.c_str(), "r+b");
+    if (!wal)
+        return false;
+    fseek(wal, -1, SEEK_END);
+    long size = ftell(wal) + 1;
+    if (!truncate) {
+        int last = fgetc(wal);
+        fseek(wal, -1, SEEK_END);
+        fputc(last ^ 0x5A, wal);
+    }
+    fclose(wal);
+    if (truncate && ::truncate(walPath.c_str(), size - 4) != 0)
+        return false;
+
+    DurableCatalog recovered;
+    return recovered.Open(path) && sameMovies(expected, recovered.GetMovies());
+}
+
+/**
+ * Updates random ratings from several threads and prints one row of results:
+ * mutations per second, mutations made durable by each sync, and the mean and
+ * longest time from a mutation to its sync.
+ *
+ * @param catalog The catalog to update.
+ * @param catalogMovies The movies whose ratings are changed.
+ * @param numMutations The updates made across all writers.
+ * @param numWriters The number of writer threads.
+ * @param windowMicros The log's group commit window.
+ * @param wait Whether each update waits until it is durable.
+ */
+void benchmarkMutations(DurableCatalog& catalog, const vector<Movie>& catalogMovies, int numMutations,
+    int numWriters, int windowMicros, bool wait) {
+    WriteAheadLog& log = catalog.GetLog();
+    log.SetGroupWindow(windowMicros);
+    log.Sync();
+    log.ResetStats();
+
+    Clock::time_point start = Clock::now();
+    vector<thread> writers;
+    for (int w = 0; w < numWriters; w++) {
+        writers.push_back(thread([&, w]() {
+            mt19937 random(w + 1);
+            for (int i = w; i < numMutations; i += numWriters) {
+                const Movie& movie = catalogMovies[random() % catalogMovies.size()];
+                catalog.UpdateRating(movie, (random() % 1000) / 100.0, wait);
+            }
+        }));
+    }
+    for (thread& writer : writers)
+        writer.join();
+    log.Sync();
+    double seconds = secondsSince(start);
+
+    printf("%7d  %10d  %11.0f  %8.1f  %12.0f  %11.0f\n", numWriters, windowMicros, numMutations / seconds,
+        static_cast<double>(log.GetNumFlushed()) / max<uint64_t>(1, log.GetNumSyncs()),
+        log.GetMeanLagMicros(), log.GetMaxLagMicros());
+    fflush(stdout);
+}
+
+/**
+ * Compares two catalogs movie by movie, including ratings.
+ *
+ * @param expected The catalog before the crash.
+ * @param actual The recovered catalog.
+ * @return True if both hold the same movies with the same ratings in the same order.
+ */
+bool sameMovies(const vector<Movie>& expected, const vector<Movie>& actual) {
+    if (expected.size() != actual.size())
+        return false;
+    for (size_t i = 0; i < expected.size(); i++) {
+        if (EncodeMovie(expected[i]) != EncodeMovie(actual[i]))
+            return false;
+    }
+    return true;
+}
+
+/**
+ * Measures the time since start.
+ *
+ * @param start The starting time.
+ * @return The seconds elapsed.
+ */
+double secondsSince(Clock::time_point start) {
+    return chrono::duration<double>(Clock::now() - start).count();
+}
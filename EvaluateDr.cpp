@@ -0,0 +1,146 @@
+/***********************************************************************************************
+ * Name:        EvaluateDr.cpp
+ * Description: This driver evaluates every recommender path offline. It builds a synthetic
+ *              population of viewers, each with a favorite genre and director and a watch
+ *              history drawn mostly from that genre, holds out a fifth of every history, and
+ *              asks each path for every viewer's top k from several threads: the tiered rules
+ *              behind RecommendMovies, the other registered scoring policies, the rating-list
+ *              walk of RecommendTopRated and the co-watch graph trained on the remaining
+ *              histories. It prints precision@k, recall@k, coverage, requests per second and
+ *              latency for each path and writes the same numbers as JSON, so a build can be
+ *              gated on quality and speed together.
+ *              Usage: Evaluate [numViewers] [k] [numThreads] [jsonFile|-]
+***********************************************************************************************/
+#include <iostream>
+#include <algorithm>
+#include <cstdio>
+#include <map>
+#include <random>
+#include <thread>
+#include "Movie.h"
+#include "Viewer.h"
+#include "HashType.h"
+#include "CoWatchGraph.h"
+#include "OfflineEvaluator.h"
+#include "ScoringRegistry.h"
+#include "WireFormat.h"
+
+using namespace std;
+
+// Function prototypes
+vector<Viewer> makeViewers(const HashType& movieTable, int numViewers);
+void printResult(const EvaluationResult& result);
+
+int main(int argc, char* argv[]) {
+    int numViewers = argc > 1 ? atoi(argv[1]) : 10000;
+    int k = argc > 2 ? atoi(argv[2]) : 10;
+    int numThreads = argc > 3 ? atoi(argv[3]) : static_cast<int>(max(1u, thread::hardware_concurrency()));
+    string jsonFile = argc > 4 ? argv[4] : "evaluation.json";
+
+    HashType movieTable;
+    for (const Movie& movie : ReadMovieCSV("movieData.csv"))
+        movieTable.InsertMovie(movie);
+    if (movieTable.GetNumItems() == 0)
+        return 1;
+    MovieId numMovies = static_cast<MovieId>(movieTable.GetNumItems());
+
+    OfflineEvaluator evaluator(makeViewers(movieTable, numViewers), numMovies);
+    CoWatchGraph graph;
+    graph.Build(evaluator.GetTrainHistories(), numMovies);
+    cout << "Evaluating " << numViewers << " viewers (" << evaluator.GetNumHoldout() << " held-out watches) over "
+        << numMovies << " movies with k = " << k << " on " << numThreads << " threads." << endl;
+
+    // Every path answers with movie IDs, so all are scored the same way
+    ScoringRegistry registry;
+    vector<pair<string, RecommenderPath>> paths;
+    for (const string& policy : registry.GetPolicyNames()) {
+        paths.push_back(make_pair(policy, [&, policy](const Viewer& viewer, int count) {
+            return registry.RecommendIds(movieTable, policy, viewer, ScoringContext(), count);
+        }));
+    }
+    paths.push_back(make_pair("toprated", [&](const Viewer& viewer, int count) {
+        return movieTable.RecommendTopRatedIds(viewer, count);
+    }));
+    paths.push_back(make_pair("cowatch", [&](const Viewer& viewer, int count) {
+        vector<MovieId> ids;
+        for (const ScoredMovie& movie : graph.Recommend(viewer, count))
+            ids.push_back(movie.first);
+        return ids;
+    }));
+
+    printf("\n%-11s %11s %9s %9s %11s %10s %10s %10s\n", "path", "precision", "recall", "coverage",
+        "requests/s", "mean us", "p99 us", "p999 us");
+    vector<EvaluationResult> results;
+    for (const pair<string, RecommenderPath>& path : paths) {
+        results.push_back(evaluator.Evaluate(path.first, path.second, k, numThreads));
+        printResult(results.back());
+    }
+
+    if (!WriteEvaluationJson(jsonFile, results)) {
+        cerr << "Error: Could not write " << jsonFile << "!" << endl;
+        return 1;
+    }
+    if (jsonFile != "-")
+        cout << "\nWrote " << jsonFile << "." << endl;
+    return 0;
+}
+
+/**
+ * Builds synthetic viewers. Each viewer picks a favorite genre in proportion
+ * to the genre's size, follows the director of one of that genre's movies,
+ * and watches 5 to 40 movies, 80% of them from the favorite genre and the
+ * rest from the whole catalog. Draws favor the first movies of a list, so
+ * every genre has a few popular titles and a long tail.
+ *
+ * @param movieTable The catalog viewers watch from.
+ * @param numViewers The number of viewers to build.
+ * @return The viewers, with their preferences and watched movies.
+ */
+vector<Viewer> makeViewers(const HashType& movieTable, int numViewers) {
+    map<string, vector<MovieId>> byGenre;
+    vector<MovieId> all;
+    for (MovieId id = 0; id < static_cast<MovieId>(movieTable.GetNumItems()); id++) {
+        byGenre[movieTable.GetMovie(id).GetGenre()].push_back(id);
+        all.push_back(id);
+    }
+    vector<string> genreNames;
+    vector<double> genreWeights;
+    for (const pair<const string, vector<MovieId>>& genre : byGenre) {
+        genreNames.push_back(genre.first);
+        genreWeights.push_back(static_cast<double>(genre.second.size()));
+    }
+
+    mt19937 random(2025);
+    discrete_distribution<int> pickGenre(genreWeights.begin(), genreWeights.end());
+    uniform_real_distribution<double> uniform(0.0, 1.0);
+    auto skewed = [&](const vector<MovieId>& list) {
+        double u = uniform(random);
+        return list[static_cast<size_t>(u * u * u * list.size())];
+    };
+
+    vector<Viewer> viewers;
+    for (int v = 0; v < numViewers; v++) {
+        const string& genre = genreNames[pickGenre(random)];
+        const vector<MovieId>& favorite = byGenre[genre];
+        Viewer viewer("Viewer" + to_string(v), 18 + v % 60);
+        viewer.AddPreferredGenre(genre);
+        viewer.AddFavoriteDirector(movieTable.GetMovie(skewed(favorite)).GetDirector());
+        int length = 5 + static_cast<int>(random() % 36);
+        for (int i = 0; i < length; i++)
+            viewer.AddWatchedMovie(uniform(random) < 0.8 ? skewed(favorite) : skewed(all));
+        viewers.push_back(viewer);
+    }
+    return viewers;
+}
+
+/**
+ * Prints one row of the results table.
+ *
+ * @param result The evaluation of one recommender path.
+ */
+void printResult(const EvaluationResult& result) {
+    printf("%-11s %11.4f %9.4f %9.4f %11.0f %10.1f %10.1f %10.1f\n", result.name.c_str(), result.precision,
+        result.recall, result.coverage, result.requestsPerSecond, result.meanMicros, result.p99Micros,
+        result.p999Micros);
+    fflush(stdout);
+}
@@ -1,502 +1,1098 @@
-/**
- * HashType.h
- * The HashType class defines a hash table and a corresponding
- * hash function for storing Movie objects. It includes various operations
- * like insertion, retrieval, deletion, and providing recommendations. The
- * class also features quadratic probing to handle collisions, sorting
- * recommendations based on rating, and checking viewer preferences.
- **/
-
-#ifndef HASHTYPE_H
-#define HASHTYPE_H
-
-#include <iostream>
-#include <vector>
-#include "Movie.h"
-#include "Viewer.h"
-
-using namespace std;
-
-const int MAX_ITEMS = 70000;  // Maximum items in the hash table
-const int HASH_FACTOR = 31;   // Prime constant for hash function
-
-class HashType {
-public:
-    // Class constructor
-    HashType();
-
-    void MakeEmpty();
-    // Function: Returns the hash table to the empty state.
-    // Post:  Hash table is empty.
-
-    bool IsFull() const;
-    // Function:  Determines whether hash table is full.
-    // Pre:  Hash table has been initialized.
-    // Post: Function value = (hash table is full)
-
-    int GetNumItems() const;
-    // Function: Determines the number of elements in the hash table.
-    // Pre:  Hash table has been initialized.
-    // Post: Function value = number of elements in the hash table
-
-    vector<Movie> GetMovies() const;
-    // Function: Gets all Movie objects stored in the hash table.
-    // Pre: Hash table has been initialized.
-    // Post: Returns a vector containing all stored Movie objects.
-
-    /* This is the hash function for this class */
-    int Hash(string movie_title, int movie_year, string movie_genre) const;
-    // Function: Computes a hash value for a Movie based on its title, year, and genre.
-    // Pre:  Hash table has been initialized.
-    // Post: Returns an int representing the hash value of the Movie object.
-
-    void InsertMovie(const Movie& movie);
-    // Function: Adds Movie to hash table and uses a quadratic probing technique to
-    //           resolve collisions.
-    // Pre:  Hash table has been initialized.
-    //       Hash table is not full.
-    // Post: Movie object is in hash table.
-
-    void RetrieveMovie(const Movie& searchMovie, bool& found, Movie& retrievedMovie);
-    // Function: Retrieves hash table element whose key matches searchMovie's key (if
-    //           present).
-    // Pre:  Hash table has been initialized.
-    //       Key member of retrievedMovie is initialized.
-    // Post: If there is a movie retrievedMovie whose value matches
-    //       searchMovie's value, then found = true and searchMovie contains 
-    //       the contents of retrievedMovie if it is found.
-    // 	     otherwise found = false and searchMovie is returned unchanged.
-    //       Hash table is unchanged.
-
-    void DeleteMovie(Movie movie);
-    // Function: Deletes the element whose key matches movie's key.
-    // Pre:  Hash table has been initialized.
-    //       Key member of movie is initialized.
-    //       One and only one element in hash table has a key matching movie's key.
-    // Post: No element in hash table has a key matching movie's key.
-
-    void RecommendMovies(const Viewer& viewer) const;
-    // Function: Gives personalized movie recommendations for a Viewer.
-    // Pre:   Hash table has been initialized.
-    //        Viewer preferences are available (favorite directors and/or preferred genres).
-    // Post:  Display a list of recommended movies based on the Viewer's 
-    //        preferred genres, favorite directors, and watchlist.
-
-    void SortRecommendations(vector<Movie>& recommendedList) const;
-    // Function: Sorts a list of recommended movies by rating (highest to lowest).
-    // Pre:  The recommended list contains unsorted Movie objects.
-    // Post: Movies in the list are now ordered from highest to lowest rating.
-
-    bool IsPreferredGenre(const Viewer& viewer, const string& movie_genre) const;
-    // Function: Checks if a given movie genre is one of Viewer's preferred genres.
-    // Pre:  Viewer object has been initialized.
-    // Post: Returns true if the genre is in the Viewer's preferred genres.
-    //       Otherwise, returns false.
-
-    bool IsFavoriteDirector(const Viewer& viewer, const string& movie_director) const;
-    // Function: Checks if a given director is one of Viewer's favorite directors.
-    // Pre:  Viewer object has been initialized.
-    // Post: Returns true if the director is in the Viewer's favorite directors.
-    //       Otherwise, returns false.
-
-    bool IsMovieWatched(const Viewer& viewer, const string& movie_title) const;
-    // Function: Checks if a Viewer has already seen a given movie.
-    // Pre:  Viewer object has been initialized.
-    // Post: Returns true if the movie appears in the Viewer's watchlist.
-    //       Otherwise, returns false.
-
-private:
-    int size;      // size of the hash table
-    int numItems;  // number of items in the hash table
-    int factor;    // the value used for the hash function
-    string emptyItem = "";  // the empty string 
-    unsigned long int numCollisions;  // number of collisions encountered
-    vector<Movie> movies;   // vector of Movies in the hash table
-    vector<bool> occupied;  // tracks occupied slots of the hash table
-};
-
-// Class constructor
-HashType::HashType() {
-    size = MAX_ITEMS;
-    numItems = 0;
-    factor = HASH_FACTOR;
-    numCollisions = 0;
-    movies.resize(size, Movie());
-    occupied.resize(size, false);
-}
-
-void HashType::MakeEmpty() {
-    // Function: Returns the hash table to the empty state.
-    // Post:  Hash table is empty.
-    numItems = 0;  // set number of hash table items to 0
-    // Make slots in the hash table empty
-    for (int i = 0; i < size; i++) {
-        movies[i] = Movie();
-        occupied[i] = false;
-    }
-}
-
-bool HashType::IsFull() const {
-    // Function:  Determines whether hash table is full.
-    // Pre:  Hash table has been initialized.
-    // Post: Function value = (hash table is full)
-    return (numItems == size);
-}
-
-int HashType::GetNumItems() const {
-    // Function: Determines the number of elements in the hash table.
-    // Pre:  Hash table has been initialized.
-    // Post: Function value = number of elements in the hash table
-    return numItems;
-}
-
-vector<Movie> HashType::GetMovies() const {
-    // Function: Gets all Movie objects stored in the hash table.
-    // Pre: Hash table has been initialized.
-    // Post: Returns a vector containing all stored Movie objects.
-    vector<Movie> movieList;
-
-    // Loop over the hash table and add occupied slots to the movieList vector
-    for (int i = 0; i < size; i++) {
-        if (occupied[i])
-            movieList.push_back(movies[i]);
-    }
-    return movieList;
-}
-
-/* This is the hash function for this class */
-int HashType::Hash(string movie_title, int movie_year, string movie_genre) const {
-    // Function: Computes a hash value for a Movie based on its title, year, and genre.
-    // Pre:  Hash table has been initialized.
-    // Post: Returns an int representing the hash value of the Movie object.
-    int hash = 0;  // initialize hash value
-
-    // Create a key using title, year, and genre of the movie
-    string key = movie_title + to_string(movie_year) + movie_genre;
-    for (char c : key)
-        hash = (hash * factor + c) % size;  // apply hashing formula using constant factor
-
-    return abs(hash % size);
-}
-
-void HashType::InsertMovie(const Movie& movie) {
-    // Function: Adds Movie to hash table and uses a quadratic probing technique to
-    //           resolve collisions.
-    // Pre:  Hash table has been initialized.
-    //       Hash table is not full.
-    // Post: Movie object is in hash table.
-    int index = Hash(movie.GetTitle(), movie.GetYear(), movie.GetGenre());
-
-    int rehash_count = 1;     // initialize a rehash counter
-    int operation_count = 1;  // to flip between + and -
-
-    while (occupied[index]) {
-        numCollisions++;
-
-        // add rehash_count squared
-        if (operation_count % 2 == 1) {
-            index = (index + (rehash_count * rehash_count)) % size;
-            operation_count++;
-        }
-        // subtract rehash_count squared
-        else {
-            index = (index - (rehash_count * rehash_count)) % size;
-            // Fix index if it is negative
-            if (index < 0)
-                index = (index + size) % size;
-
-            operation_count++;
-            rehash_count++;  // increment rehash counter every two runs (+ / -)
-        }
-    }
-    movies[index] = movie;
-    occupied[index] = true;
-    numItems++;
-}
-
-// Retrieve Movie using Quadratic Probing
-void HashType::RetrieveMovie(const Movie& searchMovie, bool& found, Movie& retrievedMovie) {
-    // Function: Retrieves hash table element whose key matches searchMovie's key (if
-    //           present).
-    // Pre:  Hash table has been initialized.
-    //       Key member of retrievedMovie is initialized.
-    // Post: If there is a movie retrievedMovie whose value matches
-    //       searchMovie's value, then found = true and searchMovie contains 
-    //       the contents of retrievedMovie if it is found.
-    // 	     otherwise found = false and searchMovie is returned unchanged.
-    //       Hash table is unchanged.
-    int index = Hash(searchMovie.GetTitle(), searchMovie.GetYear(), searchMovie.GetGenre());
-
-    found = false;
-    int rehash_count = 1;  // initialize a rehash counter
-    int operation_count = 1;  // to flip between + and -
-
-    while (occupied[index]) {
-        if (movies[index].GetTitle() == searchMovie.GetTitle() &&
-            movies[index].GetYear() == searchMovie.GetYear() &&
-            movies[index].GetGenre() == searchMovie.GetGenre()) {
-            found = true;
-            retrievedMovie = movies[index];  // movie is found
-            return;
-        }
-
-        // add rehash_count squared
-        if (operation_count % 2 == 1) {
-            index = (index + (rehash_count * rehash_count)) % size;
-            operation_count++;
-        }
-        // subtract rehash_count squared
-        else {
-            index = (index - (rehash_count * rehash_count)) % size;
-            // Fix index if it is negative
-            if (index < 0)
-                index = (index + size) % size;
-
-            operation_count++;
-            rehash_count++;  // increment rehash counter every two runs (+ / -)
-        }
-    }
-
-    // If movie is not found, return default empty Movie object
-    retrievedMovie = Movie();
-}
-
-void HashType::DeleteMovie(Movie movie) {
-    // Function: Deletes the element whose key matches movie's key.
-    // Pre:  Hash table has been initialized.
-    //       Key member of movie is initialized.
-    //       One and only one element in hash table has a key matching movie's key.
-    // Post: No element in hash table has a key matching movie's key.
-    int index = Hash(movie.GetTitle(), movie.GetYear(), movie.GetGenre());
-    int rehash_count = 1;     // initialize a rehash counter
-    int operation_count = 1;  // to flip between + and -
-
-    while (occupied[index]) {
-        if (movies[index].GetTitle() == movie.GetTitle() &&
-            movies[index].GetYear() == movie.GetYear() &&
-            movies[index].GetGenre() == movie.GetGenre()) {
-            // clear the hash table slot if movie is found
-            movies[index] = Movie();
-            occupied[index] = false;
-            numItems--;
-            return;
-        }
-        // add rehash_count squared
-        if (operation_count % 2 == 1) {
-            index = (index + (rehash_count * rehash_count)) % size;
-            operation_count++;
-        }
-        // subtract rehash_count squared
-        else {
-            index = (index - (rehash_count * rehash_count)) % size;
-            // Fix index if it is negative
-            if (index < 0)
-                index = (index + size) % size;
-
-            operation_count++;
-            rehash_count++;  // increment rehash counter every two runs (+ / -)
-        }
-    }
-    cout << "Movie to delete not found." << endl;
-}
-
-void HashType::RecommendMovies(const Viewer& viewer) const {
-    // Function: Gives personalized movie recommendations for a Viewer.
-    // Pre:   Hash table has been initialized.
-    //        Viewer preferences are available (favorite directors and/or preferred genres).
-    // Post:  Display a list of recommended movies based on the Viewer's 
-    //        preferred genres, favorite directors, and watchlist.
-
-    vector<Movie> recommended;          // vector of recommended movies
-    vector<Movie> directorSuggested;    // movies recommended based on favorite director(s)
-    vector<Movie> genreSuggested;       // movies recommended based on preferred genre(s)
-    vector<string> distinctGenres;      // tracks distinct genres accounted for in recs
-    vector<string> favoriteDirectors = viewer.GetFavoriteDirectors();
-
-    cout << "\nFetching Movie Recommendations for " << viewer.GetViewerName() << "..." << endl;
-
-    // Loop over movies in the hash table
-    for (int i = 0; i < size; i++) {
-        if (occupied[i]) {  // checks for non-empty slots
-            bool MatchDirector = IsFavoriteDirector(viewer, movies[i].GetDirector());  // match on director
-            bool MatchGenre = IsPreferredGenre(viewer, movies[i].GetGenre());  // match on genre
-            bool IsUnwatched = !IsMovieWatched(viewer, movies[i].GetTitle());  // movie is not already watched
-            bool IsHighlyRated = movies[i].GetRating() >= 7.5;  // movie is highly rated
-
-            if (IsUnwatched) {  // movies must be unwatched to be recommendations
-                // This loop handles director suggestions
-                if (MatchDirector)
-                    directorSuggested.push_back(movies[i]);  // note: directorSuggested movies need not be highly rated
-                // This loop handles highly-rated genre suggestions
-                else if (MatchGenre && IsHighlyRated) {
-                    bool genreIncluded = false;  // tracks whether this a given genre has been accounted for
-
-                    for (const string& currentGenre : distinctGenres) {
-                        if (currentGenre == movies[i].GetGenre()) {
-                            genreIncluded = true;
-                            break;
-                        }
-                    }
-
-                    if (!genreIncluded) {
-                        genreSuggested.push_back(movies[i]);  // Add the movie as a genre suggestion
-                        distinctGenres.push_back(movies[i].GetGenre());  // Add the genre as accounted for
-                    }
-                }
-            }
-        }
-    }
-
-    int numDirectors = static_cast<int>(favoriteDirectors.size());  // Number of favorite directors the viewer added
-
-    /* First allocate recommendation spots based on number of favorite directors */
-    // Give a max of 2 spots if there is 1 favorite director
-    if (numDirectors == 1) {
-        for (const Movie& movie : directorSuggested) {
-            if (recommended.size() < 2 && movie.GetDirector() == favoriteDirectors[0])
-                recommended.push_back(movie);
-        }
-    }
-
-    // Split the 3 spots if the viewer provides 2 favorite directors
-    else if (numDirectors == 2) {
-        int count1 = 0;
-        int count2 = 0;
-
-        for (const Movie& movie : directorSuggested) {
-            if (recommended.size() < 3) {
-                if (movie.GetDirector() == favoriteDirectors[0] && count1 < 2) {
-                    recommended.push_back(movie);
-                    count1++;
-                }
-                else if (movie.GetDirector() == favoriteDirectors[1] && count2 < 1) {
-                    recommended.push_back(movie);
-                    count2++;
-                }
-            }
-        }
-    }
-
-    // Split the 3 spots if the viewer provides 3+ favorite directors
-    else if (numDirectors >= 3) {
-        int count1 = 0;
-        int count2 = 0;
-        int count3 = 0;
-
-        for (const Movie& movie : directorSuggested) {
-            if (recommended.size() < 3) {
-                if (movie.GetDirector() == favoriteDirectors[0] && count1 < 1) {
-                    recommended.push_back(movie);
-                    count1++;
-                }
-                else if (movie.GetDirector() == favoriteDirectors[1] && count2 < 1) {
-                    recommended.push_back(movie);
-                    count2++;
-                }
-                else if (movie.GetDirector() == favoriteDirectors[2] && count3 < 1) {
-                    recommended.push_back(movie);
-                    count3++;
-                }
-            }
-        }
-    }
-
-    // Fill any remaining spots with highly-rated genre matches
-    for (const Movie& movie : genreSuggested) {
-        if (recommended.size() < 3)  // check if recommendation list size is less than 3
-            recommended.push_back(movie);  // if so, add a genre match
-    }
-
-    // Fill any remaining spots now with unwatched movies from preferred genres
-    for (const Movie& movie : movies) {
-        // Stop if we hit 3 recommendations
-        if (recommended.size() >= 3)
-            break;
-
-        // Otherwise enter this loop and check that the movie is unwatched, highly rated,
-        // and is of the preferred genre(s)
-        if (IsPreferredGenre(viewer, movie.GetGenre()) && !IsMovieWatched(viewer, movie.GetTitle()) &&
-            movie.GetRating() >= 7.5) {
-
-            bool movieAlreadyRecommended = false;
-            // Check for duplicates before adding to recommended list
-            for (const Movie& rhs : recommended) {
-                if (movie == rhs) {
-                    movieAlreadyRecommended = true;
-                    break;
-                }
-            }
-            // Add to recommended list if it's not already included
-            if (!movieAlreadyRecommended)
-                recommended.push_back(movie);
-        }
-    }
-
-    // Sort recommendations (highest to lowest rating)
-    SortRecommendations(recommended);
-
-    // Get minimum of 3 recs or size of recommended list
-    int n = min(3, static_cast<int>(recommended.size()));
-
-    if (n == 0)
-        cout << "\nSorry! No movies available match the viewer's preferences." << endl;
-    else {
-        cout << "\nTop " << n << " Movie Recommendations for " << viewer.GetViewerName() << ": " << endl;
-        for (int i = 0; i < n; i++) {
-            recommended[i].Print();  // print recommendations
-        }
-    }
-    cout << "*******************************************************" << endl;
-}
-
-void HashType::SortRecommendations(vector<Movie>& recommendedList) const {
-    // Function: Sorts a list of recommended movies by rating (highest to lowest).
-    // Pre:  The recommended list contains unsorted Movie objects.
-    // Post: Movies in the list are now ordered from highest to lowest rating.
-    int length = static_cast<int>(recommendedList.size());
-
-    // Bubble sort
-    for (int i = 0; i < length - 1; i++) {
-        for (int j = 0; j < length - i - 1; j++) {
-            if (recommendedList[j].GetRating() < recommendedList[j + 1].GetRating())
-                swap(recommendedList[j], recommendedList[j + 1]);
-        }
-    }
-}
-
-bool HashType::IsPreferredGenre(const Viewer& viewer, const string& movie_genre) const {
-    // Function: Checks if a given movie genre is one of Viewer's preferred genres.
-    // Pre:  Viewer object has been initialized.
-    // Post: Returns true if the genre is in the Viewer's preferred genres.
-    //       Otherwise, returns false.
-    for (const string& genre : viewer.GetPreferredGenres()) {
-        if (genre == movie_genre)
-            return true;
-    }
-    return false;
-}
-
-bool HashType::IsFavoriteDirector(const Viewer& viewer, const string& movie_director) const {
-    // Function: Checks if a given director is one of Viewer's favorite directors.
-    // Pre:  Viewer object has been initialized.
-    // Post: Returns true if the director is in the Viewer's favorite directors.
-    //       Otherwise, returns false.
-    for (const string& director : viewer.GetFavoriteDirectors()) {
-        if (director == movie_director)
-            return true;
-    }
-    return false;
-}
-
-bool HashType::IsMovieWatched(const Viewer& viewer, const string& movie_title) const {
-    // Function: Checks if a Viewer has already seen a given movie.
-    // Pre:  Viewer object has been initialized.
-    // Post: Returns true if the movie appears in the Viewer's watchlist.
-    //       Otherwise, returns false.
-    for (const string& watched : viewer.GetWatchlist()) {
-        if (watched == movie_title)
-            return true;
-    }
-    return false;
-}
+/**
+ * HashType.h
+ * The BasicHashType class defines a hash table and a corresponding
+ * hash function for storing Movie objects. It includes various operations
+ * like insertion, retrieval, deletion, and providing recommendations. The
+ * class also features sorting recommendations based on rating, and checking
+ * viewer preferences.
+ * Movies are kept in a dense array of entries indexed by ID; the
+ * Probing policy (see ProbingPolicy.h) owns the slots that map keys to
+ * entries and decides how collisions are resolved. HashType is the table
+ * with the original quadratic probing.
+ * Each movie gets a dense MovieId when it is inserted: its position in the
+ * entry array. IDs are never reused before MakeEmpty, so IDs kept outside
+ * the table (a viewer's watched movies, watch histories) never come to name
+ * another movie; a deleted movie only leaves a cleared entry behind. A
+ * title (and optional year) can be resolved to IDs through an index.
+ * Every genre and director also has a list of its movies sorted by rating,
+ * kept up to date by InsertMovie, DeleteMovie and UpdateRating, so the best
+ * unwatched movies in a viewer's genres and directors can be read off the
+ * front of a few lists instead of scanning the table. The same movies are
+ * also kept as compressed ID sets (RoaringBitmap.h), so a viewer's
+ * candidates are the union of a few sets minus the watched set, computed a
+ * container at a time rather than one watched check per movie.
+ **/
+
+#ifndef HASHTYPE_H
+#define HASHTYPE_H
+
+#include <iostream>
+#include <limits>
+#include <set>
+#include <unordered_map>
+#include <vector>
+#include "Movie.h"
+#include "Viewer.h"
+#include "RoaringBitmap.h"
+#include "ProbingPolicy.h"
+#include "ScoringPolicy.h"
+#include "Metrics.h"
+#include "Trace.h"
+
+using namespace std;
+
+const int MAX_ITEMS = 70000;  // Default capacity of the hash table
+const int LOOKUP_WINDOW = 16; // Batched lookups whose cache misses are overlapped
+
+// Movies of one genre or director as (-rating, entry): highest rating first,
+// then the lowest ID
+typedef set<pair<double, int>> RatingList;
+
+// Where a paged walk of a viewer's rating lists stopped: the rating-list key
+// of the last movie it passed. The next page starts just after that key, so
+// pages follow one stable order even while movies are added and removed.
+struct RecommendationCursor {
+    pair<double, int> last = make_pair(-numeric_limits<double>::infinity(), -1);  // before every movie
+    bool done = false;  // every list has run out
+};
+
+template <class Probing>
+class BasicHashType {
+public:
+    // Class constructor, for a table holding up to capacity movies
+    BasicHashType(int capacity = MAX_ITEMS);
+
+    void MakeEmpty();
+    // Function: Returns the hash table to the empty state.
+    // Post:  Hash table is empty.
+
+    bool IsFull() const;
+    // Function:  Determines whether hash table is full.
+    // Pre:  Hash table has been initialized.
+    // Post: Function value = (hash table is full)
+
+    int GetMaxItems() const;
+    // Function: Determines how many movies the hash table can hold.
+    // Pre:  Hash table has been initialized.
+    // Post: Function value = number of movies at which the table is full.
+
+    int GetNumItems() const;
+    // Function: Determines the number of elements in the hash table.
+    // Pre:  Hash table has been initialized.
+    // Post: Function value = number of elements in the hash table
+
+    int GetNumSlots() const;
+    // Function: Determines the number of slots the probing policy allocated.
+    // Pre:  Hash table has been initialized.
+    // Post: Function value = number of slots (load factor = items / slots)
+
+    unsigned long int GetNumCollisions() const;
+    // Function: Gets the number of collisions met by insertions so far.
+    // Pre:  Hash table has been initialized.
+    // Post: Function value = slots probed past each inserted movie's home slot
+
+    vector<Movie> GetMovies() const;
+    // Function: Gets all Movie objects stored in the hash table.
+    // Pre: Hash table has been initialized.
+    // Post: Returns a vector containing all stored Movie objects.
+
+    /* This is the hash function for this class */
+    int Hash(string movie_title, int movie_year, string movie_genre) const;
+    // Function: Computes a hash value for a Movie based on its title, year, and genre.
+    // Pre:  Hash table has been initialized.
+    // Post: Returns an int representing the home slot of the Movie object.
+
+    MovieId InsertMovie(const Movie& movie);
+    // Function: Adds Movie to hash table and uses the probing policy to
+    //           resolve collisions.
+    // Pre:  Hash table has been initialized.
+    //       Hash table is not full.
+    // Post: Movie object is in hash table.
+    //       Function value = the movie's new ID (IDs count up from 0 after
+    //       MakeEmpty), or NO_MOVIE if it could not be added.
+
+    MovieId RestoreMovie(const Movie& movie, MovieId id);
+    // Function: Adds Movie to hash table under a given ID, as when a saved
+    //           catalog is loaded back.
+    // Pre:  Hash table has been initialized.
+    //       Hash table is not full and no movie in it has id.
+    // Post: Movie object is in hash table under id; InsertMovie gives only
+    //       IDs above it from now on.
+    //       Function value = id, or NO_MOVIE if it could not be added.
+
+    MovieId GetNextId() const;
+    // Function: Determines the ID the next inserted movie will get.
+    // Post: Function value = one past the highest ID given or reserved
+    //       since MakeEmpty (0 if none).
+
+    void ReserveIds(MovieId next);
+    // Function: Keeps InsertMovie from giving any ID below next.
+    // Post: GetNextId() >= next.
+
+    MovieId FindMovieId(const Movie& searchMovie) const;
+    // Function: Finds the ID of the element whose key matches searchMovie's key.
+    // Pre:  Hash table has been initialized.
+    // Post: Function value = the movie's ID, or NO_MOVIE if there is none.
+
+    MovieId ResolveTitle(const string& movie_title, int movie_year = -1) const;
+    // Function: Finds the ID of a movie by its title, and its year when given.
+    // Pre:  Hash table has been initialized.
+    // Post: Function value = ID of the matching movie. When several movies
+    //       match (remakes, or one title in several genres), the most
+    //       recent release wins, then the highest ID. NO_MOVIE if none match.
+
+    vector<MovieId> FindTitle(const string& movie_title) const;
+    // Function: Finds every movie with a given title.
+    // Pre:  Hash table has been initialized.
+    // Post: Function value = IDs of the matching movies in ascending order.
+
+    bool HasMovie(MovieId id) const;
+    // Function: Checks whether an ID belongs to a movie in the table.
+    // Post: Returns true if id was given by InsertMovie or RestoreMovie and
+    //       not deleted since.
+
+    const Movie& GetMovie(MovieId id) const;
+    // Function: Gets the movie with a given ID.
+    // Pre:  HasMovie(id).
+    // Post: Function value = the movie.
+
+    vector<MovieId> GetWatchedIds(const Viewer& viewer) const;
+    // Function: Collects the IDs of every movie a Viewer has seen.
+    // Pre:  Hash table has been initialized.
+    // Post: Function value = the Viewer's watched movie IDs together with the
+    //       IDs of every movie titled like a watchlist entry, ascending and
+    //       without repeats.
+
+    RoaringBitmap GetWatchedSet(const Viewer& viewer) const;
+    // Function: Same as GetWatchedIds, as a compressed set.
+
+    RoaringBitmap GetCandidateSet(const Viewer& viewer) const;
+    // Function: Collects the unwatched movies in the Viewer's preferred genres
+    //           or by the Viewer's favorite directors.
+    // Pre:  Hash table has been initialized.
+    // Post: Function value = IDs of those movies: the union of the Viewer's
+    //       genre and director sets with the watched set subtracted in one
+    //       AndNot.
+
+    void RetrieveMovie(const Movie& searchMovie, bool& found, Movie& retrievedMovie) const;
+    // Function: Retrieves hash table element whose key matches searchMovie's key (if
+    //           present).
+    // Pre:  Hash table has been initialized.
+    //       Key member of retrievedMovie is initialized.
+    // Post: If there is a movie retrievedMovie whose value matches
+    //       searchMovie's value, then found = true and searchMovie contains 
+    //       the contents of retrievedMovie if it is found.
+    // 	     otherwise found = false and searchMovie is returned unchanged.
+    //       Hash table is unchanged.
+
+    void RetrieveMany(const vector<Movie>& searchMovies, vector<bool>& found, vector<Movie>& retrievedMovies) const;
+    // Function: Retrieves the elements matching a batch of keys.
+    // Pre:  Hash table has been initialized.
+    // Post: found and retrievedMovies have one element per search movie, set
+    //       as RetrieveMovie would set them. Hash table is unchanged.
+
+    vector<MovieId> FindMovieIds(const vector<Movie>& searchMovies) const;
+    // Function: Finds the IDs of the elements matching a batch of keys.
+    // Pre:  Hash table has been initialized.
+    // Post: Function value = one ID per search movie, NO_MOVIE where no
+    //       element matches. Keys are hashed and their slots and entries
+    //       prefetched a window at a time, so the cache misses of
+    //       neighbouring lookups overlap instead of following each other.
+
+    void DeleteMovie(Movie movie);
+    // Function: Deletes the element whose key matches movie's key.
+    // Pre:  Hash table has been initialized.
+    //       Key member of movie is initialized.
+    //       One and only one element in hash table has a key matching movie's key.
+    // Post: No element in hash table has a key matching movie's key.
+
+    void DeleteMovieId(MovieId id);
+    // Function: Deletes the movie with a given ID.
+    // Pre:  HasMovie(id).
+    // Post: The movie is gone; its ID is not given to another movie.
+
+    void UpdateRating(const Movie& movie, double rating);
+    // Function: Changes the rating of the element whose key matches movie's key.
+    // Pre:  Hash table has been initialized.
+    //       Key member of movie is initialized.
+    // Post: The matching movie has the new rating and the rating lists are
+    //       reordered. Prints an error if no movie matches.
+
+    void RecommendMovies(const Viewer& viewer) const;
+    // Function: Gives personalized movie recommendations for a Viewer.
+    // Pre:   Hash table has been initialized.
+    //        Viewer preferences are available (favorite directors and/or preferred genres).
+    // Post:  Display a list of recommended movies based on the Viewer's 
+    //        preferred genres, favorite directors, and watchlist.
+
+    template <class Policy>
+    vector<Movie> GetRecommendations(const Viewer& viewer, const ScoringContext& context, int k) const;
+    // Function: Scans the hash table and lets Policy pick up to k recommendations.
+    // Pre:   Hash table has been initialized.
+    //        Policy follows the interface described in ScoringPolicy.h.
+    // Post:  Function value = the movies chosen by Policy among the movies
+    //        of GetCandidateSet, offered to Policy in ID order whatever the
+    //        probing policy. Only those candidates are scanned, so a Viewer
+    //        with narrow preferences or a long history costs less.
+
+    template <class Policy>
+    vector<MovieId> GetRecommendationIdsFrom(const vector<MovieId>& candidates, const Viewer& viewer,
+        const ScoringContext& context, int k) const;
+    // Function: Lets Policy pick up to k recommendations from given movies.
+    // Pre:   Every ID in candidates names a movie in the table.
+    //        Policy follows the interface described in ScoringPolicy.h.
+    // Post:  Function value = the IDs of the movies chosen by Policy, offered
+    //        to it in the order of candidates without being copied. The
+    //        caller has already left out the movies the Viewer has seen.
+
+    template <class Policy>
+    vector<MovieId> GetRecommendationIds(const Viewer& viewer, const ScoringContext& context, int k) const;
+    // Function: Same as GetRecommendations, returning movie IDs.
+    // Post:  Function value = the IDs Policy picked the movies under, so no
+    //        movie is looked up again and movies sharing a key keep their own IDs.
+
+    vector<Movie> RecommendTopRated(const Viewer& viewer, int k) const;
+    // Function: Gets the highest rated unwatched movies in the Viewer's preferred
+    //           genres or by the Viewer's favorite directors.
+    // Pre:   Hash table has been initialized.
+    // Post:  Function value = up to k movies ordered from highest to lowest
+    //        rating, ties going to the lowest ID; the same movies as
+    //        PopularityBlendedPolicy without a popularity source. Only the
+    //        fronts of the Viewer's rating lists are read, stopping once k
+    //        movies are found.
+
+    vector<MovieId> RecommendTopRatedIds(const Viewer& viewer, int k) const;
+    // Function: Same as RecommendTopRated, returning movie IDs.
+
+    vector<Movie> NextRecommendations(const Viewer& viewer, RecommendationCursor& cursor, int pageSize) const;
+    // Function: Gets the next page of a Viewer's top rated recommendations.
+    // Pre:   cursor is new or was last used for the same Viewer.
+    // Post:  Function value = up to pageSize movies that follow the cursor in
+    //        RecommendTopRated's order, and cursor has moved past them (done
+    //        once nothing is left). Each page resumes every rating list with
+    //        a binary search at the cursor, so a deep page costs about as
+    //        much as the first one. A movie whose rating changes after it was
+    //        passed may be shown again or skipped.
+
+    vector<MovieId> NextRecommendationIds(const Viewer& viewer, RecommendationCursor& cursor, int pageSize) const;
+    // Function: Same as NextRecommendations, returning movie IDs.
+
+    void PrintRecommendations(const Viewer& viewer, const vector<Movie>& recommended) const;
+    // Function: Displays a list of recommended movies.
+    // Pre:   recommended is ordered from best to worst.
+    // Post:  The recommendations for the Viewer are displayed.
+
+    void SortRecommendations(vector<Movie>& recommendedList) const;
+    // Function: Sorts a list of recommended movies by rating (highest to lowest).
+    // Pre:  The recommended list contains unsorted Movie objects.
+    // Post: Movies in the list are now ordered from highest to lowest rating.
+
+    bool IsPreferredGenre(const Viewer& viewer, const string& movie_genre) const;
+    // Function: Checks if a given movie genre is one of Viewer's preferred genres.
+    // Pre:  Viewer object has been initialized.
+    // Post: Returns true if the genre is in the Viewer's preferred genres.
+    //       Otherwise, returns false.
+
+    bool IsFavoriteDirector(const Viewer& viewer, const string& movie_director) const;
+    // Function: Checks if a given director is one of Viewer's favorite directors.
+    // Pre:  Viewer object has been initialized.
+    // Post: Returns true if the director is in the Viewer's favorite directors.
+    //       Otherwise, returns false.
+
+    bool IsMovieWatched(const Viewer& viewer, const string& movie_title) const;
+    // Function: Checks if a Viewer has already seen a given movie.
+    // Pre:  Viewer object has been initialized.
+    // Post: Returns true if the movie appears in the Viewer's watchlist.
+    //       Otherwise, returns false.
+
+private:
+    int FindEntry(const Movie& searchMovie, uint64_t hash) const;
+    // Function: Finds the entry whose key matches searchMovie's key.
+    // Post: Function value = entry number, or NO_ENTRY if there is none.
+
+    MovieId PlaceMovie(const Movie& movie, MovieId id);
+    // Function: Stores a movie in entry id and in every index.
+    // Pre:  Hash table is not full and entry id holds no movie.
+    // Post: Function value = id.
+
+    template <class Policy>
+    void OfferCandidates(Policy& policy, const Viewer& viewer) const;
+    // Function: Offers Policy every movie of GetCandidateSet with its ID.
+    // Post: The candidates were offered in ID order.
+
+    void IndexEntry(int entry);
+    // Function: Adds an entry to its genre's and director's rating lists.
+
+    void UnindexEntry(int entry);
+    // Function: Removes an entry from its genre's and director's rating lists.
+
+    void ReleaseEntry(int entry);
+    // Function: Clears an entry whose slot was erased.
+    // Post: The entry is out of every index; the table rehashes if tombstones
+    //       have pushed it past its load limit.
+
+    void Rehash(int slots);
+    // Function: Reinserts every live entry into fresh slots.
+    // Pre:  slots >= the capacity the probing policy was last reset for.
+    // Post: The probing policy holds no tombstones; IDs are unchanged.
+    //       Whenever a probe sequence has no free slot, the slots grow and
+    //       every entry is placed again, so no live entry is unreachable.
+
+    int capacity;  // number of movies the table was sized for
+    int slotCapacity;  // capacity the probing policy was last reset for
+    int numItems;  // number of items in the hash table
+    unsigned long int numCollisions;  // number of collisions encountered
+    Probing probing;        // slots mapping keys to entries
+    vector<Movie> entries;  // Movies indexed by ID; deleted entries are cleared
+    vector<bool> live;      // tracks which entries still hold a movie
+    unordered_map<string, vector<MovieId>> titleIds;  // title -> IDs of its movies, ascending
+    unordered_map<string, RatingList> genreLists;     // genre -> its movies by rating
+    unordered_map<string, RatingList> directorLists;  // director -> their movies by rating
+    unordered_map<string, RoaringBitmap> genreSets;    // genre -> IDs of its movies
+    unordered_map<string, RoaringBitmap> directorSets; // director -> IDs of their movies
+};
+
+typedef BasicHashType<QuadraticProbing> HashType;
+typedef BasicHashType<RobinHoodProbing> RobinHoodHashType;
+typedef BasicHashType<SwissProbing> SwissHashType;
+
+string MovieKey(const string& movie_title, int movie_year, const string& movie_genre) {
+    // Function: Builds the key a movie is hashed by.
+    // Post: Function value = title, year and genre run together.
+    return movie_title + to_string(movie_year) + movie_genre;
+}
+
+bool SameMovieKey(const Movie& a, const Movie& b) {
+    // Function: Checks whether two movies have the same key.
+    // Post: Returns true if title, year and genre all match.
+    return a.GetTitle() == b.GetTitle() && a.GetYear() == b.GetYear() && a.GetGenre() == b.GetGenre();
+}
+
+// Class constructor
+template <class Probing>
+BasicHashType<Probing>::BasicHashType(int capacity) : capacity(max(1, capacity)) {
+    numItems = 0;
+    numCollisions = 0;
+    slotCapacity = this->capacity;
+    probing.Reset(slotCapacity);
+}
+
+template <class Probing>
+void BasicHashType<Probing>::MakeEmpty() {
+    // Function: Returns the hash table to the empty state.
+    // Post:  Hash table is empty.
+    numItems = 0;  // set number of hash table items to 0
+    numCollisions = 0;
+    slotCapacity = capacity;
+    probing.Reset(slotCapacity);  // make slots in the hash table empty
+    entries.clear();
+    live.clear();
+    titleIds.clear();
+    genreLists.clear();
+    directorLists.clear();
+    genreSets.clear();
+    directorSets.clear();
+}
+
+template <class Probing>
+bool BasicHashType<Probing>::IsFull() const {
+    // Function:  Determines whether hash table is full.
+    // Pre:  Hash table has been initialized.
+    // Post: Function value = (hash table is full)
+    return (numItems >= GetMaxItems());
+}
+
+template <class Probing>
+int BasicHashType<Probing>::GetMaxItems() const {
+    // Function: Determines how many movies the hash table can hold.
+    // Pre:  Hash table has been initialized.
+    // Post: Function value = number of movies at which the table is full.
+    return min(capacity, probing.GetMaxItems());
+}
+
+template <class Probing>
+int BasicHashType<Probing>::GetNumItems() const {
+    // Function: Determines the number of elements in the hash table.
+    // Pre:  Hash table has been initialized.
+    // Post: Function value = number of elements in the hash table
+    return numItems;
+}
+
+template <class Probing>
+int BasicHashType<Probing>::GetNumSlots() const {
+    // Function: Determines the number of slots the probing policy allocated.
+    // Pre:  Hash table has been initialized.
+    // Post: Function value = number of slots (load factor = items / slots)
+    return probing.GetNumSlots();
+}
+
+template <class Probing>
+unsigned long int BasicHashType<Probing>::GetNumCollisions() const {
+    // Function: Gets the number of collisions met by insertions so far.
+    // Pre:  Hash table has been initialized.
+    // Post: Function value = slots probed past each inserted movie's home slot
+    return numCollisions;
+}
+
+template <class Probing>
+vector<Movie> BasicHashType<Probing>::GetMovies() const {
+    // Function: Gets all Movie objects stored in the hash table.
+    // Pre: Hash table has been initialized.
+    // Post: Returns a vector containing all stored Movie objects.
+    vector<Movie> movieList;
+
+    // Loop over the entries and add the live ones to the movieList vector
+    for (size_t i = 0; i < entries.size(); i++) {
+        if (live[i])
+            movieList.push_back(entries[i]);
+    }
+    return movieList;
+}
+
+/* This is the hash function for this class */
+template <class Probing>
+int BasicHashType<Probing>::Hash(string movie_title, int movie_year, string movie_genre) const {
+    // Function: Computes a hash value for a Movie based on its title, year, and genre.
+    // Pre:  Hash table has been initialized.
+    // Post: Returns an int representing the home slot of the Movie object.
+    TRACE_SPAN("Hash");
+    return probing.HomeSlot(probing.HashKey(MovieKey(movie_title, movie_year, movie_genre)));
+}
+
+template <class Probing>
+MovieId BasicHashType<Probing>::InsertMovie(const Movie& movie) {
+    // Function: Adds Movie to hash table and uses the probing policy to
+    //           resolve collisions.
+    // Pre:  Hash table has been initialized.
+    //       Hash table is not full.
+    // Post: Movie object is in hash table.
+    //       Function value = the movie's new ID (IDs count up from 0 after
+    //       MakeEmpty), or NO_MOVIE if it could not be added.
+    TRACE_SPAN("InsertMovie");
+    METRIC_LATENCY("InsertMovie");
+    if (IsFull()) {
+        cout << "Hash table is full." << endl;
+        return NO_MOVIE;
+    }
+    return PlaceMovie(movie, GetNextId());
+}
+
+template <class Probing>
+MovieId BasicHashType<Probing>::RestoreMovie(const Movie& movie, MovieId id) {
+    // Function: Adds Movie to hash table under a given ID, as when a saved
+    //           catalog is loaded back.
+    // Pre:  Hash table has been initialized.
+    //       Hash table is not full and no movie in it has id.
+    // Post: Movie object is in hash table under id; InsertMovie gives only
+    //       IDs above it from now on.
+    //       Function value = id, or NO_MOVIE if it could not be added.
+    if (IsFull()) {
+        cout << "Hash table is full." << endl;
+        return NO_MOVIE;
+    }
+    if (id == NO_MOVIE || HasMovie(id))
+        return NO_MOVIE;
+    ReserveIds(id + 1);
+    return PlaceMovie(movie, id);
+}
+
+template <class Probing>
+MovieId BasicHashType<Probing>::GetNextId() const {
+    // Function: Determines the ID the next inserted movie will get.
+    // Post: Function value = one past the highest ID given or reserved
+    //       since MakeEmpty (0 if none).
+    return static_cast<MovieId>(entries.size());
+}
+
+template <class Probing>
+void BasicHashType<Probing>::ReserveIds(MovieId next) {
+    // Function: Keeps InsertMovie from giving any ID below next.
+    // Post: GetNextId() >= next.
+    // IDs skipped over are left as cleared entries, as if deleted
+    if (next > entries.size()) {
+        entries.resize(next);
+        live.resize(next, false);
+    }
+}
+
+template <class Probing>
+MovieId BasicHashType<Probing>::PlaceMovie(const Movie& movie, MovieId id) {
+    // Function: Stores a movie in entry id and in every index.
+    // Pre:  Hash table is not full and entry id holds no movie.
+    // Post: Function value = id.
+    string key = MovieKey(movie.GetTitle(), movie.GetYear(), movie.GetGenre());
+    int collisions = probing.Insert(probing.HashKey(key), static_cast<int>(id));
+    while (collisions < 0) {
+        // No free slot on the movie's probe sequence: grow the slots and try again
+        Rehash(slotCapacity * 2 + 1);
+        collisions = probing.Insert(probing.HashKey(key), static_cast<int>(id));
+    }
+    numCollisions += collisions;
+    ReserveIds(id + 1);
+    entries[id] = movie;
+    live[id] = true;
+    vector<MovieId>& sameTitle = titleIds[movie.GetTitle()];
+    sameTitle.insert(upper_bound(sameTitle.begin(), sameTitle.end(), id), id);
+    genreSets[movie.GetGenre()].Add(id);
+    directorSets[movie.GetDirector()].Add(id);
+    IndexEntry(static_cast<int>(id));
+    numItems++;
+    return id;
+}
+
+template <class Probing>
+int BasicHashType<Probing>::FindEntry(const Movie& searchMovie, uint64_t hash) const {
+    // Function: Finds the entry whose key matches searchMovie's key.
+    // Post: Function value = entry number, or NO_ENTRY if there is none.
+    return probing.Find(hash, [&](int entry) { return SameMovieKey(entries[entry], searchMovie); });
+}
+
+template <class Probing>
+MovieId BasicHashType<Probing>::FindMovieId(const Movie& searchMovie) const {
+    // Function: Finds the ID of the element whose key matches searchMovie's key.
+    // Pre:  Hash table has been initialized.
+    // Post: Function value = the movie's ID, or NO_MOVIE if there is none.
+    uint64_t hash = probing.HashKey(MovieKey(searchMovie.GetTitle(), searchMovie.GetYear(), searchMovie.GetGenre()));
+    int entry = FindEntry(searchMovie, hash);
+    return entry == NO_ENTRY ? NO_MOVIE : static_cast<MovieId>(entry);
+}
+
+template <class Probing>
+MovieId BasicHashType<Probing>::ResolveTitle(const string& movie_title, int movie_year) const {
+    // Function: Finds the ID of a movie by its title, and its year when given.
+    // Pre:  Hash table has been initialized.
+    // Post: Function value = ID of the matching movie. When several movies
+    //       match (remakes, or one title in several genres), the most
+    //       recent release wins, then the highest ID. NO_MOVIE if none match.
+    MovieId best = NO_MOVIE;
+    for (MovieId id : FindTitle(movie_title)) {
+        int year = entries[id].GetYear();
+        if ((movie_year == -1 || year == movie_year) && (best == NO_MOVIE || year >= entries[best].GetYear()))
+            best = id;
+    }
+    return best;
+}
+
+template <class Probing>
+vector<MovieId> BasicHashType<Probing>::FindTitle(const string& movie_title) const {
+    // Function: Finds every movie with a given title.
+    // Pre:  Hash table has been initialized.
+    // Post: Function value = IDs of the matching movies in ascending order.
+    typename unordered_map<string, vector<MovieId>>::const_iterator found = titleIds.find(movie_title);
+    return found == titleIds.end() ? vector<MovieId>() : found->second;
+}
+
+template <class Probing>
+bool BasicHashType<Probing>::HasMovie(MovieId id) const {
+    // Function: Checks whether an ID belongs to a movie in the table.
+    // Post: Returns true if id was given by InsertMovie or RestoreMovie and
+    //       not deleted since.
+    return id < entries.size() && live[id];
+}
+
+template <class Probing>
+const Movie& BasicHashType<Probing>::GetMovie(MovieId id) const {
+    // Function: Gets the movie with a given ID.
+    // Pre:  HasMovie(id).
+    // Post: Function value = the movie.
+    return entries[id];
+}
+
+template <class Probing>
+vector<MovieId> BasicHashType<Probing>::GetWatchedIds(const Viewer& viewer) const {
+    // Function: Collects the IDs of every movie a Viewer has seen.
+    // Pre:  Hash table has been initialized.
+    // Post: Function value = the Viewer's watched movie IDs together with the
+    //       IDs of every movie titled like a watchlist entry, ascending and
+    //       without repeats.
+    return GetWatchedSet(viewer).ToVector();
+}
+
+template <class Probing>
+RoaringBitmap BasicHashType<Probing>::GetWatchedSet(const Viewer& viewer) const {
+    // Function: Same as GetWatchedIds, as a compressed set.
+    if (viewer.GetWatchlist().empty())
+        return viewer.GetWatchedSet();
+    RoaringBitmap watched = viewer.GetWatchedSet();
+    for (const string& title : viewer.GetWatchlist()) {
+        typename unordered_map<string, vector<MovieId>>::const_iterator found = titleIds.find(title);
+        if (found != titleIds.end()) {
+            for (MovieId id : found->second)
+                watched.Add(id);
+        }
+    }
+    return watched;
+}
+
+template <class Probing>
+RoaringBitmap BasicHashType<Probing>::GetCandidateSet(const Viewer& viewer) const {
+    // Function: Collects the unwatched movies in the Viewer's preferred genres
+    //           or by the Viewer's favorite directors.
+    // Pre:  Hash table has been initialized.
+    // Post: Function value = IDs of those movies: the union of the Viewer's
+    //       genre and director sets with the watched set subtracted in one
+    //       AndNot.
+    TRACE_SPAN("GetCandidateSet");
+    METRIC_LATENCY("GetCandidateSet");
+    RoaringBitmap candidates;
+    for (const string& genre : viewer.GetPreferredGenres()) {
+        typename unordered_map<string, RoaringBitmap>::const_iterator found = genreSets.find(genre);
+        if (found != genreSets.end())
+            candidates = candidates.IsEmpty() ? found->second : candidates.Or(found->second);
+    }
+    for (const string& director : viewer.GetFavoriteDirectors()) {
+        typename unordered_map<string, RoaringBitmap>::const_iterator found = directorSets.find(director);
+        if (found != directorSets.end())
+            candidates = candidates.IsEmpty() ? found->second : candidates.Or(found->second);
+    }
+    return candidates.AndNot(GetWatchedSet(viewer));
+}
+
+template <class Probing>
+void BasicHashType<Probing>::RetrieveMovie(const Movie& searchMovie, bool& found, Movie& retrievedMovie) const {
+    // Function: Retrieves hash table element whose key matches searchMovie's key (if
+    //           present).
+    // Pre:  Hash table has been initialized.
+    //       Key member of retrievedMovie is initialized.
+    // Post: If there is a movie retrievedMovie whose value matches
+    //       searchMovie's value, then found = true and searchMovie contains 
+    //       the contents of retrievedMovie if it is found.
+    // 	     otherwise found = false and searchMovie is returned unchanged.
+    //       Hash table is unchanged.
+    TRACE_SPAN("RetrieveMovie");
+    METRIC_LATENCY("RetrieveMovie");
+    uint64_t hash = probing.HashKey(MovieKey(searchMovie.GetTitle(), searchMovie.GetYear(), searchMovie.GetGenre()));
+    int entry = FindEntry(searchMovie, hash);
+
+    found = entry != NO_ENTRY;
+    // If movie is not found, return default empty Movie object
+    retrievedMovie = found ? entries[entry] : Movie();
+}
+
+template <class Probing>
+void BasicHashType<Probing>::RetrieveMany(const vector<Movie>& searchMovies, vector<bool>& found,
+    vector<Movie>& retrievedMovies) const {
+    // Function: Retrieves the elements matching a batch of keys.
+    // Pre:  Hash table has been initialized.
+    // Post: found and retrievedMovies have one element per search movie, set
+    //       as RetrieveMovie would set them. Hash table is unchanged.
+    TRACE_SPAN("RetrieveMany");
+    METRIC_LATENCY("RetrieveMany");
+    vector<MovieId> ids = FindMovieIds(searchMovies);
+    found.assign(ids.size(), false);
+    retrievedMovies.assign(ids.size(), Movie());
+    for (size_t i = 0; i < ids.size(); i++) {
+        if (ids[i] != NO_MOVIE) {
+            found[i] = true;
+            retrievedMovies[i] = entries[ids[i]];
+        }
+    }
+}
+
+template <class Probing>
+vector<MovieId> BasicHashType<Probing>::FindMovieIds(const vector<Movie>& searchMovies) const {
+    // Function: Finds the IDs of the elements matching a batch of keys.
+    // Pre:  Hash table has been initialized.
+    // Post: Function value = one ID per search movie, NO_MOVIE where no
+    //       element matches. Keys are hashed and their slots and entries
+    //       prefetched a window at a time, so the cache misses of
+    //       neighbouring lookups overlap instead of following each other.
+    TRACE_SPAN("FindMovieIds");
+    METRIC_LATENCY("FindMovieIds");
+    size_t count = searchMovies.size();
+    vector<MovieId> ids(count, NO_MOVIE);
+    uint64_t hashes[LOOKUP_WINDOW];
+    int candidates[LOOKUP_WINDOW];
+
+    for (size_t start = 0; start < count; start += LOOKUP_WINDOW) {
+        int n = static_cast<int>(min(count - start, static_cast<size_t>(LOOKUP_WINDOW)));
+        const Movie* batch = &searchMovies[start];
+
+        // 1. Hash every key and start loading its home slots
+        for (int i = 0; i < n; i++) {
+            hashes[i] = probing.HashKey(MovieKey(batch[i].GetTitle(), batch[i].GetYear(), batch[i].GetGenre()));
+            probing.Prefetch(hashes[i]);
+        }
+        // 2. Read the slots and start loading the likeliest entries
+        for (int i = 0; i < n; i++) {
+            candidates[i] = probing.PeekEntry(hashes[i]);
+            if (candidates[i] != NO_ENTRY)
+                __builtin_prefetch(&entries[candidates[i]]);
+        }
+        // 3. Start loading the candidates' titles, which live outside the entry
+        for (int i = 0; i < n; i++) {
+            if (candidates[i] != NO_ENTRY)
+                __builtin_prefetch(entries[candidates[i]].GetTitle().data());
+        }
+        // 4. Finish every probe sequence; most now hit the cache
+        for (int i = 0; i < n; i++) {
+            int entry = FindEntry(batch[i], hashes[i]);
+            ids[start + i] = entry == NO_ENTRY ? NO_MOVIE : static_cast<MovieId>(entry);
+        }
+    }
+    return ids;
+}
+
+template <class Probing>
+void BasicHashType<Probing>::DeleteMovie(Movie movie) {
+    // Function: Deletes the element whose key matches movie's key.
+    // Pre:  Hash table has been initialized.
+    //       Key member of movie is initialized.
+    //       One and only one element in hash table has a key matching movie's key.
+    // Post: No element in hash table has a key matching movie's key.
+    TRACE_SPAN("DeleteMovie");
+    METRIC_LATENCY("DeleteMovie");
+    uint64_t hash = probing.HashKey(MovieKey(movie.GetTitle(), movie.GetYear(), movie.GetGenre()));
+    int entry = probing.Erase(hash, [&](int e) { return SameMovieKey(entries[e], movie); });
+    if (entry == NO_ENTRY) {
+        cout << "Movie to delete not found." << endl;
+        return;
+    }
+    ReleaseEntry(entry);
+}
+
+template <class Probing>
+void BasicHashType<Probing>::DeleteMovieId(MovieId id) {
+    // Function: Deletes the movie with a given ID.
+    // Pre:  HasMovie(id).
+    // Post: The movie is gone; its ID is not given to another movie.
+    TRACE_SPAN("DeleteMovie");
+    METRIC_LATENCY("DeleteMovie");
+    const Movie& movie = entries[id];
+    uint64_t hash = probing.HashKey(MovieKey(movie.GetTitle(), movie.GetYear(), movie.GetGenre()));
+    int entry = probing.Erase(hash, [&](int e) { return e == static_cast<int>(id); });
+    if (entry == NO_ENTRY) {
+        cout << "Movie to delete not found." << endl;
+        return;
+    }
+    ReleaseEntry(entry);
+}
+
+template <class Probing>
+void BasicHashType<Probing>::ReleaseEntry(int entry) {
+    // Function: Clears an entry whose slot was erased.
+    // Post: The entry is out of every index; the table rehashes if tombstones
+    //       have pushed it past its load limit.
+    // clear the entry; its ID is not given to another movie
+    UnindexEntry(entry);
+    vector<MovieId>& sameTitle = titleIds[entries[entry].GetTitle()];
+    sameTitle.erase(find(sameTitle.begin(), sameTitle.end(), static_cast<MovieId>(entry)));
+    if (sameTitle.empty())
+        titleIds.erase(entries[entry].GetTitle());
+    genreSets[entries[entry].GetGenre()].Remove(static_cast<MovieId>(entry));
+    directorSets[entries[entry].GetDirector()].Remove(static_cast<MovieId>(entry));
+    entries[entry] = Movie();
+    live[entry] = false;
+    numItems--;
+    if (probing.NeedsRehash(numItems))
+        Rehash(slotCapacity);
+}
+
+template <class Probing>
+void BasicHashType<Probing>::UpdateRating(const Movie& movie, double rating) {
+    // Function: Changes the rating of the element whose key matches movie's key.
+    // Pre:  Hash table has been initialized.
+    //       Key member of movie is initialized.
+    // Post: The matching movie has the new rating and the rating lists are
+    //       reordered. Prints an error if no movie matches.
+    TRACE_SPAN("UpdateRating");
+    METRIC_LATENCY("UpdateRating");
+    int entry = FindEntry(movie, probing.HashKey(MovieKey(movie.GetTitle(), movie.GetYear(), movie.GetGenre())));
+    if (entry == NO_ENTRY) {
+        cout << "Movie to update not found." << endl;
+        return;
+    }
+    UnindexEntry(entry);
+    entries[entry].SetRating(rating);
+    IndexEntry(entry);
+}
+
+template <class Probing>
+void BasicHashType<Probing>::IndexEntry(int entry) {
+    // Function: Adds an entry to its genre's and director's rating lists.
+    pair<double, int> key(-entries[entry].GetRating(), entry);
+    genreLists[entries[entry].GetGenre()].insert(key);
+    directorLists[entries[entry].GetDirector()].insert(key);
+}
+
+template <class Probing>
+void BasicHashType<Probing>::UnindexEntry(int entry) {
+    // Function: Removes an entry from its genre's and director's rating lists.
+    pair<double, int> key(-entries[entry].GetRating(), entry);
+    genreLists[entries[entry].GetGenre()].erase(key);
+    directorLists[entries[entry].GetDirector()].erase(key);
+}
+
+template <class Probing>
+void BasicHashType<Probing>::Rehash(int slots) {
+    // Function: Reinserts every live entry into fresh slots.
+    // Pre:  slots >= the capacity the probing policy was last reset for.
+    // Post: The probing policy holds no tombstones; IDs are unchanged.
+    //       Whenever a probe sequence has no free slot, the slots grow and
+    //       every entry is placed again, so no live entry is unreachable.
+    TRACE_SPAN("Rehash");
+    bool placed = false;
+    while (!placed) {
+        probing.Reset(slots);
+        placed = true;
+        for (size_t id = 0; placed && id < entries.size(); id++) {
+            if (live[id]) {
+                const Movie& movie = entries[id];
+                placed = probing.Insert(probing.HashKey(MovieKey(movie.GetTitle(), movie.GetYear(), movie.GetGenre())),
+                    static_cast<int>(id)) >= 0;
+            }
+        }
+        if (!placed)
+            slots = slots * 2 + 1;  // keeps a size of the form 4k+3 in that form
+    }
+    slotCapacity = slots;
+}
+
+template <class Probing>
+void BasicHashType<Probing>::RecommendMovies(const Viewer& viewer) const {
+    // Function: Gives personalized movie recommendations for a Viewer.
+    // Pre:   Hash table has been initialized.
+    //        Viewer preferences are available (favorite directors and/or preferred genres).
+    // Post:  Display a list of recommended movies based on the Viewer's 
+    //        preferred genres, favorite directors, and watchlist.
+    TRACE_SPAN("RecommendMovies");
+    METRIC_LATENCY("RecommendMovies");
+    cout << "\nFetching Movie Recommendations for " << viewer.GetViewerName() << "..." << endl;
+
+    vector<Movie> recommended =
+        GetRecommendations<TieredPolicy>(viewer, ScoringContext(), NUM_RECOMMENDATIONS);
+    PrintRecommendations(viewer, recommended);
+}
+
+template <class Probing>
+template <class Policy>
+vector<Movie> BasicHashType<Probing>::GetRecommendations(const Viewer& viewer, const ScoringContext& context, int k) const {
+    // Function: Scans the hash table and lets Policy pick up to k recommendations.
+    // Pre:   Hash table has been initialized.
+    //        Policy follows the interface described in ScoringPolicy.h.
+    // Post:  Function value = the movies chosen by Policy among the movies
+    //        of GetCandidateSet, offered to Policy in ID order.
+    TRACE_SPAN("GetRecommendations");
+    METRIC_LATENCY("GetRecommendations");
+    Policy policy(viewer, context, k);
+    OfferCandidates(policy, viewer);
+
+    TRACE_SPAN("SortRecommendations");
+    return policy.Results();
+}
+
+template <class Probing>
+template <class Policy>
+void BasicHashType<Probing>::OfferCandidates(Policy& policy, const Viewer& viewer) const {
+    // Function: Offers Policy every movie of GetCandidateSet with its ID.
+    // Post: The candidates were offered in ID order.
+    RoaringBitmap candidates = GetCandidateSet(viewer);
+
+    // Loop over the unwatched movies the policies can pick from, in ID order
+    TRACE_SPAN("ScanCandidates");
+    candidates.ForEach([&](uint32_t id) { policy.Consider(entries[id], id); });
+}
+
+template <class Probing>
+template <class Policy>
+vector<MovieId> BasicHashType<Probing>::GetRecommendationIdsFrom(const vector<MovieId>& candidates, const Viewer& viewer,
+    const ScoringContext& context, int k) const {
+    // Function: Lets Policy pick up to k recommendations from given movies.
+    // Pre:   Every ID in candidates names a movie in the table.
+    //        Policy follows the interface described in ScoringPolicy.h.
+    // Post:  Function value = the IDs of the movies chosen by Policy, offered
+    //        to it in the order of candidates without being copied. The
+    //        caller has already left out the movies the Viewer has seen.
+    TRACE_SPAN("GetRecommendationIdsFrom");
+    Policy policy(viewer, context, k);
+    for (MovieId id : candidates)
+        policy.Consider(entries[id], id);
+    return policy.ResultIds();
+}
+
+template <class Probing>
+template <class Policy>
+vector<MovieId> BasicHashType<Probing>::GetRecommendationIds(const Viewer& viewer, const ScoringContext& context, int k) const {
+    // Function: Same as GetRecommendations, returning movie IDs.
+    // Post:  Function value = the IDs Policy picked the movies under, so no
+    //        movie is looked up again and movies sharing a key keep their own IDs.
+    TRACE_SPAN("GetRecommendationIds");
+    METRIC_LATENCY("GetRecommendations");
+    Policy policy(viewer, context, k);
+    OfferCandidates(policy, viewer);
+
+    TRACE_SPAN("SortRecommendations");
+    return policy.ResultIds();
+}
+
+template <class Probing>
+vector<Movie> BasicHashType<Probing>::RecommendTopRated(const Viewer& viewer, int k) const {
+    // Function: Gets the highest rated unwatched movies in the Viewer's preferred
+    //           genres or by the Viewer's favorite directors.
+    // Pre:   Hash table has been initialized.
+    // Post:  Function value = up to k movies ordered from highest to lowest
+    //        rating, ties going to the lowest ID; the same movies as
+    //        PopularityBlendedPolicy without a popularity source. Only the
+    //        fronts of the Viewer's rating lists are read, stopping once k
+    //        movies are found.
+    vector<Movie> recommended;
+    for (MovieId id : RecommendTopRatedIds(viewer, k))
+        recommended.push_back(entries[id]);
+    return recommended;
+}
+
+template <class Probing>
+vector<MovieId> BasicHashType<Probing>::RecommendTopRatedIds(const Viewer& viewer, int k) const {
+    // Function: Same as RecommendTopRated, returning movie IDs.
+    RecommendationCursor cursor;
+    return NextRecommendationIds(viewer, cursor, k);
+}
+
+template <class Probing>
+vector<Movie> BasicHashType<Probing>::NextRecommendations(const Viewer& viewer, RecommendationCursor& cursor,
+    int pageSize) const {
+    // Function: Gets the next page of a Viewer's top rated recommendations.
+    // Pre:   cursor is new or was last used for the same Viewer.
+    // Post:  Function value = up to pageSize movies that follow the cursor in
+    //        RecommendTopRated's order, and cursor has moved past them (done
+    //        once nothing is left). Each page resumes every rating list with
+    //        a binary search at the cursor, so a deep page costs about as
+    //        much as the first one. A movie whose rating changes after it was
+    //        passed may be shown again or skipped.
+    vector<Movie> page;
+    for (MovieId id : NextRecommendationIds(viewer, cursor, pageSize))
+        page.push_back(entries[id]);
+    return page;
+}
+
+template <class Probing>
+vector<MovieId> BasicHashType<Probing>::NextRecommendationIds(const Viewer& viewer, RecommendationCursor& cursor,
+    int pageSize) const {
+    // Function: Same as NextRecommendations, returning movie IDs.
+    TRACE_SPAN("RecommendTopRated");
+    METRIC_LATENCY("RecommendTopRated");
+    vector<MovieId> recommended;
+    if (cursor.done)
+        return recommended;
+
+    // One cursor per preferred genre and favorite director list, placed just
+    // after the last movie the previous page passed
+    vector<pair<RatingList::const_iterator, RatingList::const_iterator>> cursors;
+    for (const string& genre : viewer.GetPreferredGenres()) {
+        typename unordered_map<string, RatingList>::const_iterator list = genreLists.find(genre);
+        if (list == genreLists.end())
+            continue;
+        RatingList::const_iterator front = list->second.upper_bound(cursor.last);
+        if (front != list->second.end())
+            cursors.push_back(make_pair(front, list->second.end()));
+    }
+    for (const string& director : viewer.GetFavoriteDirectors()) {
+        typename unordered_map<string, RatingList>::const_iterator list = directorLists.find(director);
+        if (list == directorLists.end())
+            continue;
+        RatingList::const_iterator front = list->second.upper_bound(cursor.last);
+        if (front != list->second.end())
+            cursors.push_back(make_pair(front, list->second.end()));
+    }
+
+    RoaringBitmap watched = GetWatchedSet(viewer);
+    while (static_cast<int>(recommended.size()) < pageSize && !cursors.empty()) {
+        // Take the best front among the cursors
+        pair<double, int> best = *cursors[0].first;
+        for (size_t i = 1; i < cursors.size(); i++)
+            best = min(best, *cursors[i].first);
+        cursor.last = best;
+
+        // Advance every cursor at that movie (a movie can be in a genre list
+        // and a director list) and drop the cursors that run out
+        for (size_t i = 0; i < cursors.size();) {
+            if (*cursors[i].first == best && ++cursors[i].first == cursors[i].second) {
+                cursors[i] = cursors.back();
+                cursors.pop_back();
+            }
+            else
+                i++;
+        }
+
+        MovieId id = static_cast<MovieId>(best.second);
+        if (!watched.Contains(id))
+            recommended.push_back(id);
+    }
+    cursor.done = cursors.empty();
+    return recommended;
+}
+
+template <class Probing>
+void BasicHashType<Probing>::PrintRecommendations(const Viewer& viewer, const vector<Movie>& recommended) const {
+    // Function: Displays a list of recommended movies.
+    // Pre:   recommended is ordered from best to worst.
+    // Post:  The recommendations for the Viewer are displayed.
+    TRACE_SPAN("PrintRecommendations");
+    int n = static_cast<int>(recommended.size());
+
+    if (n == 0)
+        cout << "\nSorry! No movies available match the viewer's preferences." << endl;
+    else {
+        cout << "\nTop " << n << " Movie Recommendations for " << viewer.GetViewerName() << ": " << endl;
+        for (int i = 0; i < n; i++) {
+            recommended[i].Print();  // print recommendations
+        }
+    }
+    cout << "*******************************************************" << endl;
+}
+
+template <class Probing>
+void BasicHashType<Probing>::SortRecommendations(vector<Movie>& recommendedList) const {
+    // Function: Sorts a list of recommended movies by rating (highest to lowest).
+    // Pre:  The recommended list contains unsorted Movie objects.
+    // Post: Movies in the list are now ordered from highest to lowest rating.
+    int length = static_cast<int>(recommendedList.size());
+
+    // Bubble sort
+    for (int i = 0; i < length - 1; i++) {
+        for (int j = 0; j < length - i - 1; j++) {
+            if (recommendedList[j].GetRating() < recommendedList[j + 1].GetRating())
+                swap(recommendedList[j], recommendedList[j + 1]);
+        }
+    }
+}
+
+template <class Probing>
+bool BasicHashType<Probing>::IsPreferredGenre(const Viewer& viewer, const string& movie_genre) const {
+    // Function: Checks if a given movie genre is one of Viewer's preferred genres.
+    // Pre:  Viewer object has been initialized.
+    // Post: Returns true if the genre is in the Viewer's preferred genres.
+    //       Otherwise, returns false.
+    for (const string& genre : viewer.GetPreferredGenres()) {
+        if (genre == movie_genre)
+            return true;
+    }
+    return false;
+}
+
+template <class Probing>
+bool BasicHashType<Probing>::IsFavoriteDirector(const Viewer& viewer, const string& movie_director) const {
+    // Function: Checks if a given director is one of Viewer's favorite directors.
+    // Pre:  Viewer object has been initialized.
+    // Post: Returns true if the director is in the Viewer's favorite directors.
+    //       Otherwise, returns false.
+    for (const string& director : viewer.GetFavoriteDirectors()) {
+        if (director == movie_director)
+            return true;
+    }
+    return false;
+}
+
+template <class Probing>
+bool BasicHashType<Probing>::IsMovieWatched(const Viewer& viewer, const string& movie_title) const {
+    // Function: Checks if a Viewer has already seen a given movie.
+    // Pre:  Viewer object has been initialized.
+    // Post: Returns true if the movie appears in the Viewer's watchlist.
+    //       Otherwise, returns false.
+    for (const string& watched : viewer.GetWatchlist()) {
+        if (watched == movie_title)
+            return true;
+    }
+    return false;
+}
 #endif
\ No newline at end of file
@@ -0,0 +1,257 @@
+/***********************************************************************************************
+ * Name:        LoadGeneratorDr.cpp
+ * Description: This driver load tests a running MovieServer. It replays viewer profiles as
+ *              REC requests at a fixed rate spread over several pipelined connections and
+ *              reports throughput and p50/p99/p999 latency. Requests are sent on a fixed
+ *              schedule whether or not earlier responses have arrived, and latency is measured
+ *              from each request's scheduled send time, so a stalled server shows up in the
+ *              tail instead of silently lowering the offered load.
+ *              Profiles are EncodeViewer records, one per line; without a profile file a
+ *              synthetic set of viewers is generated.
+ *              Usage: LoadGenerator [port] [qps] [seconds] [connections] [profileFile] [policy]
+***********************************************************************************************/
+#include <iostream>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "Viewer.h"
+#include "WireFormat.h"
+
+using namespace std;
+typedef chrono::steady_clock Clock;
+
+// Results gathered by one connection
+struct ConnectionStats {
+    vector<double> latencies;  // microseconds, one per answered request
+    long sent = 0;             // requests written
+    long errors = 0;           // ERR responses and unanswered requests
+    long protocolErrors = 0;   // response lines with no request waiting for them
+};
+
+// Function prototypes
+vector<Viewer> makeSyntheticViewers(int count);
+int connectToServer(int port);
+void runConnection(int port, const vector<string>& requests, int index, int connections,
+    double qps, double seconds, Clock::time_point start, ConnectionStats& stats);
+double percentile(const vector<double>& sorted, double fraction);
+
+int main(int argc, char* argv[]) {
+    int port = argc > 1 ? atoi(argv[1]) : 7070;
+    double qps = argc > 2 ? atof(argv[2]) : 1000.0;
+    double seconds = argc > 3 ? atof(argv[3]) : 10.0;
+    int connections = argc > 4 ? max(1, atoi(argv[4])) : 4;
+    string profileFile = argc > 5 ? argv[5] : "";
+    string policy = argc > 6 ? argv[6] : "tiered";
+
+    vector<Viewer> viewers = profileFile.empty() || profileFile == "-" ?
+        makeSyntheticViewers(1000) : ReadViewerProfiles(profileFile);
+    if (viewers.empty()) {
+        cerr << "Error: No viewer profiles to replay!" << endl;
+        return 1;
+    }
+
+    // Encode every request once so the send loop only writes bytes
+    vector<string> requests;
+    for (const Viewer& viewer : viewers)
+        requests.push_back("REC\t" + policy + "\t3\t" + EncodeViewer(viewer) + "\n");
+
+    cout << "Offering " << qps << " requests/second for " << seconds << " seconds over "
+        << connections << " connections (" << viewers.size() << " profiles, policy " << policy << ")..." << endl;
+
+    vector<ConnectionStats> stats(connections);
+    vector<thread> threads;
+    Clock::time_point start = Clock::now() + chrono::milliseconds(100);
+    for (int i = 0; i < connections; i++)
+        threads.push_back(thread(runConnection, port, cref(requests), i, connections, qps, seconds,
+            start, ref(stats[i])));
+    for (thread& t : threads)
+        t.join();
+    double elapsed = chrono::duration<double>(Clock::now() - start).count();
+
+    // Merge the per-connection results
+    vector<double> latencies;
+    long sent = 0, errors = 0, protocolErrors = 0;
+    for (const ConnectionStats& s : stats) {
+        latencies.insert(latencies.end(), s.latencies.begin(), s.latencies.end());
+        sent += s.sent;
+        errors += s.errors;
+        protocolErrors += s.protocolErrors;
+    }
+    sort(latencies.begin(), latencies.end());
+
+    cout << "Requests sent: " << sent << endl;
+    cout << "Responses: " << latencies.size() << " (" << errors << " errors)" << endl;
+    if (protocolErrors > 0)
+        cout << "Protocol errors: " << protocolErrors << " unexpected response lines" << endl;
+    cout << "Throughput: " << latencies.size() / elapsed << " responses/second" << endl;
+    if (!latencies.empty()) {
+        cout << "Latency p50: " << percentile(latencies, 0.50) << " us" << endl;
+        cout << "Latency p99: " << percentile(latencies, 0.99) << " us" << endl;
+        cout << "Latency p999: " << percentile(latencies, 0.999) << " us" << endl;
+        cout << "Latency max: " << latencies.back() << " us" << endl;
+    }
+    return errors == 0 && protocolErrors == 0 ? 0 : 1;
+}
+
+/**
+ * Builds viewers with random genre and director preferences and short watchlists.
+ *
+ * @param count The number of viewers to build.
+ * @return The generated viewers.
+ */
+vector<Viewer> makeSyntheticViewers(int count) {
+    const vector<string> genres = { "Drama", "Comedy", "Action", "Mystery", "Art&Foreign", "Romance",
+        "Horror", "SciFi", "Documentary", "Classics", "Kids&Family" };
+    const vector<string> directors = { "Steven Spielberg", "Joss Whedon", "Christopher Nolan",
+        "Alfred Hitchcock", "Woody Allen", "Martin Scorsese" };
+    const vector<string> titles = { "Jurassic Park", "Inception", "Frozen", "The Notebook",
+        "Toy Story 3", "Finding Nemo", "Serenity", "Psycho" };
+
+    mt19937 random(42);
+    vector<Viewer> viewers;
+    for (int i = 0; i < count; i++) {
+        Viewer viewer("Viewer" + to_string(i), 10 + static_cast<int>(random() % 60));
+        int numGenres = 1 + static_cast<int>(random() % 2);
+        for (int g = 0; g < numGenres; g++)
+            viewer.AddPreferredGenre(genres[random() % genres.size()]);
+        if (random() % 2 == 0)
+            viewer.AddFavoriteDirector(directors[random() % directors.size()]);
+        int numWatched = static_cast<int>(random() % 4);
+        for (int w = 0; w < numWatched; w++)
+            viewer.AddToWatchlist(titles[random() % titles.size()]);
+        viewers.push_back(viewer);
+    }
+    return viewers;
+}
+
+/**
+ * Opens a TCP connection to the server on the loopback interface.
+ *
+ * @param port The server's port.
+ * @return The connected socket, or -1 if the server could not be reached.
+ */
+int connectToServer(int port) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = htons(static_cast<uint16_t>(port));
+    if (connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+        close(fd);
+        return -1;
+    }
+    int noDelay = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+    return fd;
+}
+
+/**
+ * Sends this connection's share of the schedule and times every response.
+ * A sender thread writes requests at their scheduled times while this thread
+ * reads responses, which arrive in request order.
+ *
+ * @param port The server's port.
+ * @param requests The encoded requests to cycle through.
+ * @param index This connection's position among all connections.
+ * @param connections The number of connections sharing the load.
+ * @param qps The total offered rate, in requests per second.
+ * @param seconds How long to offer load.
+ * @param start When the first request is due.
+ * @param stats Where this connection's results are stored.
+ */
+void runConnection(int port, const vector<string>& requests, int index, int connections,
+    double qps, double seconds, Clock::time_point start, ConnectionStats& stats) {
+    int fd = connectToServer(port);
+    if (fd < 0) {
+        cerr << "Error: Could not connect to port " << port << "!" << endl;
+        return;
+    }
+
+    long total = static_cast<long>(qps * seconds / connections);
+    chrono::duration<double> interval(connections / qps);
+    mutex scheduleMutex;
+    deque<Clock::time_point> inFlight;  // scheduled send times of unanswered requests
+
+    thread sender([&]() {
+        for (long i = 0; i < total; i++) {
+            // Stagger the connections so their sends interleave evenly
+            Clock::time_point due = start + chrono::duration_cast<Clock::duration>(
+                interval * (i + static_cast<double>(index) / connections));
+            this_thread::sleep_until(due);
+            {
+                lock_guard<mutex> lock(scheduleMutex);
+                inFlight.push_back(due);
+            }
+            const string& request = requests[(i * connections + index) % requests.size()];
+            if (send(fd, request.data(), request.size(), MSG_NOSIGNAL) != static_cast<ssize_t>(request.size()))
+                break;
+            stats.sent++;
+        }
+        shutdown(fd, SHUT_WR);  // tell the server no more requests are coming
+    });
+
+    // Responses are "OK <n>" followed by n lines, or a single "ERR" line
+    string buffer;
+    char chunk[65536];
+    long linesToSkip = 0;
+    while (true) {
+        size_t newline;
+        while ((newline = buffer.find('\n')) != string::npos) {
+            string line = buffer.substr(0, newline);
+            buffer.erase(0, newline + 1);
+            if (linesToSkip > 0) {
+                linesToSkip--;
+                continue;
+            }
+
+            // A response with no request waiting for it means the stream is out
+            // of step, so it is counted rather than matched to a send time
+            Clock::time_point due;
+            {
+                lock_guard<mutex> lock(scheduleMutex);
+                if (inFlight.empty()) {
+                    stats.protocolErrors++;
+                    continue;
+                }
+                due = inFlight.front();
+                inFlight.pop_front();
+            }
+            if (line.compare(0, 3, "OK\t") == 0) {
+                linesToSkip = atol(line.c_str() + 3);
+                stats.latencies.push_back(chrono::duration<double, micro>(Clock::now() - due).count());
+            }
+            else
+                stats.errors++;
+        }
+
+        ssize_t n = recv(fd, chunk, sizeof(chunk), 0);
+        if (n <= 0)
+            break;
+        buffer.append(chunk, static_cast<size_t>(n));
+    }
+
+    sender.join();
+    stats.errors += static_cast<long>(inFlight.size());  // requests the server never answered
+    close(fd);
+}
+
+/**
+ * Picks a percentile from sorted samples.
+ *
+ * @param sorted The samples in ascending order.
+ * @param fraction The percentile as a fraction (0.99 for p99).
+ * @return The smallest sample at or above the percentile.
+ */
+double percentile(const vector<double>& sorted, double fraction) {
+    size_t rank = static_cast<size_t>(fraction * sorted.size());
+    return sorted[min(rank, sorted.size() - 1)];
+}
@@ -0,0 +1,492 @@
+/**
+ * Metrics.h
+ * Latency histograms for watching how fast the catalog loads and answers
+ * under real traffic. A histogram is log-linear in the style of HdrHistogram:
+ * each power of two of nanoseconds is split into METRICS_SUB_BUCKETS / 2
+ * equal buckets, so every value is kept to within 1.6% in a fixed 19 KB of
+ * counters whatever the range. Each thread records into histograms of its
+ * own, so recording takes no locks and shares no cache lines; readers merge
+ * every thread's histograms when they export. The merged histograms can be
+ * written in Prometheus text format to a file (for a textfile collector) or
+ * served on a local Unix socket, as summaries with p50, p90, p99 and p999,
+ * a sum and a count, from which a scraper derives throughput.
+ *
+ * Metrics are compiled in only when MOVIE_METRICS is defined; otherwise every
+ * macro below expands to nothing.
+ *   METRIC_LATENCY("name");              time the rest of the enclosing scope
+ *   METRICS_WRITE_PROMETHEUS("file");    export to a file, replaced atomically
+ *   METRICS_SERVE("socket");             serve exports on a Unix socket
+ *   METRICS_STOP_SERVING();              close the socket
+ **/
+
+#ifndef METRICS_H
+#define METRICS_H
+
+#ifdef MOVIE_METRICS
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+using namespace std;
+
+const int METRICS_SUB_BITS = 7;                         // buckets per power of two = 2^(SUB_BITS - 1)
+const uint64_t METRICS_SUB_BUCKETS = 1 << METRICS_SUB_BITS;
+const int METRICS_MAX_BITS = 42;                        // values up to 2^42 ns (73 minutes)
+const int METRICS_BUCKETS = (METRICS_MAX_BITS - METRICS_SUB_BITS + 2) * (METRICS_SUB_BUCKETS / 2);
+const int METRICS_MAX_NAMES = 64;                       // distinct metric names
+const double METRICS_QUANTILES[] = { 0.5, 0.9, 0.99, 0.999 };
+
+class LatencyHistogram {
+public:
+    // Class constructor, for an empty histogram
+    LatencyHistogram();
+
+    void Record(uint64_t nanoseconds);
+    // Function: Counts one value. Values beyond the range count as the largest.
+
+    void Merge(const LatencyHistogram& other);
+    // Function: Adds another histogram's values to this one.
+
+    uint64_t GetCount() const;
+    // Function: Gets the number of values recorded.
+
+    uint64_t GetSum() const;
+    // Function: Gets the sum of the values recorded, in nanoseconds.
+
+    uint64_t GetMax() const;
+    // Function: Gets the largest value recorded, in nanoseconds.
+
+    uint64_t GetValueAtQuantile(double quantile) const;
+    // Function: Gets the value below which a share of the values fall.
+    // Pre:  0 <= quantile <= 1.
+    // Post: Function value = the highest value in the bucket holding that
+    //       share of the values, at most the largest value recorded; 0 if empty.
+
+    static int BucketIndex(uint64_t value);
+    // Function: Gets the bucket a value is counted in.
+
+    static uint64_t BucketHighest(int index);
+    // Function: Gets the highest value counted in a bucket.
+
+    static int NumBuckets();
+    // Function: Gets the number of buckets of every histogram.
+
+private:
+    friend class MetricsShard;
+    vector<uint64_t> counts;   // values per bucket
+    uint64_t count;            // values recorded
+    uint64_t sum;              // their sum
+    uint64_t max;              // the largest of them
+};
+
+class MetricsShard {
+public:
+    // Class constructor, for one thread's histograms
+    MetricsShard();
+
+    void Record(int metric, uint64_t nanoseconds);
+    // Function: Counts one value in the thread's histogram of a metric.
+    // Pre:  Called only by the owning thread; 0 <= metric < METRICS_MAX_NAMES.
+    // Post: The value is visible to AddTo, from any thread.
+
+    void AddTo(int metric, LatencyHistogram& histogram) const;
+    // Function: Adds this thread's values of a metric to a histogram.
+    // Post: Values recorded while this runs may be only partly added.
+
+private:
+    struct Cells {
+        atomic<uint64_t> counts[METRICS_BUCKETS];
+        atomic<uint64_t> count;
+        atomic<uint64_t> sum;
+        atomic<uint64_t> max;
+    };
+    atomic<Cells*> cells[METRICS_MAX_NAMES];  // each metric's counters, made on first use
+    vector<unique_ptr<Cells>> owned;          // frees the counters with the shard
+};
+
+class MetricsSocket {
+public:
+    // Class constructor, for a socket not yet serving
+    MetricsSocket();
+
+    // Class destructor, stops serving
+    ~MetricsSocket();
+
+    bool Start(const string& path);
+    // Function: Serves the Prometheus export on a Unix socket.
+    // Post: Returns true if path is listening; each connection is sent the
+    //       export and closed, with an HTTP header if it sent a GET request.
+    //       Otherwise, prints an error and returns false.
+
+    void Stop();
+    // Function: Stops serving and removes the socket file.
+
+private:
+    void Serve();
+    // Function: Answers connections until Stop is called.
+
+    string path;              // socket file
+    int listener;             // listening socket, or -1
+    atomic<bool> stopping;    // Stop has been called
+    thread server;            // runs Serve
+};
+
+LatencyHistogram::LatencyHistogram() : counts(NumBuckets(), 0), count(0), sum(0), max(0) {
+}
+
+void LatencyHistogram::Record(uint64_t nanoseconds) {
+    // Function: Counts one value. Values beyond the range count as the largest.
+    counts[BucketIndex(nanoseconds)]++;
+    count++;
+    sum += nanoseconds;
+    if (nanoseconds > max)
+        max = nanoseconds;
+}
+
+void LatencyHistogram::Merge(const LatencyHistogram& other) {
+    // Function: Adds another histogram's values to this one.
+    for (size_t i = 0; i < counts.size(); i++)
+        counts[i] += other.counts[i];
+    count += other.count;
+    sum += other.sum;
+    if (other.max > max)
+        max = other.max;
+}
+
+uint64_t LatencyHistogram::GetCount() const {
+    // Function: Gets the number of values recorded.
+    return count;
+}
+
+uint64_t LatencyHistogram::GetSum() const {
+    // Function: Gets the sum of the values recorded, in nanoseconds.
+    return sum;
+}
+
+uint64_t LatencyHistogram::GetMax() const {
+    // Function: Gets the largest value recorded, in nanoseconds.
+    return max;
+}
+
+uint64_t LatencyHistogram::GetValueAtQuantile(double quantile) const {
+    // Function: Gets the value below which a share of the values fall.
+    // Pre:  0 <= quantile <= 1.
+    // Post: Function value = the highest value in the bucket holding that
+    //       share of the values, at most the largest value recorded; 0 if empty.
+    uint64_t total = 0;
+    for (uint64_t bucketCount : counts)
+        total += bucketCount;  // count may run ahead of counts in a snapshot
+    if (total == 0)
+        return 0;
+    uint64_t rank = static_cast<uint64_t>(quantile * total + 0.5);
+    rank = rank < 1 ? 1 : (rank > total ? total : rank);
+    uint64_t seen = 0;
+    for (size_t i = 0; i < counts.size(); i++) {
+        seen += counts[i];
+        if (seen >= rank)
+            return BucketHighest(static_cast<int>(i)) < max ? BucketHighest(static_cast<int>(i)) : max;
+    }
+    return max;
+}
+
+int LatencyHistogram::BucketIndex(uint64_t value) {
+    // Function: Gets the bucket a value is counted in.
+    // Values below METRICS_SUB_BUCKETS have a bucket each; above that, a value
+    // keeps its top METRICS_SUB_BITS bits, and each further bit of magnitude
+    // adds METRICS_SUB_BUCKETS / 2 buckets.
+    const uint64_t largest = (uint64_t(1) << METRICS_MAX_BITS) - 1;
+    if (value > largest)
+        value = largest;
+    if (value < METRICS_SUB_BUCKETS)
+        return static_cast<int>(value);
+    int shift = (63 - __builtin_clzll(value)) - (METRICS_SUB_BITS - 1);
+    return static_cast<int>(shift * (METRICS_SUB_BUCKETS / 2) + (value >> shift));
+}
+
+uint64_t LatencyHistogram::BucketHighest(int index) {
+    // Function: Gets the highest value counted in a bucket.
+    if (index < static_cast<int>(METRICS_SUB_BUCKETS))
+        return index;
+    int shift = index / static_cast<int>(METRICS_SUB_BUCKETS / 2) - 1;
+    uint64_t mantissa = index - shift * (METRICS_SUB_BUCKETS / 2);
+    return ((mantissa + 1) << shift) - 1;
+}
+
+int LatencyHistogram::NumBuckets() {
+    // Function: Gets the number of buckets of every histogram.
+    return METRICS_BUCKETS;
+}
+
+MetricsShard::MetricsShard() {
+    for (atomic<Cells*>& metricCells : cells)
+        metricCells.store(nullptr, memory_order_relaxed);
+}
+
+void MetricsShard::Record(int metric, uint64_t nanoseconds) {
+    // Function: Counts one value in the thread's histogram of a metric.
+    // Pre:  Called only by the owning thread; 0 <= metric < METRICS_MAX_NAMES.
+    // Post: The value is visible to AddTo, from any thread.
+    Cells* metricCells = cells[metric].load(memory_order_relaxed);
+    if (!metricCells) {
+        owned.push_back(unique_ptr<Cells>(new Cells()));  // value-initialized: all zero
+        metricCells = owned.back().get();
+        cells[metric].store(metricCells, memory_order_release);
+    }
+    // Only this thread writes, so a load and a store stand in for an atomic add
+    atomic<uint64_t>& bucket = metricCells->counts[LatencyHistogram::BucketIndex(nanoseconds)];
+    bucket.store(bucket.load(memory_order_relaxed) + 1, memory_order_relaxed);
+    metricCells->count.store(metricCells->count.load(memory_order_relaxed) + 1, memory_order_relaxed);
+    metricCells->sum.store(metricCells->sum.load(memory_order_relaxed) + nanoseconds, memory_order_relaxed);
+    if (nanoseconds > metricCells->max.load(memory_order_relaxed))
+        metricCells->max.store(nanoseconds, memory_order_relaxed);
+}
+
+void MetricsShard::AddTo(int metric, LatencyHistogram& histogram) const {
+    // Function: Adds this thread's values of a metric to a histogram.
+    // Post: Values recorded while this runs may be only partly added.
+    const Cells* metricCells = cells[metric].load(memory_order_acquire);
+    if (!metricCells)
+        return;
+    for (size_t i = 0; i < histogram.counts.size(); i++)
+        histogram.counts[i] += metricCells->counts[i].load(memory_order_relaxed);
+    histogram.count += metricCells->count.load(memory_order_relaxed);
+    histogram.sum += metricCells->sum.load(memory_order_relaxed);
+    uint64_t shardMax = metricCells->max.load(memory_order_relaxed);
+    if (shardMax > histogram.max)
+        histogram.max = shardMax;
+}
+
+/* Metric names and every thread's shard, kept alive after the thread exits so it can still be exported */
+mutex metricsRegistryMutex;
+vector<string> metricNames;
+vector<shared_ptr<MetricsShard>> metricsShards;
+thread_local MetricsShard* metricsShard = nullptr;
+MetricsSocket metricsSocket;
+
+uint64_t MetricsNow() {
+    // Function: Reads the steady clock.
+    // Post: Function value = nanoseconds since an arbitrary fixed point.
+    return static_cast<uint64_t>(chrono::duration_cast<chrono::nanoseconds>(
+        chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+int RegisterMetric(const string& name) {
+    // Function: Gets the number of a metric name, adding the name if new.
+    // Post: Function value = the name's number, or -1 once METRICS_MAX_NAMES
+    //       names are taken (that metric is then not recorded).
+    lock_guard<mutex> lock(metricsRegistryMutex);
+    for (size_t i = 0; i < metricNames.size(); i++) {
+        if (metricNames[i] == name)
+            return static_cast<int>(i);
+    }
+    if (metricNames.size() >= static_cast<size_t>(METRICS_MAX_NAMES))
+        return -1;
+    metricNames.push_back(name);
+    return static_cast<int>(metricNames.size()) - 1;
+}
+
+MetricsShard* GetMetricsShard() {
+    // Function: Gets the calling thread's shard, creating it on first use.
+    // Post: The shard is registered for export.
+    if (!metricsShard) {
+        lock_guard<mutex> lock(metricsRegistryMutex);
+        metricsShards.push_back(make_shared<MetricsShard>());
+        metricsShard = metricsShards.back().get();
+    }
+    return metricsShard;
+}
+
+class MetricTimer {
+public:
+    // Starts timing one call of metric number metric
+    MetricTimer(int metric) : metric(metric), start(MetricsNow()) {}
+
+    // Records the call in the thread's histogram
+    ~MetricTimer() {
+        if (metric >= 0)
+            GetMetricsShard()->Record(metric, MetricsNow() - start);
+    }
+
+private:
+    int metric;       // metric number, or -1 when not recorded
+    uint64_t start;   // start time
+};
+
+LatencyHistogram GetLatencyHistogram(const string& name) {
+    // Function: Merges every thread's histogram of a metric.
+    // Post: Function value = all values recorded so far; empty for an unknown name.
+    LatencyHistogram histogram;
+    lock_guard<mutex> lock(metricsRegistryMutex);
+    for (size_t i = 0; i < metricNames.size(); i++) {
+        if (metricNames[i] == name) {
+            for (const shared_ptr<MetricsShard>& shard : metricsShards)
+                shard->AddTo(static_cast<int>(i), histogram);
+        }
+    }
+    return histogram;
+}
+
+string FormatPrometheusMetrics() {
+    // Function: Formats every metric in Prometheus text format.
+    // Post: Function value = one summary per metric name, in seconds.
+    vector<string> names;
+    {
+        lock_guard<mutex> lock(metricsRegistryMutex);
+        names = metricNames;
+    }
+    ostringstream text;
+    text.precision(9);
+    text << "# HELP movie_latency_seconds Latency of catalog and recommendation operations.\n"
+        << "# TYPE movie_latency_seconds summary\n";
+    vector<LatencyHistogram> histograms;
+    for (const string& name : names) {
+        histograms.push_back(GetLatencyHistogram(name));
+        const LatencyHistogram& histogram = histograms.back();
+        for (double quantile : METRICS_QUANTILES) {
+            text << "movie_latency_seconds{op=\"" << name << "\",quantile=\"" << quantile << "\"} "
+                << histogram.GetValueAtQuantile(quantile) / 1e9 << "\n";
+        }
+        text << "movie_latency_seconds_sum{op=\"" << name << "\"} " << histogram.GetSum() / 1e9 << "\n"
+            << "movie_latency_seconds_count{op=\"" << name << "\"} " << histogram.GetCount() << "\n";
+    }
+    text << "# HELP movie_latency_max_seconds Longest operation since the process started.\n"
+        << "# TYPE movie_latency_max_seconds gauge\n";
+    for (size_t i = 0; i < names.size(); i++)
+        text << "movie_latency_max_seconds{op=\"" << names[i] << "\"} " << histograms[i].GetMax() / 1e9 << "\n";
+    return text.str();
+}
+
+bool WritePrometheusMetrics(const string& filename) {
+    // Function: Writes every metric in Prometheus text format.
+    // Post: Returns true if filename was replaced in one step, so a reader
+    //       never sees half a file. Otherwise, prints an error.
+    string temporary = filename + ".tmp";
+    {
+        ofstream file(temporary);
+        file << FormatPrometheusMetrics();
+        if (!file.is_open() || !file.flush()) {
+            cerr << "Error: Could not write the metrics file " << filename << "!" << endl;
+            return false;
+        }
+    }
+    if (rename(temporary.c_str(), filename.c_str()) != 0) {
+        cerr << "Error: Could not write the metrics file " << filename << "!" << endl;
+        return false;
+    }
+    return true;
+}
+
+MetricsSocket::MetricsSocket() : listener(-1), stopping(false) {
+}
+
+MetricsSocket::~MetricsSocket() {
+    Stop();
+}
+
+bool MetricsSocket::Start(const string& path) {
+    // Function: Serves the Prometheus export on a Unix socket.
+    // Post: Returns true if path is listening; each connection is sent the
+    //       export and closed, with an HTTP header if it sent a GET request.
+    //       Otherwise, prints an error and returns false.
+    Stop();
+    sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path)) {
+        cerr << "Error: The metrics socket path " << path << " is too long!" << endl;
+        return false;
+    }
+    strcpy(address.sun_path, path.c_str());
+    unlink(path.c_str());  // a socket left by an earlier run
+
+    listener = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (listener < 0 || bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0
+        || listen(listener, 16) != 0) {
+        cerr << "Error: Could not serve metrics on " << path << "!" << endl;
+        if (listener >= 0)
+            close(listener);
+        listener = -1;
+        return false;
+    }
+    this->path = path;
+    stopping = false;
+    server = thread(&MetricsSocket::Serve, this);
+    return true;
+}
+
+void MetricsSocket::Stop() {
+    // Function: Stops serving and removes the socket file.
+    if (listener < 0)
+        return;
+    stopping = true;
+    if (server.joinable())
+        server.join();
+    close(listener);
+    listener = -1;
+    unlink(path.c_str());
+}
+
+void MetricsSocket::Serve() {
+    // Function: Answers connections until Stop is called.
+    while (!stopping) {
+        pollfd ready = { listener, POLLIN, 0 };
+        if (poll(&ready, 1, 100) <= 0)
+            continue;  // wake up now and then to see if Stop was called
+        int client = accept4(listener, nullptr, nullptr, SOCK_CLOEXEC);
+        if (client < 0)
+            continue;
+
+        // An HTTP client (curl --unix-socket) speaks first; a plain one may not
+        char request[512];
+        ssize_t received = 0;
+        pollfd readable = { client, POLLIN, 0 };
+        if (poll(&readable, 1, 50) > 0)
+            received = recv(client, request, sizeof(request), 0);
+        string body = FormatPrometheusMetrics();
+        string response = received >= 4 && memcmp(request, "GET ", 4) == 0
+            ? "HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\nContent-Length: "
+                + to_string(body.size()) + "\r\n\r\n" + body
+            : body;
+        for (size_t sent = 0; sent < response.size();) {
+            ssize_t n = send(client, response.data() + sent, response.size() - sent, MSG_NOSIGNAL);
+            if (n <= 0)
+                break;
+            sent += n;
+        }
+        close(client);
+    }
+}
+
+#define METRIC_CONCAT_INNER(a, b) a##b
+#define METRIC_CONCAT(a, b) METRIC_CONCAT_INNER(a, b)
+#define METRIC_LATENCY(name) \
+    static const int METRIC_CONCAT(metricId, __LINE__) = RegisterMetric(name); \
+    MetricTimer METRIC_CONCAT(metricTimer, __LINE__)(METRIC_CONCAT(metricId, __LINE__))
+#define METRICS_WRITE_PROMETHEUS(filename) WritePrometheusMetrics(filename)
+#define METRICS_SERVE(path) metricsSocket.Start(path)
+#define METRICS_STOP_SERVING() metricsSocket.Stop()
+
+#else
+
+#define METRIC_LATENCY(name) do {} while (0)
+#define METRICS_WRITE_PROMETHEUS(filename) do {} while (0)
+#define METRICS_SERVE(path) do {} while (0)
+#define METRICS_STOP_SERVING() do {} while (0)
+
+#endif
+#endif
@@ -9,12 +9,16 @@
 #ifndef MOVIE_H
 #define MOVIE_H
 
+#include <cstdint>
 #include <iostream>
 #include <vector>
 #include <string>
 
 using namespace std;
 
+typedef uint32_t MovieId;  // Dense ID a hash table gives a movie when it is inserted
+const MovieId NO_MOVIE = UINT32_MAX;  // "no such movie"
+
 class Movie {
 public:
     // Default class constructor
@@ -26,7 +30,7 @@ public:
         int movie_runtime, double movie_rating);
 
     /* Getters */
-    string GetTitle() const;
+    const string& GetTitle() const;
     // Function: Gets the title of a Movie object.
     // Pre:  Movie has been initialized.
     // Post: Function value = title of the Movie.
@@ -36,17 +40,17 @@ public:
     // Pre:  Movie has been initialized.
     // Post: Function value = year of the Movie.
 
-    string GetGenre() const;
+    const string& GetGenre() const;
     // Function: Gets the genre of a Movie object.
     // Pre:  Movie has been initialized.
     // Post: Function value = genre of the Movie.
 
-    string GetDirector() const;
+    const string& GetDirector() const;
     // Function: Gets the director of a Movie object.
     // Pre:  Movie has been initialized.
     // Post: Function value = director of the Movie.
 
-    string GetCast() const;
+    const string& GetCast() const;
     // Function: Gets the lead cast member of a Movie object.
     // Pre:  Movie has been initialized.
     // Post: Function value = cast member of the Movie.
@@ -70,6 +74,11 @@ public:
     // Pre:  Movie has been initialized.
     // Post: Movie attributes are updated with the provided values.
 
+    void SetRating(double movie_rating);
+    // Function: Sets the rating of a Movie object.
+    // Pre:  Movie has been initialized.
+    // Post: rating = movie_rating, whatever its value.
+
     /* Overloaded equality operator */
     bool operator==(const Movie& rhs) const;
     // Function: Checks if two Movie objects are equal
@@ -116,7 +125,7 @@ Movie::Movie(string movie_title, int movie_year, string movie_genre,
     rating = movie_rating;
 }
 
-string Movie::GetTitle() const {
+const string& Movie::GetTitle() const {
     // Function: Gets the title of a Movie object.
     // Pre:  Movie has been initialized.
     // Post: Function value = title of the Movie.
@@ -130,21 +139,21 @@ int Movie::GetYear() const {
     return year;
 }
 
-string Movie::GetGenre() const {
+const string& Movie::GetGenre() const {
     // Function: Gets the genre of a Movie object.
     // Pre:  Movie has been initialized.
     // Post: Function value = genre of the Movie.
     return genre;
 }
 
-string Movie::GetDirector() const {
+const string& Movie::GetDirector() const {
     // Function: Gets the director of a Movie object.
     // Pre:  Movie has been initialized.
     // Post: Function value = director of the Movie.
     return director;
 }
 
-string Movie::GetCast() const {
+const string& Movie::GetCast() const {
     // Function: Gets the lead cast member of a Movie object.
     // Pre:  Movie has been initialized.
     // Post: Function value = cast member of the Movie.
@@ -190,6 +199,13 @@ void Movie::UpdateMovie(string movie_title = "", int movie_year = -1,
         rating = movie_rating;
 }
 
+void Movie::SetRating(double movie_rating) {
+    // Function: Sets the rating of a Movie object.
+    // Pre:  Movie has been initialized.
+    // Post: rating = movie_rating, whatever its value.
+    rating = movie_rating;
+}
+
 bool Movie::operator==(const Movie& rhs) const {
     // Function: Checks if two Movie objects are equal
     // Pre:  Both Movie objects have been initialized.
@@ -12,10 +12,13 @@
 ***********************************************************************************************/
 #include <iostream>
 #include <fstream>
-#include <sstream>
 #include "Movie.h"
 #include "Viewer.h"
 #include "HashType.h"
+#include "Metrics.h"
+#include "ScoringRegistry.h"
+#include "Trace.h"
+#include "WireFormat.h"
 
 using namespace std;
 
@@ -82,6 +85,31 @@ int main() {
     teenageSon.Print();
     movieTable.RecommendMovies(teenageSon);
 
+    // Compare every registered scoring policy side by side for Dan
+    ScoringRegistry registry;
+    for (const string& policy : registry.GetPolicyNames()) {
+        cout << "\nScoring policy: " << policy << endl;
+        vector<Movie> recommended = registry.Recommend(movieTable, policy, teenageSon,
+            ScoringContext(), NUM_RECOMMENDATIONS);
+        movieTable.PrintRecommendations(teenageSon, recommended);
+    }
+
+    // Titles are ambiguous, so watched movies can also be recorded by movie ID
+    cout << "\nMovies titled King Kong:" << endl;
+    for (MovieId id : movieTable.FindTitle("King Kong")) {
+        const Movie& movie = movieTable.GetMovie(id);
+        cout << "  ID " << id << ": " << movie.GetYear() << " " << movie.GetGenre() << endl;
+    }
+    MovieId remake = movieTable.ResolveTitle("King Kong", 1976);
+    teenageSon.AddWatchedMovie(remake);
+    cout << "Dan watched ID " << remake << "; his recommendations now skip "
+        << movieTable.GetWatchedIds(teenageSon).size() << " movie IDs." << endl;
+
+    // Save the load and recommendation timeline (only when built with -DMOVIE_TRACE)
+    TRACE_WRITE_CHROME("movie_trace.json");
+    // and their latency histograms (only when built with -DMOVIE_METRICS)
+    METRICS_WRITE_PROMETHEUS("movie_metrics.prom");
+
     return 0;
 }
 
@@ -92,6 +120,8 @@ int main() {
  * @param filename The name of the CSV file containing the movie data.
  */
 void readCSVToHashTable(HashType& movieTable, const string& filename) {
+    TRACE_SPAN("readCSVToHashTable");
+    METRIC_LATENCY("LoadCatalog");
     ifstream file(filename);
 
     if (!file.is_open()) {
@@ -105,30 +135,21 @@ void readCSVToHashTable(HashType& movieTable, const string& filename) {
     cout << "Loading movies from the CSV file into the hash table..." << endl;
 
     while (getline(file, line)) {
-        stringstream ss(line);
-        string title, temp, genre, director, cast;
-        int year, runtime;
-        double rating;
-
-        try {
-            // Parse the CSV data
-            getline(ss, title, ',');
-            getline(ss, temp, ','); year = stoi(temp);
-            getline(ss, genre, ',');
-            getline(ss, director, ',');
-            getline(ss, cast, ',');
-            getline(ss, temp, ','); runtime = stoi(temp);
-            getline(ss, temp, ','); rating = stod(temp);
-
-            // Create a Movie object and add it to the hash table
-            Movie movie(title, year, genre, director, cast, runtime, rating);
-            movieTable.InsertMovie(movie);
-            cout << "Inserted movie: " << movie.GetTitle() << endl;
+        // Create a Movie object and add it to the hash table
+        Movie movie;
+        bool parsed;
+        {
+            TRACE_SPAN("ParseMovieCSVLine");
+            METRIC_LATENCY("ParseMovieCSVLine");
+            parsed = ParseMovieCSVLine(line, movie);
         }
-        catch (const exception&) {
+        if (!parsed) {
             cerr << "Error: Could not parse the line - " << line << endl;
             continue;
         }
+        movieTable.InsertMovie(movie);
+        TRACE_SPAN("PrintInserted");
+        cout << "Inserted movie: " << movie.GetTitle() << endl;
     }
 
     cout << "All movies have been successfully loaded into the hash table!" << endl;
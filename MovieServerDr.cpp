@@ -0,0 +1,81 @@
+/***********************************************************************************************
+ * Name:        MovieServerDr.cpp
+ * Description: This driver runs the movie recommender as a long-running server. It loads the
+ *              CSV catalog into a hash table once and then answers recommendation and lookup
+ *              requests from clients (see RecommendServer.h for the protocol) until it is
+ *              interrupted with Ctrl-C. Given a viewer store, clients can also ask for
+ *              recommendations by viewer ID and record watched titles.
+ *              Usage: MovieServer [port] [numWorkers] [csvFile] [viewerStore]
+***********************************************************************************************/
+#include <iostream>
+#include <csignal>
+#include <thread>
+#include "Movie.h"
+#include "HashType.h"
+#include "Metrics.h"
+#include "RecommendServer.h"
+#include "Trace.h"
+#include "ViewerStore.h"
+#include "WireFormat.h"
+
+using namespace std;
+
+RecommendServer* runningServer = nullptr;  // server stopped by the signal handler
+
+// Function prototypes
+void handleSignal(int signal);
+
+int main(int argc, char* argv[]) {
+    int port = argc > 1 ? atoi(argv[1]) : 7070;
+    int numWorkers = argc > 2 ? atoi(argv[2]) : static_cast<int>(thread::hardware_concurrency());
+    string filename = argc > 3 ? argv[3] : "movieData.csv";
+    string storePath = argc > 4 ? argv[4] : "";
+
+    // Load the catalog once; it stays resident for every request
+    HashType movieTable;
+    {
+        METRIC_LATENCY("LoadCatalog");
+        for (const Movie& movie : ReadMovieCSV(filename)) {
+            if (!movieTable.IsFull())
+                movieTable.InsertMovie(movie);
+        }
+    }
+    cout << "The movie hash table has " << movieTable.GetNumItems() << " items stored." << endl;
+
+    RecommendServer server(movieTable, numWorkers);
+    if (!server.Listen(port))
+        return 1;
+
+    ViewerStore viewerStore;
+    if (!storePath.empty()) {
+        if (!viewerStore.Open(storePath))
+            return 1;
+        server.SetViewerStore(&viewerStore);
+        cout << "The viewer store has " << viewerStore.GetNumViewers() << " profiles." << endl;
+    }
+
+    runningServer = &server;
+    signal(SIGINT, handleSignal);
+    signal(SIGTERM, handleSignal);
+
+    cout << "Serving on 127.0.0.1:" << port << " with " << max(1, numWorkers) << " workers." << endl;
+    TRACE_SET_SAMPLING(100);  // with -DMOVIE_TRACE, record one request in 100
+    METRICS_SERVE("movie_metrics.sock");  // with -DMOVIE_METRICS, scrape latencies while serving
+    server.Run();
+    cout << "Server stopped." << endl;
+    METRICS_STOP_SERVING();
+    TRACE_WRITE_CHROME("movie_server_trace.json");
+    METRICS_WRITE_PROMETHEUS("movie_server_metrics.prom");
+    return 0;
+}
+
+/**
+ * Stops the server when the process is interrupted.
+ *
+ * @param signal The signal that was received.
+ */
+void handleSignal(int signal) {
+    (void)signal;
+    if (runningServer)
+        runningServer->Stop();
+}
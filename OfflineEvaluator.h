@@ -0,0 +1,253 @@
+/**
+ * OfflineEvaluator.h
+ * The OfflineEvaluator class measures how good and how fast a recommender
+ * is in the same run. Each viewer's watch history is split once into a
+ * training part, which the recommender sees, and a hold-out part, which it
+ * must find. A recommender path is any function from a training viewer to up
+ * to k movie IDs; Evaluate calls it for every viewer from several threads
+ * and reports precision@k, recall@k and catalog coverage next to requests
+ * per second and latency percentiles. WriteEvaluationJson writes the results
+ * in a form scripts can compare between builds.
+ **/
+
+#ifndef OFFLINEEVALUATOR_H
+#define OFFLINEEVALUATOR_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <functional>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Movie.h"
+#include "Viewer.h"
+
+using namespace std;
+
+const double DEFAULT_HOLDOUT_SHARE = 0.2;  // share of each history held out
+const size_t EVALUATION_CHUNK = 64;        // viewers a thread takes at a time
+
+// A recommender under evaluation: up to k movie IDs for a training viewer
+typedef function<vector<MovieId>(const Viewer& viewer, int k)> RecommenderPath;
+
+struct EvaluationResult {
+    string name;                    // recommender path evaluated
+    int k = 0;                      // recommendations asked for per viewer
+    int numThreads = 0;             // threads calling the path
+    size_t numViewers = 0;          // viewers with a hold-out set
+    double precision = 0.0;         // mean share of the k slots holding a hold-out movie
+    double recall = 0.0;            // mean share of the hold-out set recommended
+    double coverage = 0.0;          // share of the catalog recommended to anyone
+    double seconds = 0.0;           // wall time of the run
+    double requestsPerSecond = 0.0; // viewers served per second across all threads
+    double meanMicros = 0.0;        // mean latency of one call
+    double p50Micros = 0.0;         // median latency
+    double p99Micros = 0.0;         // 99th percentile latency
+    double p999Micros = 0.0;        // 99.9th percentile latency
+};
+
+class OfflineEvaluator {
+public:
+    // Class constructor, splitting the viewers' histories over a catalog of numMovies IDs
+    OfflineEvaluator(const vector<Viewer>& viewers, MovieId numMovies,
+        double holdoutShare = DEFAULT_HOLDOUT_SHARE, unsigned seed = 1);
+
+    const vector<Viewer>& GetTrainViewers() const;
+    // Function: Gets the viewers as recommenders see them.
+    // Post: Function value = one viewer per input viewer, with the same name,
+    //       age and preferences and only the training part of the history.
+    //       Watchlist titles are dropped, as they may name held-out movies.
+
+    vector<vector<MovieId>> GetTrainHistories() const;
+    // Function: Gets the training histories, for recommenders built from them.
+    // Post: Function value = each training viewer's watched IDs, ascending.
+
+    size_t GetNumHoldout() const;
+    // Function: Gets the number of held-out watches across all viewers.
+
+    EvaluationResult Evaluate(const string& name, const RecommenderPath& path, int k, int numThreads) const;
+    // Function: Asks a recommender for every viewer's top k and scores the answers.
+    // Pre:  path may be called from numThreads threads at once.
+    // Post: Function value = quality and speed of path over the viewers
+    //       that have a hold-out set.
+
+private:
+    vector<Viewer> trainViewers;       // histories without the hold-out movies
+    vector<vector<MovieId>> holdouts;  // held-out movies of each viewer, ascending
+    MovieId numMovies;                 // IDs range over [0, numMovies)
+};
+
+bool WriteEvaluationJson(const string& filename, const vector<EvaluationResult>& results);
+// Function: Writes evaluation results as a JSON array, one object per result.
+// Pre:  Result names need no escaping.
+// Post: Returns true if the file was written. "-" writes to standard output.
+
+OfflineEvaluator::OfflineEvaluator(const vector<Viewer>& viewers, MovieId numMovies, double holdoutShare,
+    unsigned seed) : numMovies(numMovies) {
+    mt19937 random(seed);
+    for (const Viewer& viewer : viewers) {
+        Viewer train(viewer.GetViewerName(), viewer.GetViewerAge());
+        for (const string& genre : viewer.GetPreferredGenres())
+            train.AddPreferredGenre(genre);
+        for (const string& director : viewer.GetFavoriteDirectors())
+            train.AddFavoriteDirector(director);
+
+        // Hold out a random share of the history, but leave something to learn from
+        vector<MovieId> history = viewer.GetWatchedMovies();
+        shuffle(history.begin(), history.end(), random);
+        size_t numHoldout = static_cast<size_t>(holdoutShare * history.size() + 0.5);
+        if (numHoldout >= history.size())
+            numHoldout = history.empty() ? 0 : history.size() - 1;
+        vector<MovieId> holdout(history.begin(), history.begin() + numHoldout);
+        sort(holdout.begin(), holdout.end());
+        for (size_t i = numHoldout; i < history.size(); i++)
+            train.AddWatchedMovie(history[i]);
+
+        trainViewers.push_back(train);
+        holdouts.push_back(holdout);
+    }
+}
+
+const vector<Viewer>& OfflineEvaluator::GetTrainViewers() const {
+    // Function: Gets the viewers as recommenders see them.
+    // Post: Function value = one viewer per input viewer, with the same name,
+    //       age and preferences and only the training part of the history.
+    //       Watchlist titles are dropped, as they may name held-out movies.
+    return trainViewers;
+}
+
+vector<vector<MovieId>> OfflineEvaluator::GetTrainHistories() const {
+    // Function: Gets the training histories, for recommenders built from them.
+    // Post: Function value = each training viewer's watched IDs, ascending.
+    vector<vector<MovieId>> histories;
+    for (const Viewer& viewer : trainViewers)
+        histories.push_back(viewer.GetWatchedMovies());
+    return histories;
+}
+
+size_t OfflineEvaluator::GetNumHoldout() const {
+    // Function: Gets the number of held-out watches across all viewers.
+    size_t total = 0;
+    for (const vector<MovieId>& holdout : holdouts)
+        total += holdout.size();
+    return total;
+}
+
+EvaluationResult OfflineEvaluator::Evaluate(const string& name, const RecommenderPath& path, int k,
+    int numThreads) const {
+    // Function: Asks a recommender for every viewer's top k and scores the answers.
+    // Pre:  path may be called from numThreads threads at once.
+    // Post: Function value = quality and speed of path over the viewers
+    //       that have a hold-out set.
+    typedef chrono::steady_clock Clock;
+    numThreads = max(1, numThreads);
+    k = max(1, k);
+
+    // Each thread keeps its own sums, latencies and recommended flags, merged
+    // once all threads are done, so the threads never share a cache line
+    struct ThreadTotals {
+        double precision = 0.0;
+        double recall = 0.0;
+        size_t numViewers = 0;
+        vector<double> latencies;
+        vector<char> recommended;
+    };
+    vector<ThreadTotals> totals(numThreads);
+    atomic<size_t> nextViewer(0);
+
+    Clock::time_point start = Clock::now();
+    vector<thread> threads;
+    for (int t = 0; t < numThreads; t++) {
+        threads.push_back(thread([&, t]() {
+            ThreadTotals& mine = totals[t];
+            mine.recommended.assign(numMovies, 0);
+            size_t size = trainViewers.size();
+            for (size_t first = nextViewer.fetch_add(EVALUATION_CHUNK); first < size;
+                first = nextViewer.fetch_add(EVALUATION_CHUNK)) {
+                for (size_t v = first; v < min(size, first + EVALUATION_CHUNK); v++) {
+                    const vector<MovieId>& holdout = holdouts[v];
+                    if (holdout.empty())
+                        continue;
+                    Clock::time_point called = Clock::now();
+                    vector<MovieId> ids = path(trainViewers[v], k);
+                    mine.latencies.push_back(chrono::duration<double, micro>(Clock::now() - called).count());
+
+                    size_t hits = 0;
+                    for (size_t i = 0; i < ids.size() && i < static_cast<size_t>(k); i++) {
+                        if (ids[i] < numMovies)
+                            mine.recommended[ids[i]] = 1;
+                        hits += binary_search(holdout.begin(), holdout.end(), ids[i]);
+                    }
+                    mine.precision += static_cast<double>(hits) / k;
+                    mine.recall += static_cast<double>(hits) / holdout.size();
+                    mine.numViewers++;
+                }
+            }
+        }));
+    }
+    for (thread& worker : threads)
+        worker.join();
+
+    EvaluationResult result;
+    result.name = name;
+    result.k = k;
+    result.numThreads = numThreads;
+    result.seconds = chrono::duration<double>(Clock::now() - start).count();
+    vector<double> latencies;
+    vector<char> recommended(numMovies, 0);
+    for (const ThreadTotals& mine : totals) {
+        result.precision += mine.precision;
+        result.recall += mine.recall;
+        result.numViewers += mine.numViewers;
+        latencies.insert(latencies.end(), mine.latencies.begin(), mine.latencies.end());
+        for (MovieId id = 0; id < numMovies; id++)
+            recommended[id] |= mine.recommended[id];
+    }
+    if (result.numViewers == 0)
+        return result;
+
+    result.precision /= result.numViewers;
+    result.recall /= result.numViewers;
+    result.coverage = static_cast<double>(count(recommended.begin(), recommended.end(), 1)) / max<MovieId>(1, numMovies);
+    result.requestsPerSecond = result.numViewers / result.seconds;
+    sort(latencies.begin(), latencies.end());
+    double sum = 0.0;
+    for (double latency : latencies)
+        sum += latency;
+    result.meanMicros = sum / latencies.size();
+    // The smallest sample at or above each percentile
+    result.p50Micros = latencies[min(latencies.size() - 1, static_cast<size_t>(0.50 * latencies.size()))];
+    result.p99Micros = latencies[min(latencies.size() - 1, static_cast<size_t>(0.99 * latencies.size()))];
+    result.p999Micros = latencies[min(latencies.size() - 1, static_cast<size_t>(0.999 * latencies.size()))];
+    return result;
+}
+
+bool WriteEvaluationJson(const string& filename, const vector<EvaluationResult>& results) {
+    // Function: Writes evaluation results as a JSON array, one object per result.
+    // Pre:  Result names need no escaping.
+    // Post: Returns true if the file was written. "-" writes to standard output.
+    ofstream file;
+    if (filename != "-") {
+        file.open(filename);
+        if (!file)
+            return false;
+    }
+    ostream& out = filename == "-" ? cout : file;
+    out << "[";
+    for (size_t i = 0; i < results.size(); i++) {
+        const EvaluationResult& r = results[i];
+        out << (i == 0 ? "\n" : ",\n") << "  {\"name\":\"" << r.name << "\",\"k\":" << r.k
+            << ",\"threads\":" << r.numThreads << ",\"viewers\":" << r.numViewers
+            << ",\"precision_at_k\":" << r.precision << ",\"recall_at_k\":" << r.recall
+            << ",\"coverage\":" << r.coverage << ",\"seconds\":" << r.seconds
+            << ",\"requests_per_second\":" << r.requestsPerSecond << ",\"latency_us\":{\"mean\":" << r.meanMicros
+            << ",\"p50\":" << r.p50Micros << ",\"p99\":" << r.p99Micros << ",\"p999\":" << r.p999Micros << "}}";
+    }
+    out << "\n]\n";
+    out.flush();
+    return static_cast<bool>(out);
+}
+#endif
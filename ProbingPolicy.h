@@ -0,0 +1,432 @@
+/**
+ * ProbingPolicy.h
+ * Probing policies decide where BasicHashType keeps each movie's slot and how
+ * a key's probe sequence walks the table. Movies themselves live in a dense
+ * entry array owned by the hash table; a policy's slots only hold entry
+ * numbers, so moving a slot never copies a Movie. Every policy provides:
+ *   void Reset(int capacity);                  // empty table for capacity movies
+ *   int GetNumSlots() const;                   // slots allocated
+ *   int GetMaxItems() const;                   // most movies the policy accepts
+ *   uint64_t HashKey(const string& key) const; // hash of a movie key
+ *   int HomeSlot(uint64_t hash) const;         // first slot probed for hash
+ *   int Find(uint64_t hash, matches) const;    // entry whose key matches, or NO_ENTRY
+ *   int Insert(uint64_t hash, int entry);      // collisions seen, or -1 if no room
+ *   int Erase(uint64_t hash, matches);         // entry removed, or NO_ENTRY
+ *   void Prefetch(uint64_t hash) const;        // start loading hash's first slots
+ *   int PeekEntry(uint64_t hash) const;        // likeliest entry for hash, or NO_ENTRY
+ *   bool NeedsRehash(int items) const;         // tombstones are lengthening probes
+ * where matches(entry) tells whether an entry holds the searched key.
+ * Tombstones left by Erase keep probe sequences intact but are never empty,
+ * so once live entries plus tombstones pass a policy's load limit the hash
+ * table reinserts its entries into fresh slots. A rehash waits for at least
+ * 1/TOMBSTONE_REHASH_SHARE of the slots to be tombstones, so a table that is
+ * over the limit with live entries alone does not rehash on every delete.
+ * Prefetch and PeekEntry let a batch of lookups overlap their cache misses:
+ * PeekEntry reads only slots, so its entry can be prefetched before Find
+ * compares keys.
+ *
+ * QuadraticProbing is the original scheme (alternating +i^2 / -i^2 steps).
+ * RobinHoodProbing is linear probing that keeps probe distances even and
+ * deletes by shifting the following slots back. SwissProbing groups slots
+ * in 16s behind one control byte each and matches a whole group at once
+ * with SSE2.
+ **/
+
+#ifndef PROBINGPOLICY_H
+#define PROBINGPOLICY_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+using namespace std;
+
+const int HASH_FACTOR = 31;     // Prime constant for the quadratic hash function
+const int NO_ENTRY = -1;        // "no such movie" / empty slot
+const int DELETED_ENTRY = -2;   // slot whose movie was deleted (tombstone)
+const int TOMBSTONE_REHASH_SHARE = 32;  // a rehash needs 1/32 of the slots to be tombstones
+
+bool TombstonesPastLimit(int items, int tombstones, int loadLimit, int numSlots) {
+    // Function: Decides whether tombstones warrant reinserting every entry.
+    // Post: Returns true if live entries plus tombstones pass the load limit
+    //       and enough slots are tombstones to make the rehash worth it.
+    return items + tombstones > loadLimit && tombstones >= max(1, numSlots / TOMBSTONE_REHASH_SHARE);
+}
+
+uint64_t MixHash(const char* key, size_t length) {
+    // Function: Computes a well mixed 64-bit hash of a key.
+    // Post: Function value = FNV-1a of key passed through a 64-bit finalizer.
+    uint64_t hash = 1469598103934665603ULL;
+    for (size_t i = 0; i < length; i++) {
+        hash ^= static_cast<unsigned char>(key[i]);
+        hash *= 1099511628211ULL;
+    }
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdULL;
+    hash ^= hash >> 33;
+    hash *= 0xc4ceb9fe1a85ec53ULL;
+    hash ^= hash >> 33;
+    return hash;
+}
+
+uint64_t MixHash(const string& key) {
+    // Function: Computes a well mixed 64-bit hash of a key.
+    // Post: Same as above.
+    return MixHash(key.data(), key.size());
+}
+
+/* Original alternating quadratic probing over an array of entry numbers */
+class QuadraticProbing {
+public:
+    void Reset(int capacity) {
+        slots.assign(max(1, capacity), NO_ENTRY);
+        tombstones = 0;
+    }
+
+    int GetNumSlots() const { return static_cast<int>(slots.size()); }
+
+    int GetMaxItems() const { return LoadLimit(); }
+
+    uint64_t HashKey(const string& key) const {
+        // The original hash: a polynomial in HASH_FACTOR reduced modulo the table size
+        int size = GetNumSlots();
+        int hash = 0;
+        for (char c : key)
+            hash = (hash * HASH_FACTOR + c) % size;
+        return static_cast<uint64_t>(abs(hash % size));
+    }
+
+    int HomeSlot(uint64_t hash) const { return static_cast<int>(hash); }
+
+    template <class Matches>
+    int Find(uint64_t hash, const Matches& matches) const {
+        int index = HomeSlot(hash);
+        for (int probe = 1; probe <= GetNumSlots() && slots[index] != NO_ENTRY; probe++) {
+            if (slots[index] != DELETED_ENTRY && matches(slots[index]))
+                return slots[index];
+            index = Next(index, probe);
+        }
+        return NO_ENTRY;
+    }
+
+    int Insert(uint64_t hash, int entry) {
+        int index = HomeSlot(hash);
+        for (int probe = 1; probe <= GetNumSlots(); probe++) {
+            if (slots[index] < 0) {  // empty or deleted
+                if (slots[index] == DELETED_ENTRY)
+                    tombstones--;
+                slots[index] = entry;
+                return probe - 1;
+            }
+            index = Next(index, probe);
+        }
+        return -1;
+    }
+
+    void Prefetch(uint64_t hash) const {
+        __builtin_prefetch(&slots[HomeSlot(hash)]);
+    }
+
+    int PeekEntry(uint64_t hash) const {
+        // The home slot's entry, unless the slot is empty or deleted
+        return max(slots[HomeSlot(hash)], NO_ENTRY);
+    }
+
+    template <class Matches>
+    int Erase(uint64_t hash, const Matches& matches) {
+        int index = HomeSlot(hash);
+        for (int probe = 1; probe <= GetNumSlots() && slots[index] != NO_ENTRY; probe++) {
+            if (slots[index] != DELETED_ENTRY && matches(slots[index])) {
+                int entry = slots[index];
+                slots[index] = DELETED_ENTRY;  // keep later probe chains intact
+                tombstones++;
+                return entry;
+            }
+            index = Next(index, probe);
+        }
+        return NO_ENTRY;
+    }
+
+    bool NeedsRehash(int items) const {
+        return TombstonesPastLimit(items, tombstones, LoadLimit(), GetNumSlots());
+    }
+
+private:
+    int LoadLimit() const {
+        // Three quarters of the slots, so probe sequences stay short and
+        // (for a prime size of the form 4k+3) always reach a free slot
+        return GetNumSlots() - GetNumSlots() / 4;
+    }
+
+    int Next(int index, int probe) const {
+        // Probe 1 adds 1^2, probe 2 subtracts 1^2, probe 3 adds 2^2, ...
+        long long size = GetNumSlots();
+        long long step = (probe + 1) / 2;
+        step = step * step % size;
+        long long next = probe % 2 == 1 ? index + step : index - step;
+        return static_cast<int>(((next % size) + size) % size);
+    }
+
+    vector<int> slots;   // entry number of each slot, NO_ENTRY or DELETED_ENTRY
+    int tombstones = 0;  // slots holding DELETED_ENTRY
+};
+
+/* Linear probing that keeps probe distances even, with backward-shift deletion */
+class RobinHoodProbing {
+public:
+    void Reset(int capacity) {
+        slots.assign(max(2, capacity), Slot());
+    }
+
+    int GetNumSlots() const { return static_cast<int>(slots.size()); }
+
+    int GetMaxItems() const { return GetNumSlots() - 1; }
+
+    uint64_t HashKey(const string& key) const { return MixHash(key); }
+
+    int HomeSlot(uint64_t hash) const {
+        // Map the high 32 bits onto [0, slots) without a division
+        return static_cast<int>(((hash >> 32) * static_cast<uint64_t>(slots.size())) >> 32);
+    }
+
+    template <class Matches>
+    int Find(uint64_t hash, const Matches& matches) const {
+        uint16_t tag = static_cast<uint16_t>(hash);
+        int index = HomeSlot(hash);
+        // Stop once we have probed further than the resident entry did:
+        // a Robin Hood table would have placed our key before it
+        for (int distance = 0; slots[index].entry != NO_ENTRY && slots[index].distance >= distance; distance++) {
+            if (slots[index].tag == tag && matches(slots[index].entry))
+                return slots[index].entry;
+            index = Next(index);
+        }
+        return NO_ENTRY;
+    }
+
+    int Insert(uint64_t hash, int entry) {
+        Slot carried;
+        carried.entry = entry;
+        carried.distance = 0;
+        carried.tag = static_cast<uint16_t>(hash);
+
+        int index = HomeSlot(hash);
+        for (int probe = 0; probe < GetNumSlots(); probe++) {
+            if (slots[index].entry == NO_ENTRY) {
+                slots[index] = carried;
+                return probe;
+            }
+            // Take the slot from an entry that is closer to its home than we are
+            if (slots[index].distance < carried.distance)
+                swap(slots[index], carried);
+            carried.distance++;
+            index = Next(index);
+        }
+        return -1;
+    }
+
+    void Prefetch(uint64_t hash) const {
+        __builtin_prefetch(&slots[HomeSlot(hash)]);
+    }
+
+    int PeekEntry(uint64_t hash) const {
+        // The first entry on the probe sequence whose tag matches
+        uint16_t tag = static_cast<uint16_t>(hash);
+        int index = HomeSlot(hash);
+        for (int distance = 0; slots[index].entry != NO_ENTRY && slots[index].distance >= distance; distance++) {
+            if (slots[index].tag == tag)
+                return slots[index].entry;
+            index = Next(index);
+        }
+        return NO_ENTRY;
+    }
+
+    template <class Matches>
+    int Erase(uint64_t hash, const Matches& matches) {
+        uint16_t tag = static_cast<uint16_t>(hash);
+        int index = HomeSlot(hash);
+        for (int distance = 0; slots[index].entry != NO_ENTRY && slots[index].distance >= distance; distance++) {
+            if (slots[index].tag == tag && matches(slots[index].entry)) {
+                int entry = slots[index].entry;
+                // Shift the following displaced entries one slot back toward home
+                int next = Next(index);
+                while (slots[next].entry != NO_ENTRY && slots[next].distance > 0) {
+                    slots[index] = slots[next];
+                    slots[index].distance--;
+                    index = next;
+                    next = Next(next);
+                }
+                slots[index] = Slot();
+                return entry;
+            }
+            index = Next(index);
+        }
+        return NO_ENTRY;
+    }
+
+    // Backward-shift deletion leaves no tombstones
+    bool NeedsRehash(int) const { return false; }
+
+private:
+    struct Slot {
+        int entry = NO_ENTRY;    // entry number, or NO_ENTRY when empty
+        int distance = 0;        // slots between this one and the entry's home (up to the table size)
+        uint16_t tag = 0;        // low hash bits, checked before comparing keys
+    };
+
+    int Next(int index) const {
+        return index + 1 == GetNumSlots() ? 0 : index + 1;
+    }
+
+    vector<Slot> slots;   // 12 bytes per slot
+};
+
+/* Swiss-table style groups of 16 slots, each group matched with SSE2 */
+const int SWISS_GROUP_SIZE = 16;   // slots per control group
+const int8_t SWISS_EMPTY = -128;   // control byte 0x80
+const int8_t SWISS_DELETED = -2;   // control byte 0xFE
+// A full slot's control byte holds the low 7 bits of its hash (0..127)
+
+class SwissProbing {
+public:
+    void Reset(int capacity) {
+        // A power-of-two number of groups lets triangular probing visit every group
+        numGroups = 1;
+        while (numGroups * SWISS_GROUP_SIZE < capacity)
+            numGroups *= 2;
+        control.assign(numGroups * SWISS_GROUP_SIZE, SWISS_EMPTY);
+        slots.assign(numGroups * SWISS_GROUP_SIZE, NO_ENTRY);
+        tombstones = 0;
+    }
+
+    int GetNumSlots() const { return static_cast<int>(slots.size()); }
+
+    int GetMaxItems() const { return GetNumSlots() - 1; }
+
+    uint64_t HashKey(const string& key) const { return MixHash(key); }
+
+    int HomeSlot(uint64_t hash) const {
+        return static_cast<int>((hash >> 7) & static_cast<uint64_t>(numGroups - 1)) * SWISS_GROUP_SIZE;
+    }
+
+    template <class Matches>
+    int Find(uint64_t hash, const Matches& matches) const {
+        int8_t tag = static_cast<int8_t>(hash & 0x7F);
+        int group = HomeSlot(hash) / SWISS_GROUP_SIZE;
+        for (int probe = 0; probe < numGroups; probe++) {
+            int base = group * SWISS_GROUP_SIZE;
+            for (uint32_t candidates = MatchByte(base, tag); candidates; candidates &= candidates - 1) {
+                int slot = base + __builtin_ctz(candidates);
+                if (matches(slots[slot]))
+                    return slots[slot];
+            }
+            if (MatchByte(base, SWISS_EMPTY))
+                return NO_ENTRY;  // an empty slot ends every probe sequence through this group
+            group = (group + probe + 1) & (numGroups - 1);
+        }
+        return NO_ENTRY;
+    }
+
+    int Insert(uint64_t hash, int entry) {
+        int group = HomeSlot(hash) / SWISS_GROUP_SIZE;
+        for (int probe = 0; probe < numGroups; probe++) {
+            int base = group * SWISS_GROUP_SIZE;
+            uint32_t free = MatchFree(base);
+            if (free) {
+                int slot = base + __builtin_ctz(free);
+                if (control[slot] == SWISS_DELETED)
+                    tombstones--;
+                control[slot] = static_cast<int8_t>(hash & 0x7F);
+                slots[slot] = entry;
+                return probe;
+            }
+            group = (group + probe + 1) & (numGroups - 1);
+        }
+        return -1;
+    }
+
+    void Prefetch(uint64_t hash) const {
+        int base = HomeSlot(hash);
+        __builtin_prefetch(&control[base]);
+        __builtin_prefetch(&slots[base]);
+    }
+
+    int PeekEntry(uint64_t hash) const {
+        // The first entry in the home group whose control byte matches
+        int base = HomeSlot(hash);
+        uint32_t candidates = MatchByte(base, static_cast<int8_t>(hash & 0x7F));
+        return candidates ? slots[base + __builtin_ctz(candidates)] : NO_ENTRY;
+    }
+
+    template <class Matches>
+    int Erase(uint64_t hash, const Matches& matches) {
+        int8_t tag = static_cast<int8_t>(hash & 0x7F);
+        int group = HomeSlot(hash) / SWISS_GROUP_SIZE;
+        for (int probe = 0; probe < numGroups; probe++) {
+            int base = group * SWISS_GROUP_SIZE;
+            for (uint32_t candidates = MatchByte(base, tag); candidates; candidates &= candidates - 1) {
+                int slot = base + __builtin_ctz(candidates);
+                if (matches(slots[slot])) {
+                    int entry = slots[slot];
+                    // A group that still has an empty slot stops every probe that reaches
+                    // it, so the slot can become empty; otherwise leave a tombstone
+                    control[slot] = MatchByte(base, SWISS_EMPTY) ? SWISS_EMPTY : SWISS_DELETED;
+                    if (control[slot] == SWISS_DELETED)
+                        tombstones++;
+                    slots[slot] = NO_ENTRY;
+                    return entry;
+                }
+            }
+            if (MatchByte(base, SWISS_EMPTY))
+                return NO_ENTRY;
+            group = (group + probe + 1) & (numGroups - 1);
+        }
+        return NO_ENTRY;
+    }
+
+    bool NeedsRehash(int items) const {
+        // Load limit: seven eighths of the slots
+        return TombstonesPastLimit(items, tombstones, GetNumSlots() - GetNumSlots() / 8, GetNumSlots());
+    }
+
+private:
+    uint32_t MatchByte(int base, int8_t value) const {
+        // Bit i set = control byte base+i equals value
+#ifdef __SSE2__
+        __m128i group = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&control[base]));
+        return static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(group, _mm_set1_epi8(value))));
+#else
+        uint32_t mask = 0;
+        for (int i = 0; i < SWISS_GROUP_SIZE; i++) {
+            if (control[base + i] == value)
+                mask |= 1u << i;
+        }
+        return mask;
+#endif
+    }
+
+    uint32_t MatchFree(int base) const {
+        // Bit i set = slot base+i is empty or deleted (control byte has its high bit set)
+#ifdef __SSE2__
+        __m128i group = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&control[base]));
+        return static_cast<uint32_t>(_mm_movemask_epi8(group));
+#else
+        uint32_t mask = 0;
+        for (int i = 0; i < SWISS_GROUP_SIZE; i++) {
+            if (control[base + i] < 0)
+                mask |= 1u << i;
+        }
+        return mask;
+#endif
+    }
+
+    int numGroups = 1;         // number of 16-slot groups (a power of 2)
+    vector<int8_t> control;    // one control byte per slot
+    vector<int> slots;         // entry number of each slot
+    int tombstones = 0;        // control bytes holding SWISS_DELETED
+};
+#endif
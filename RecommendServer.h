@@ -0,0 +1,625 @@
+/**
+ * RecommendServer.h
+ * The RecommendServer class keeps a loaded catalog resident and answers
+ * requests over TCP. A single event loop thread drives non-blocking sockets
+ * with epoll and hands every request line to a pool of compute workers.
+ * Clients may pipeline many requests on one connection; responses are sent
+ * back in request order. Each connection has a bound on requests in flight
+ * and on buffered output, and stops being read once either is reached, so a
+ * slow client cannot make the server queue unbounded work.
+ *
+ * Protocol (one request per line, fields separated by tabs):
+ *   PING                                    ->  OK 0
+ *   REC <policy> <k> <viewer record>        ->  OK <n>, then n movie records
+ *   GET <title> <year> <genre>              ->  OK <0 or 1>, then the movie record
+ *   RECID <policy> <k> <viewer ID or name>  ->  same as REC, for a stored profile
+ *   WATCH <viewer ID or name> <title>       ->  OK 0, once the stored profile is updated
+ * <policy> is a ScoringRegistry name, or "toprated" for the highest rated
+ * unwatched movies read from the table's rating lists without a scan.
+ * A request that cannot be served gets a single "ERR <message>" line. Viewer
+ * and movie records use the encodings in WireFormat.h.
+ **/
+
+#ifndef RECOMMENDSERVER_H
+#define RECOMMENDSERVER_H
+
+#include <atomic>
+#include <cerrno>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "HashType.h"
+#include "Metrics.h"
+#include "ScoringRegistry.h"
+#include "Trace.h"
+#include "ViewerStore.h"
+#include "WireFormat.h"
+
+using namespace std;
+
+const int MAX_PIPELINED = 64;               // requests in flight per connection
+const size_t MAX_OUTPUT_BUFFER = 1 << 20;   // unsent response bytes per connection
+const size_t MAX_INPUT_BUFFER = 1 << 16;    // unparsed request bytes per connection
+const int MAX_RECOMMENDATIONS = 100;        // largest k a client may ask for
+const string TOP_RATED_POLICY = "toprated"; // policy answered from the rating lists
+
+class RecommendServer {
+public:
+    // Class constructor, serves table with numWorkers compute threads
+    RecommendServer(const HashType& table, int numWorkers);
+
+    // Class destructor
+    ~RecommendServer();
+
+    bool Listen(int port);
+    // Function: Opens the listening socket on the loopback interface.
+    // Post: Returns true if the server is listening on port.
+    //       Otherwise, prints an error and returns false.
+
+    void Run();
+    // Function: Serves connections until Stop is called.
+    // Pre:  Listen succeeded.
+    // Post: Every connection is closed and the workers have exited.
+
+    void Stop();
+    // Function: Asks the event loop to shut down.
+    // Post: Run returns shortly. Safe to call from a signal handler.
+
+    void SetViewerStore(ViewerStore* viewerStore);
+    // Function: Lets RECID and WATCH requests use stored viewer profiles.
+    // Pre:  viewerStore is open and outlives the server.
+    // Post: Stored profiles can be named by ID or viewer name.
+
+    string HandleRequest(const string& line) const;
+    // Function: Computes the response to one request line.
+    // Post: Function value = the complete response, ending in a newline.
+
+private:
+    string Recommend(const string& policy, const string& count, const Viewer& viewer) const;
+    // Function: Computes the response to a recommendation request.
+    // Post: Function value = "OK <n>" and n movie records, or an ERR line.
+
+    uint32_t FindStoredViewer(const string& idOrName) const;
+    // Function: Resolves a viewer ID or name against the viewer store.
+    // Pre:  Caller holds storeMutex.
+    // Post: Function value = the viewer's ID, or NO_VIEWER if not stored.
+
+    struct Connection {
+        int fd;                         // non-blocking socket
+        string input;                   // received bytes not yet parsed into requests
+        string output;                  // response bytes not yet written
+        size_t outputSent = 0;          // prefix of output already written
+        uint64_t nextSequence = 0;      // sequence number of the next request read
+        uint64_t nextToSend = 0;        // sequence number of the next response owed
+        map<uint64_t, string> finished; // responses finished out of order
+        int pending = 0;                // requests read but not yet answered
+        bool peerClosed = false;        // client will send nothing more
+        uint32_t events = 0;            // epoll events currently registered
+    };
+
+    struct Job {
+        uint64_t connection;   // connection the request arrived on
+        uint64_t sequence;     // position of the request on its connection
+        string request;        // the request line
+    };
+
+    void WorkerLoop();
+    // Function: Takes jobs off the queue and computes their responses.
+    // Post: Returns once the server is stopping and the queue is empty.
+
+    void AcceptConnections();
+    // Function: Accepts every connection waiting on the listening socket.
+    // Post: New connections are registered for reading.
+
+    void ReadFrom(uint64_t id);
+    // Function: Reads what a connection has sent and queues complete requests.
+    // Post: Input is buffered up to MAX_INPUT_BUFFER.
+
+    void Dispatch(Connection& connection, uint64_t id);
+    // Function: Queues complete request lines while the pipeline has room.
+    // Post: At most MAX_PIPELINED requests of the connection are in flight.
+
+    void WriteTo(Connection& connection);
+    // Function: Writes as much buffered output as the socket accepts.
+    // Post: output holds only the bytes that are still unsent.
+
+    void DrainCompletions();
+    // Function: Moves finished responses to their connections, in request order.
+    // Post: Connections with new output are written and re-armed.
+
+    void Refresh(uint64_t id);
+    // Function: Re-arms a connection's epoll events after its state changed,
+    //           or closes it once a departing client has been fully answered.
+    // Post: The connection is read only while it is under its limits.
+
+    void CloseConnection(uint64_t id);
+    // Function: Closes a connection and forgets its state.
+    // Post: Late responses for the connection are dropped.
+
+    const HashType& table;      // catalog being served (read only)
+    ScoringRegistry registry;   // scoring policies by name
+    ViewerStore* store;         // stored viewer profiles (may be null)
+    mutable shared_mutex storeMutex;  // WATCH writes exclusively, RECID reads shared
+    int numWorkers;             // size of the compute pool
+    int listenFd;               // listening socket
+    int epollFd;                // epoll instance of the event loop
+    int wakeFd;                 // eventfd used by workers and Stop to wake the loop
+    atomic<bool> stopping;      // set once shutdown has been requested
+
+    mutex jobMutex;                  // guards jobs
+    condition_variable jobReady;     // signalled when jobs has work
+    deque<Job> jobs;                 // requests waiting for a worker
+
+    mutex doneMutex;                 // guards done
+    vector<Job> done;                // finished jobs (request replaced by response)
+
+    map<uint64_t, Connection> connections;  // open connections by id
+    uint64_t nextConnectionId;              // id given to the next connection
+};
+
+// Tags telling the event loop which file descriptor became ready
+const uint64_t LISTEN_TAG = 0;
+const uint64_t WAKE_TAG = 1;
+const uint64_t FIRST_CONNECTION_ID = 2;
+
+// Class constructor
+RecommendServer::RecommendServer(const HashType& table, int numWorkers)
+    : table(table), store(nullptr), numWorkers(max(1, numWorkers)), listenFd(-1), stopping(false),
+      nextConnectionId(FIRST_CONNECTION_ID) {
+    epollFd = epoll_create1(EPOLL_CLOEXEC);
+    wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+    epoll_event event = {};
+    event.events = EPOLLIN;
+    event.data.u64 = WAKE_TAG;
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, wakeFd, &event);
+}
+
+// Class destructor
+RecommendServer::~RecommendServer() {
+    if (listenFd >= 0)
+        close(listenFd);
+    close(wakeFd);
+    close(epollFd);
+}
+
+bool RecommendServer::Listen(int port) {
+    // Function: Opens the listening socket on the loopback interface.
+    // Post: Returns true if the server is listening on port.
+    //       Otherwise, prints an error and returns false.
+    listenFd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    int reuse = 1;
+    setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = htons(static_cast<uint16_t>(port));
+
+    if (bind(listenFd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 ||
+        listen(listenFd, SOMAXCONN) != 0) {
+        cerr << "Error: Could not listen on port " << port << "!" << endl;
+        close(listenFd);
+        listenFd = -1;
+        return false;
+    }
+
+    epoll_event event = {};
+    event.events = EPOLLIN;
+    event.data.u64 = LISTEN_TAG;
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, listenFd, &event);
+    return true;
+}
+
+void RecommendServer::Stop() {
+    // Function: Asks the event loop to shut down.
+    // Post: Run returns shortly. Safe to call from a signal handler.
+    stopping = true;
+    uint64_t one = 1;
+    ssize_t ignored = write(wakeFd, &one, sizeof(one));
+    (void)ignored;
+}
+
+void RecommendServer::Run() {
+    // Function: Serves connections until Stop is called.
+    // Pre:  Listen succeeded.
+    // Post: Every connection is closed and the workers have exited.
+    vector<thread> workers;
+    for (int i = 0; i < numWorkers; i++)
+        workers.push_back(thread(&RecommendServer::WorkerLoop, this));
+
+    epoll_event events[256];
+    while (!stopping) {
+        int ready = epoll_wait(epollFd, events, 256, -1);
+        for (int i = 0; i < ready; i++) {
+            uint64_t tag = events[i].data.u64;
+            if (tag == LISTEN_TAG)
+                AcceptConnections();
+            else if (tag == WAKE_TAG)
+                DrainCompletions();
+            else {
+                auto found = connections.find(tag);
+                if (found == connections.end())
+                    continue;  // closed earlier in this batch
+                if (events[i].events & (EPOLLERR | EPOLLHUP) && !(events[i].events & EPOLLIN)) {
+                    CloseConnection(tag);
+                    continue;
+                }
+                if (events[i].events & EPOLLOUT)
+                    WriteTo(found->second);
+                if (events[i].events & EPOLLIN)
+                    ReadFrom(tag);
+                Refresh(tag);
+            }
+        }
+    }
+
+    // Let the workers finish what they hold, then hang up on everyone
+    {
+        lock_guard<mutex> lock(jobMutex);
+        jobs.clear();
+    }
+    jobReady.notify_all();
+    for (thread& worker : workers)
+        worker.join();
+    while (!connections.empty())
+        CloseConnection(connections.begin()->first);
+}
+
+void RecommendServer::WorkerLoop() {
+    // Function: Takes jobs off the queue and computes their responses.
+    // Post: Returns once the server is stopping and the queue is empty.
+    while (true) {
+        Job job;
+        {
+            unique_lock<mutex> lock(jobMutex);
+            jobReady.wait(lock, [this] { return stopping || !jobs.empty(); });
+            if (jobs.empty())
+                return;
+            job = move(jobs.front());
+            jobs.pop_front();
+        }
+
+        {
+            TRACE_SAMPLED_REQUEST();
+            TRACE_SPAN("HandleRequest");
+            METRIC_LATENCY("HandleRequest");
+            job.request = HandleRequest(job.request);
+        }
+
+        bool wasEmpty;
+        {
+            lock_guard<mutex> lock(doneMutex);
+            wasEmpty = done.empty();
+            done.push_back(move(job));
+        }
+        if (wasEmpty) {  // the loop drains everything at once, so one wake-up is enough
+            uint64_t one = 1;
+            ssize_t ignored = write(wakeFd, &one, sizeof(one));
+            (void)ignored;
+        }
+    }
+}
+
+void RecommendServer::AcceptConnections() {
+    // Function: Accepts every connection waiting on the listening socket.
+    // Post: New connections are registered for reading.
+    while (true) {
+        int fd = accept4(listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0)
+            return;
+        int noDelay = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+
+        uint64_t id = nextConnectionId++;
+        Connection& connection = connections[id];
+        connection.fd = fd;
+        connection.events = EPOLLIN;
+
+        epoll_event event = {};
+        event.events = connection.events;
+        event.data.u64 = id;
+        epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event);
+    }
+}
+
+void RecommendServer::ReadFrom(uint64_t id) {
+    // Function: Reads what a connection has sent and queues complete requests.
+    // Post: Input is buffered up to MAX_INPUT_BUFFER.
+    Connection& connection = connections[id];
+    char buffer[16384];
+
+    while (connection.input.size() < MAX_INPUT_BUFFER) {
+        ssize_t n = read(connection.fd, buffer, sizeof(buffer));
+        if (n > 0)
+            connection.input.append(buffer, static_cast<size_t>(n));
+        else {
+            if (n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK))
+                connection.peerClosed = true;
+            break;
+        }
+    }
+    Dispatch(connection, id);
+
+    // A line longer than the whole input buffer can never be parsed
+    if (connection.input.size() >= MAX_INPUT_BUFFER && connection.input.find('\n') == string::npos) {
+        connection.output += "ERR\trequest too long\n";
+        connection.input.clear();
+        connection.peerClosed = true;
+    }
+}
+
+void RecommendServer::Dispatch(Connection& connection, uint64_t id) {
+    // Function: Queues complete request lines while the pipeline has room.
+    // Post: At most MAX_PIPELINED requests of the connection are in flight.
+    vector<Job> ready;
+    size_t start = 0;
+    while (connection.pending < MAX_PIPELINED) {
+        size_t end = connection.input.find('\n', start);
+        if (end == string::npos)
+            break;
+        string line = connection.input.substr(start, end - start);
+        if (!line.empty() && line.back() == '\r')
+            line.pop_back();
+        start = end + 1;
+
+        Job job;
+        job.connection = id;
+        job.sequence = connection.nextSequence++;
+        job.request = move(line);
+        ready.push_back(move(job));
+        connection.pending++;
+    }
+    connection.input.erase(0, start);
+
+    if (!ready.empty()) {
+        {
+            lock_guard<mutex> lock(jobMutex);
+            for (Job& job : ready)
+                jobs.push_back(move(job));
+        }
+        if (ready.size() == 1)
+            jobReady.notify_one();
+        else
+            jobReady.notify_all();
+    }
+}
+
+void RecommendServer::WriteTo(Connection& connection) {
+    // Function: Writes as much buffered output as the socket accepts.
+    // Post: output holds only the bytes that are still unsent.
+    while (connection.outputSent < connection.output.size()) {
+        ssize_t n = send(connection.fd, connection.output.data() + connection.outputSent,
+            connection.output.size() - connection.outputSent, MSG_NOSIGNAL);
+        if (n <= 0) {
+            if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
+                connection.peerClosed = true;  // nobody is listening any more
+                connection.output.clear();
+                connection.outputSent = 0;
+            }
+            break;
+        }
+        connection.outputSent += static_cast<size_t>(n);
+    }
+
+    // Drop the written prefix once it is most of the buffer
+    if (connection.outputSent == connection.output.size()) {
+        connection.output.clear();
+        connection.outputSent = 0;
+    }
+    else if (connection.outputSent > connection.output.size() / 2) {
+        connection.output.erase(0, connection.outputSent);
+        connection.outputSent = 0;
+    }
+}
+
+void RecommendServer::DrainCompletions() {
+    // Function: Moves finished responses to their connections, in request order.
+    // Post: Connections with new output are written and re-armed.
+    uint64_t counter;
+    ssize_t ignored = read(wakeFd, &counter, sizeof(counter));
+    (void)ignored;
+
+    vector<Job> finished;
+    {
+        lock_guard<mutex> lock(doneMutex);
+        finished.swap(done);
+    }
+
+    vector<uint64_t> touched;
+    for (Job& job : finished) {
+        auto found = connections.find(job.connection);
+        if (found == connections.end())
+            continue;  // the client went away
+        Connection& connection = found->second;
+        connection.finished[job.sequence] = move(job.request);
+
+        // Release responses in order, starting with the oldest one owed
+        auto next = connection.finished.find(connection.nextToSend);
+        while (next != connection.finished.end()) {
+            connection.output += next->second;
+            connection.finished.erase(next);
+            connection.nextToSend++;
+            connection.pending--;
+            next = connection.finished.find(connection.nextToSend);
+        }
+        touched.push_back(job.connection);
+    }
+
+    for (uint64_t id : touched) {
+        auto found = connections.find(id);
+        if (found == connections.end())
+            continue;
+        Dispatch(found->second, id);  // the pipeline may have room for buffered requests
+        WriteTo(found->second);
+        Refresh(id);
+    }
+}
+
+void RecommendServer::Refresh(uint64_t id) {
+    // Function: Re-arms a connection's epoll events after its state changed,
+    //           or closes it once a departing client has been fully answered.
+    // Post: The connection is read only while it is under its limits.
+    auto found = connections.find(id);
+    if (found == connections.end())
+        return;
+    Connection& connection = found->second;
+
+    bool unsent = connection.outputSent < connection.output.size();
+    if (connection.peerClosed && connection.pending == 0 && !unsent) {
+        CloseConnection(id);
+        return;
+    }
+
+    uint32_t events = 0;
+    bool underLimits = connection.pending < MAX_PIPELINED &&
+        connection.output.size() < MAX_OUTPUT_BUFFER && connection.input.size() < MAX_INPUT_BUFFER;
+    if (!connection.peerClosed && underLimits)
+        events |= EPOLLIN;  // back-pressure: stop reading while over a limit
+    if (unsent)
+        events |= EPOLLOUT;
+
+    if (events != connection.events) {
+        epoll_event event = {};
+        event.events = events;
+        event.data.u64 = id;
+        epoll_ctl(epollFd, EPOLL_CTL_MOD, connection.fd, &event);
+        connection.events = events;
+    }
+}
+
+void RecommendServer::CloseConnection(uint64_t id) {
+    // Function: Closes a connection and forgets its state.
+    // Post: Late responses for the connection are dropped.
+    auto found = connections.find(id);
+    if (found == connections.end())
+        return;
+    epoll_ctl(epollFd, EPOLL_CTL_DEL, found->second.fd, nullptr);
+    close(found->second.fd);
+    connections.erase(found);
+}
+
+string RecommendServer::HandleRequest(const string& line) const {
+    // Function: Computes the response to one request line.
+    // Post: Function value = the complete response, ending in a newline.
+    vector<string> fields = SplitString(line, FIELD_SEPARATOR);
+    if (fields.empty())
+        return "ERR\tempty request\n";
+
+    if (fields[0] == "PING")
+        return "OK\t0\n";
+
+    if (fields[0] == "REC") {
+        if (fields.size() < 5)
+            return "ERR\tusage: REC policy k viewer\n";
+        Viewer viewer("");
+        string record = JoinStrings(vector<string>(fields.begin() + 3, fields.end()), FIELD_SEPARATOR);
+        if (!DecodeViewer(record, viewer))
+            return "ERR\tmalformed viewer\n";
+        return Recommend(fields[1], fields[2], viewer);
+    }
+
+    if (fields[0] == "RECID" || fields[0] == "WATCH") {
+        if (!store)
+            return "ERR\tno viewer store\n";
+        if (fields[0] == "RECID" && fields.size() != 4)
+            return "ERR\tusage: RECID policy k viewer\n";
+        if (fields[0] == "WATCH" && fields.size() != 3)
+            return "ERR\tusage: WATCH viewer title\n";
+
+        if (fields[0] == "WATCH") {
+            unique_lock<shared_mutex> lock(storeMutex);
+            if (!store->AddWatched(FindStoredViewer(fields[1]), fields[2]))
+                return "ERR\tunknown viewer " + fields[1] + "\n";
+            return "OK\t0\n";
+        }
+
+        // Rebuild the Viewer under the lock, then score without holding it
+        Viewer viewer("");
+        {
+            shared_lock<shared_mutex> lock(storeMutex);
+            if (!store->GetViewer(FindStoredViewer(fields[3]), viewer))
+                return "ERR\tunknown viewer " + fields[3] + "\n";
+        }
+        return Recommend(fields[1], fields[2], viewer);
+    }
+
+    if (fields[0] == "GET") {
+        if (fields.size() != 4)
+            return "ERR\tusage: GET title year genre\n";
+        int year;
+        try {
+            year = stoi(fields[2]);
+        }
+        catch (const exception&) {
+            return "ERR\tyear is not a number\n";
+        }
+
+        bool found;
+        Movie retrieved;
+        table.RetrieveMovie(Movie(fields[1], year, fields[3], "", "", 0, 0.0), found, retrieved);
+        if (!found)
+            return "OK\t0\n";
+        return "OK\t1\n" + EncodeMovie(retrieved) + "\n";
+    }
+
+    return "ERR\tunknown request " + fields[0] + "\n";
+}
+
+string RecommendServer::Recommend(const string& policy, const string& count, const Viewer& viewer) const {
+    // Function: Computes the response to a recommendation request.
+    // Post: Function value = "OK <n>" and n movie records, or an ERR line.
+    if (policy != TOP_RATED_POLICY && !registry.Contains(policy))
+        return "ERR\tunknown policy " + policy + "\n";
+
+    int k;
+    try {
+        k = stoi(count);
+    }
+    catch (const exception&) {
+        return "ERR\tk is not a number\n";
+    }
+    k = max(1, min(k, MAX_RECOMMENDATIONS));
+
+    vector<Movie> recommended = policy == TOP_RATED_POLICY ? table.RecommendTopRated(viewer, k) :
+        registry.Recommend(table, policy, viewer, ScoringContext(), k);
+    string response = "OK\t" + to_string(recommended.size()) + "\n";
+    for (const Movie& movie : recommended)
+        response += EncodeMovie(movie) + "\n";
+    return response;
+}
+
+void RecommendServer::SetViewerStore(ViewerStore* viewerStore) {
+    // Function: Lets RECID and WATCH requests use stored viewer profiles.
+    // Pre:  viewerStore is open and outlives the server.
+    // Post: Stored profiles can be named by ID or viewer name.
+    store = viewerStore;
+}
+
+uint32_t RecommendServer::FindStoredViewer(const string& idOrName) const {
+    // Function: Resolves a viewer ID or name against the viewer store.
+    // Pre:  Caller holds storeMutex.
+    // Post: Function value = the viewer's ID, or NO_VIEWER if not stored.
+    bool numeric = !idOrName.empty() && idOrName.find_first_not_of("0123456789") == string::npos;
+    if (numeric && idOrName.size() < 10) {
+        uint32_t id = static_cast<uint32_t>(stoul(idOrName));
+        if (static_cast<int>(id) < store->GetNumViewers())
+            return id;
+    }
+    return store->FindViewer(idOrName);
+}
+#endif
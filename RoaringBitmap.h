@@ -0,0 +1,375 @@
+/**
+ * RoaringBitmap.h
+ * The RoaringBitmap class is a compressed set of 32-bit integers (movie IDs)
+ * in the style of Roaring bitmaps. Values are split into chunks of 65536 by
+ * their high 16 bits, and each chunk present in the set is one container
+ * holding the low 16 bits of its values:
+ *   - an array container (sorted 16-bit values) while it has at most
+ *     ROARING_ARRAY_MAX values, 2 bytes per value;
+ *   - a bitmap container (65536 bits, 8 KB) once it has more.
+ * A short history costs a few bytes per movie and a dense one an eighth of a
+ * byte per ID in its range. Set operations work a container at a time and
+ * use whole 64-bit words where both sides are bitmaps, so subtracting a
+ * viewer's watched movies from a candidate set costs about as much as the
+ * smaller of the two instead of one lookup per candidate.
+ **/
+
+#ifndef ROARINGBITMAP_H
+#define ROARINGBITMAP_H
+
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <vector>
+
+using namespace std;
+
+const uint32_t ROARING_ARRAY_MAX = 4096;  // largest array container; one more value makes it a bitmap
+const size_t ROARING_WORDS = 1024;        // 64-bit words in a bitmap container (65536 bits)
+
+class RoaringBitmap {
+public:
+    // Class constructor, for an empty set
+    RoaringBitmap();
+
+    void Add(uint32_t value);
+    // Function: Adds a value to the set.
+    // Post: value is in the set.
+
+    void Remove(uint32_t value);
+    // Function: Removes a value from the set.
+    // Post: value is not in the set.
+
+    bool Contains(uint32_t value) const;
+    // Function: Checks if a value is in the set.
+    // Post: Returns true if value was added and not removed since.
+
+    void Clear();
+    // Function: Empties the set.
+
+    bool IsEmpty() const;
+    // Function: Checks if the set has no values.
+
+    size_t GetCardinality() const;
+    // Function: Gets the number of values in the set.
+
+    size_t GetMemoryBytes() const;
+    // Function: Gets the memory held by the set, including its containers.
+
+    RoaringBitmap Or(const RoaringBitmap& other) const;
+    // Function: Computes the union of two sets.
+    // Post: Function value = values in this set, other, or both.
+
+    RoaringBitmap AndNot(const RoaringBitmap& other) const;
+    // Function: Computes the difference of two sets.
+    // Post: Function value = values in this set and not in other.
+
+    vector<uint32_t> ToVector() const;
+    // Function: Lists the values of the set.
+    // Post: Function value = every value in ascending order.
+
+    template <class Visitor>
+    void ForEach(Visitor visit) const;
+    // Function: Calls visit(value) for every value in ascending order.
+
+    bool operator==(const RoaringBitmap& rhs) const;
+    // Function: Checks if two sets hold the same values.
+
+private:
+    struct Container {
+        uint16_t key = 0;            // high 16 bits shared by the container's values
+        uint32_t cardinality = 0;    // number of values held
+        vector<uint16_t> values;     // sorted low bits, for an array container
+        vector<uint64_t> words;      // ROARING_WORDS words, for a bitmap container
+        bool IsBitmap() const { return !words.empty(); }
+    };
+
+    vector<Container>::iterator FindContainer(uint16_t key);
+    // Function: Finds the first container whose key is not below key.
+
+    static void ToBitmap(Container& container);
+    // Function: Turns an array container into a bitmap container.
+
+    static void ToArray(Container& container);
+    // Function: Turns a bitmap container into an array container.
+
+    static void Normalize(Container& container);
+    // Function: Counts a bitmap container's values and makes it an array
+    //           container if it is small enough.
+
+    vector<Container> containers;   // containers with at least one value, by key
+};
+
+// Class constructor
+RoaringBitmap::RoaringBitmap() {
+}
+
+vector<RoaringBitmap::Container>::iterator RoaringBitmap::FindContainer(uint16_t key) {
+    // Function: Finds the first container whose key is not below key.
+    return lower_bound(containers.begin(), containers.end(), key,
+        [](const Container& container, uint16_t k) { return container.key < k; });
+}
+
+void RoaringBitmap::ToBitmap(Container& container) {
+    // Function: Turns an array container into a bitmap container.
+    container.words.assign(ROARING_WORDS, 0);
+    for (uint16_t low : container.values)
+        container.words[low >> 6] |= 1ULL << (low & 63);
+    vector<uint16_t>().swap(container.values);
+}
+
+void RoaringBitmap::ToArray(Container& container) {
+    // Function: Turns a bitmap container into an array container.
+    container.values.clear();
+    container.values.reserve(container.cardinality);
+    for (size_t w = 0; w < ROARING_WORDS; w++) {
+        for (uint64_t word = container.words[w]; word != 0; word &= word - 1)
+            container.values.push_back(static_cast<uint16_t>(w * 64 + __builtin_ctzll(word)));
+    }
+    vector<uint64_t>().swap(container.words);
+}
+
+void RoaringBitmap::Normalize(Container& container) {
+    // Function: Counts a bitmap container's values and makes it an array
+    //           container if it is small enough.
+    uint32_t count = 0;
+    for (uint64_t word : container.words)
+        count += static_cast<uint32_t>(__builtin_popcountll(word));
+    container.cardinality = count;
+    if (count <= ROARING_ARRAY_MAX)
+        ToArray(container);
+}
+
+void RoaringBitmap::Add(uint32_t value) {
+    // Function: Adds a value to the set.
+    // Post: value is in the set.
+    uint16_t key = static_cast<uint16_t>(value >> 16);
+    uint16_t low = static_cast<uint16_t>(value & 0xFFFF);
+    vector<Container>::iterator container = FindContainer(key);
+    if (container == containers.end() || container->key != key) {
+        container = containers.insert(container, Container());
+        container->key = key;
+    }
+
+    if (container->IsBitmap()) {
+        uint64_t& word = container->words[low >> 6];
+        uint64_t bit = 1ULL << (low & 63);
+        container->cardinality += (word & bit) == 0;
+        word |= bit;
+        return;
+    }
+    // Histories are mostly built in ID order, so check the end first
+    vector<uint16_t>& values = container->values;
+    vector<uint16_t>::iterator position =
+        values.empty() || values.back() < low ? values.end() : lower_bound(values.begin(), values.end(), low);
+    if (position != values.end() && *position == low)
+        return;
+    values.insert(position, low);
+    if (++container->cardinality > ROARING_ARRAY_MAX)
+        ToBitmap(*container);
+}
+
+void RoaringBitmap::Remove(uint32_t value) {
+    // Function: Removes a value from the set.
+    // Post: value is not in the set.
+    uint16_t key = static_cast<uint16_t>(value >> 16);
+    uint16_t low = static_cast<uint16_t>(value & 0xFFFF);
+    vector<Container>::iterator container = FindContainer(key);
+    if (container == containers.end() || container->key != key)
+        return;
+
+    if (container->IsBitmap()) {
+        uint64_t& word = container->words[low >> 6];
+        uint64_t bit = 1ULL << (low & 63);
+        if ((word & bit) == 0)
+            return;
+        word &= ~bit;
+        if (--container->cardinality <= ROARING_ARRAY_MAX)
+            ToArray(*container);
+    }
+    else {
+        vector<uint16_t>& values = container->values;
+        vector<uint16_t>::iterator position = lower_bound(values.begin(), values.end(), low);
+        if (position == values.end() || *position != low)
+            return;
+        values.erase(position);
+        container->cardinality--;
+    }
+    if (container->cardinality == 0)
+        containers.erase(container);
+}
+
+bool RoaringBitmap::Contains(uint32_t value) const {
+    // Function: Checks if a value is in the set.
+    // Post: Returns true if value was added and not removed since.
+    uint16_t key = static_cast<uint16_t>(value >> 16);
+    uint16_t low = static_cast<uint16_t>(value & 0xFFFF);
+    vector<Container>::const_iterator container = lower_bound(containers.begin(), containers.end(), key,
+        [](const Container& c, uint16_t k) { return c.key < k; });
+    if (container == containers.end() || container->key != key)
+        return false;
+    if (container->IsBitmap())
+        return (container->words[low >> 6] >> (low & 63)) & 1;
+    return binary_search(container->values.begin(), container->values.end(), low);
+}
+
+void RoaringBitmap::Clear() {
+    // Function: Empties the set.
+    containers.clear();
+}
+
+bool RoaringBitmap::IsEmpty() const {
+    // Function: Checks if the set has no values.
+    return containers.empty();
+}
+
+size_t RoaringBitmap::GetCardinality() const {
+    // Function: Gets the number of values in the set.
+    size_t count = 0;
+    for (const Container& container : containers)
+        count += container.cardinality;
+    return count;
+}
+
+size_t RoaringBitmap::GetMemoryBytes() const {
+    // Function: Gets the memory held by the set, including its containers.
+    size_t bytes = sizeof(RoaringBitmap) + containers.capacity() * sizeof(Container);
+    for (const Container& container : containers)
+        bytes += container.values.capacity() * sizeof(uint16_t) + container.words.capacity() * sizeof(uint64_t);
+    return bytes;
+}
+
+RoaringBitmap RoaringBitmap::Or(const RoaringBitmap& other) const {
+    // Function: Computes the union of two sets.
+    // Post: Function value = values in this set, other, or both.
+    RoaringBitmap result;
+    result.containers.reserve(containers.size() + other.containers.size());
+    size_t i = 0, j = 0;
+    while (i < containers.size() || j < other.containers.size()) {
+        if (j == other.containers.size() || (i < containers.size() && containers[i].key < other.containers[j].key)) {
+            result.containers.push_back(containers[i++]);
+            continue;
+        }
+        if (i == containers.size() || other.containers[j].key < containers[i].key) {
+            result.containers.push_back(other.containers[j++]);
+            continue;
+        }
+
+        const Container& a = containers[i++];
+        const Container& b = other.containers[j++];
+        Container merged;
+        merged.key = a.key;
+        if (!a.IsBitmap() && !b.IsBitmap()) {
+            set_union(a.values.begin(), a.values.end(), b.values.begin(), b.values.end(),
+                back_inserter(merged.values));
+            merged.cardinality = static_cast<uint32_t>(merged.values.size());
+            if (merged.cardinality > ROARING_ARRAY_MAX)
+                ToBitmap(merged);
+        }
+        else {
+            // At least one side is a bitmap: OR the other side into a copy of it
+            const Container& bitmap = a.IsBitmap() ? a : b;
+            const Container& rest = a.IsBitmap() ? b : a;
+            merged.words = bitmap.words;
+            if (rest.IsBitmap()) {
+                for (size_t w = 0; w < ROARING_WORDS; w++)
+                    merged.words[w] |= rest.words[w];
+            }
+            else {
+                for (uint16_t low : rest.values)
+                    merged.words[low >> 6] |= 1ULL << (low & 63);
+            }
+            Normalize(merged);
+        }
+        result.containers.push_back(move(merged));
+    }
+    return result;
+}
+
+RoaringBitmap RoaringBitmap::AndNot(const RoaringBitmap& other) const {
+    // Function: Computes the difference of two sets.
+    // Post: Function value = values in this set and not in other.
+    RoaringBitmap result;
+    result.containers.reserve(containers.size());
+    size_t j = 0;
+    for (const Container& a : containers) {
+        while (j < other.containers.size() && other.containers[j].key < a.key)
+            j++;
+        if (j == other.containers.size() || other.containers[j].key != a.key) {
+            result.containers.push_back(a);  // nothing to subtract in this chunk
+            continue;
+        }
+
+        const Container& b = other.containers[j];
+        Container difference;
+        difference.key = a.key;
+        if (!a.IsBitmap() && !b.IsBitmap()) {
+            set_difference(a.values.begin(), a.values.end(), b.values.begin(), b.values.end(),
+                back_inserter(difference.values));
+            difference.cardinality = static_cast<uint32_t>(difference.values.size());
+        }
+        else if (!a.IsBitmap()) {
+            for (uint16_t low : a.values) {
+                if (!((b.words[low >> 6] >> (low & 63)) & 1))
+                    difference.values.push_back(low);
+            }
+            difference.cardinality = static_cast<uint32_t>(difference.values.size());
+        }
+        else {
+            difference.words = a.words;
+            if (b.IsBitmap()) {
+                for (size_t w = 0; w < ROARING_WORDS; w++)
+                    difference.words[w] &= ~b.words[w];
+            }
+            else {
+                for (uint16_t low : b.values)
+                    difference.words[low >> 6] &= ~(1ULL << (low & 63));
+            }
+            Normalize(difference);
+        }
+        if (difference.cardinality > 0)
+            result.containers.push_back(move(difference));
+    }
+    return result;
+}
+
+vector<uint32_t> RoaringBitmap::ToVector() const {
+    // Function: Lists the values of the set.
+    // Post: Function value = every value in ascending order.
+    vector<uint32_t> values;
+    values.reserve(GetCardinality());
+    ForEach([&](uint32_t value) { values.push_back(value); });
+    return values;
+}
+
+template <class Visitor>
+void RoaringBitmap::ForEach(Visitor visit) const {
+    // Function: Calls visit(value) for every value in ascending order.
+    for (const Container& container : containers) {
+        uint32_t high = static_cast<uint32_t>(container.key) << 16;
+        if (container.IsBitmap()) {
+            for (size_t w = 0; w < ROARING_WORDS; w++) {
+                for (uint64_t word = container.words[w]; word != 0; word &= word - 1)
+                    visit(high | static_cast<uint32_t>(w * 64 + __builtin_ctzll(word)));
+            }
+        }
+        else {
+            for (uint16_t low : container.values)
+                visit(high | low);
+        }
+    }
+}
+
+bool RoaringBitmap::operator==(const RoaringBitmap& rhs) const {
+    // Function: Checks if two sets hold the same values.
+    if (containers.size() != rhs.containers.size())
+        return false;
+    for (size_t i = 0; i < containers.size(); i++) {
+        const Container& a = containers[i];
+        const Container& b = rhs.containers[i];
+        if (a.key != b.key || a.cardinality != b.cardinality || a.values != b.values || a.words != b.words)
+            return false;
+    }
+    return true;
+}
+#endif
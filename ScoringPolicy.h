@@ -0,0 +1,475 @@
+/**
+ * ScoringPolicy.h
+ * Scoring policies decide which unwatched movies a Viewer is recommended.
+ * HashType::GetRecommendations is templated on the policy, so each policy's
+ * Consider() is inlined straight into the table scan instead of being reached
+ * through a virtual call. Every policy provides the same four members:
+ *   Policy(const Viewer& viewer, const ScoringContext& context, int k);
+ *   void Consider(const Movie& movie, MovieId id);  // once per unwatched candidate
+ *   vector<Movie> Results() const;      // the final, ordered recommendations
+ *   vector<MovieId> ResultIds() const;  // the IDs they were considered under
+ * A policy keeps each pick's ID next to the movie, so a caller that wants IDs
+ * gets them without looking the movies up again.
+ * The candidates are the movies in a preferred genre or by a favorite
+ * director (HashType::GetCandidateSet); a policy may skip some of them but is
+ * never shown any other movie.
+ **/
+
+#ifndef SCORINGPOLICY_H
+#define SCORINGPOLICY_H
+
+#include <algorithm>
+#include <string>
+#include <vector>
+#include "Movie.h"
+#include "Viewer.h"
+
+using namespace std;
+
+const double HIGH_RATING_CUTOFF = 7.5;  // Minimum rating for a "highly rated" movie
+const int NUM_RECOMMENDATIONS = 3;      // Default number of recommendations shown
+const int TIERED_DIRECTOR_SPOTS = 3;    // Most spots the tiered rules give to favorite directors
+const double MAX_POPULARITY = 10.0;     // Top of the popularity scale
+
+class PopularitySource {
+public:
+    virtual ~PopularitySource() {}
+
+    virtual double GetPopularity(const Movie& movie) const = 0;
+    // Function: Gets how popular a movie currently is.
+    // Pre:  Movie has been initialized.
+    // Post: Function value = popularity on the same 0-10 scale as a rating,
+    //       never above MAX_POPULARITY.
+};
+
+struct ScoringContext {
+    double highRatingCutoff = HIGH_RATING_CUTOFF;  // cut-off used by the tiered rules
+    double ratingWeight = 1.0;      // weight of the movie's rating
+    double genreWeight = 2.0;       // bonus for a preferred genre
+    double directorWeight = 3.0;    // bonus for a favorite director
+    double popularityWeight = 0.5;  // share of the score taken by popularity (0-1)
+    const PopularitySource* popularity = nullptr;  // optional popularity signal
+};
+
+/* Helpers shared by the policies */
+bool ContainsString(const vector<string>& list, const string& value) {
+    // Function: Checks if a value appears in a list of strings.
+    // Post: Returns true if value is in list. Otherwise, returns false.
+    for (const string& item : list) {
+        if (item == value)
+            return true;
+    }
+    return false;
+}
+
+// A movie picked by a policy with the ID it was considered under
+typedef pair<Movie, MovieId> PickedMovie;
+
+vector<Movie> PickedMovies(const vector<PickedMovie>& picks) {
+    // Function: Gets the movies of a list of picks.
+    // Post: Function value = each pick's movie, in list order.
+    vector<Movie> movies;
+    movies.reserve(picks.size());
+    for (const PickedMovie& pick : picks)
+        movies.push_back(pick.first);
+    return movies;
+}
+
+vector<MovieId> PickedIds(const vector<PickedMovie>& picks) {
+    // Function: Gets the IDs of a list of picks.
+    // Post: Function value = each pick's ID, in list order.
+    vector<MovieId> ids;
+    ids.reserve(picks.size());
+    for (const PickedMovie& pick : picks)
+        ids.push_back(pick.second);
+    return ids;
+}
+
+// A movie kept by TopKMovies with its (score, offer number)
+typedef pair<pair<double, long>, PickedMovie> KeptMovie;
+
+class TopKMovies {
+public:
+    TopKMovies(int k);
+
+    void Offer(const Movie& movie, MovieId id, double score);
+    // Function: Offers a scored movie to the collection.
+    // Post: Movie and its ID are kept if it is among the k best scores seen
+    //       so far. Ties keep the movie that was offered first.
+
+    vector<PickedMovie> Results() const;
+    // Function: Gets the kept movies.
+    // Post: Function value = kept movies and their IDs ordered from highest
+    //       to lowest score, ties in the order they were offered.
+
+private:
+    int capacity;   // number of movies to keep
+    long offered;   // movies offered so far
+    vector<KeptMovie> heap;  // heap of the kept movies, the worst at the front
+};
+
+TopKMovies::TopKMovies(int k) {
+    capacity = max(0, k);
+    offered = 0;
+    heap.reserve(capacity);
+}
+
+// Orders the heap so the worst movie, the lowest score and then the latest
+// offered, sits at the front. Breaking ties by offer order makes the kept
+// movies the first k of one fixed order, so the best k of any share of the
+// movies, offered in the same order, hold every winner from that share.
+bool HigherScore(const KeptMovie& lhs, const KeptMovie& rhs) {
+    return lhs.first.first > rhs.first.first ||
+        (lhs.first.first == rhs.first.first && lhs.first.second < rhs.first.second);
+}
+
+void TopKMovies::Offer(const Movie& movie, MovieId id, double score) {
+    // Function: Offers a scored movie to the collection.
+    // Post: Movie and its ID are kept if it is among the k best scores seen
+    //       so far. Ties keep the movie that was offered first.
+    long order = offered++;
+    if (static_cast<int>(heap.size()) < capacity) {
+        heap.push_back(make_pair(make_pair(score, order), make_pair(movie, id)));
+        push_heap(heap.begin(), heap.end(), HigherScore);
+    }
+    else if (capacity > 0 && score > heap.front().first.first) {
+        pop_heap(heap.begin(), heap.end(), HigherScore);
+        heap.back() = make_pair(make_pair(score, order), make_pair(movie, id));
+        push_heap(heap.begin(), heap.end(), HigherScore);
+    }
+}
+
+vector<PickedMovie> TopKMovies::Results() const {
+    // Function: Gets the kept movies.
+    // Post: Function value = kept movies and their IDs ordered from highest
+    //       to lowest score, ties in the order they were offered.
+    vector<KeptMovie> sorted = heap;  // at most k movies
+    sort_heap(sorted.begin(), sorted.end(), HigherScore);
+    vector<PickedMovie> results;
+    for (const KeptMovie& entry : sorted)
+        results.push_back(entry.second);
+    return results;
+}
+
+template <class Policy>
+vector<Movie> RankCandidates(const vector<Movie>& candidates, const vector<MovieId>& candidateIds,
+    const Viewer& viewer, const ScoringContext& context, int k) {
+    // Function: Lets Policy pick up to k recommendations from a list of candidates.
+    // Pre:  Policy follows the interface described at the top of this file.
+    //       candidateIds[i] is the ID of candidates[i] in the catalog the
+    //       Viewer's watched IDs refer to (NO_MOVIE if it has none).
+    // Post: Function value = the movies chosen by Policy among the candidates
+    //       the Viewer has not watched, by ID or by watchlist title, considered
+    //       in list order; the same filter HashType::GetRecommendations applies.
+    Policy policy(viewer, context, k);
+    vector<string> watchlist = viewer.GetWatchlist();
+    for (size_t i = 0; i < candidates.size(); i++) {
+        MovieId id = i < candidateIds.size() ? candidateIds[i] : NO_MOVIE;
+        if ((id == NO_MOVIE || !viewer.HasWatchedMovie(id)) && !ContainsString(watchlist, candidates[i].GetTitle()))
+            policy.Consider(candidates[i], id);
+    }
+    return policy.Results();
+}
+
+/* Original tiered rules: favorite directors first, then highly rated genre matches */
+class TieredPolicy {
+public:
+    TieredPolicy(const Viewer& viewer, const ScoringContext& context, int k);
+
+    void Consider(const Movie& movie, MovieId id);
+    // Function: Sorts an unwatched movie into the director or genre tier.
+    // Post: Movie is remembered if Results may still place it: one of the
+    //       first movies of a favorite director within the director's quota,
+    //       the first highly rated movie of a preferred genre, or one of the
+    //       first few distinct highly rated preferred-genre movies. So memory
+    //       stays O(k) however many movies are considered.
+
+    vector<Movie> Results() const;
+    // Function: Allocates the k spots between the tiers.
+    // Post: Function value = up to k movies ordered from highest to lowest rating.
+
+    vector<MovieId> ResultIds() const;
+    // Function: Gets the IDs of the movies Results returns.
+    // Post: Function value = their IDs, in the same order.
+
+private:
+    vector<PickedMovie> Picks() const;
+    // Function: Allocates the k spots between the tiers.
+    // Post: Function value = up to k picks ordered from highest to lowest rating.
+
+    int k;                              // number of spots to fill
+    double cutoff;                      // minimum rating of a genre match
+    vector<string> preferredGenres;     // copied once instead of once per movie
+    vector<string> favoriteDirectors;   // copied once instead of once per movie
+    vector<int> quota;                  // spots each of the first favorite directors may take
+    vector<int> directorKept;           // movies kept so far for each director with a quota
+    vector<PickedMovie> directorSuggested;  // movies recommended based on favorite director(s)
+    vector<PickedMovie> genreSuggested;     // best-placed movie of each distinct preferred genre
+    vector<PickedMovie> genreFallback;      // first distinct highly rated preferred-genre movies
+    size_t fallbackLimit;               // most fallback movies Results can need
+    vector<string> distinctGenres;      // tracks distinct genres accounted for in genreSuggested
+};
+
+TieredPolicy::TieredPolicy(const Viewer& viewer, const ScoringContext& context, int k)
+    : k(k), cutoff(context.highRatingCutoff),
+      preferredGenres(viewer.GetPreferredGenres()),
+      favoriteDirectors(viewer.GetFavoriteDirectors()) {
+    /* Allocate recommendation spots based on number of favorite directors */
+    // Give a max of 2 spots to the first director, and 1 to each of the next two
+    size_t numDirectors = favoriteDirectors.size();
+    if (numDirectors == 1)
+        quota = { 2 };
+    else if (numDirectors == 2)
+        quota = { 2, 1 };
+    else if (numDirectors >= 3)
+        quota = { 1, 1, 1 };
+    directorKept.assign(quota.size(), 0);
+
+    // A fallback equal to a director or genre pick is skipped by Results, and
+    // there are at most TIERED_DIRECTOR_SPOTS + one per genre such picks, so
+    // this many distinct fallbacks always leave k to fill the spots from
+    fallbackLimit = static_cast<size_t>(max(0, k)) + TIERED_DIRECTOR_SPOTS + preferredGenres.size();
+}
+
+void TieredPolicy::Consider(const Movie& movie, MovieId id) {
+    // Function: Sorts an unwatched movie into the director or genre tier.
+    // Post: Movie is remembered if Results may still place it: one of the
+    //       first movies of a favorite director within the director's quota,
+    //       the first highly rated movie of a preferred genre, or one of the
+    //       first few distinct highly rated preferred-genre movies. So memory
+    //       stays O(k) however many movies are considered.
+    bool MatchGenre = ContainsString(preferredGenres, movie.GetGenre());
+    bool IsHighlyRated = movie.GetRating() >= cutoff;
+
+    // note: directorSuggested movies need not be highly rated
+    if (ContainsString(favoriteDirectors, movie.GetDirector())) {
+        // Only the first movies of a director, up to its quota, can be placed
+        for (size_t d = 0; d < quota.size(); d++) {
+            if (movie.GetDirector() == favoriteDirectors[d]) {
+                if (directorKept[d] < quota[d]) {
+                    directorSuggested.push_back(make_pair(movie, id));
+                    directorKept[d]++;
+                }
+                break;
+            }
+        }
+    }
+    else if (MatchGenre && IsHighlyRated && !ContainsString(distinctGenres, movie.GetGenre())) {
+        genreSuggested.push_back(make_pair(movie, id));  // Add the movie as a genre suggestion
+        distinctGenres.push_back(movie.GetGenre());  // Add the genre as accounted for
+    }
+
+    // Any highly rated preferred-genre movie may fill the spots left at the end;
+    // a repeat of a kept one would be skipped there, so it is not kept
+    if (MatchGenre && IsHighlyRated && genreFallback.size() < fallbackLimit &&
+        find_if(genreFallback.begin(), genreFallback.end(),
+            [&](const PickedMovie& kept) { return kept.first == movie; }) == genreFallback.end())
+        genreFallback.push_back(make_pair(movie, id));
+}
+
+vector<Movie> TieredPolicy::Results() const {
+    // Function: Allocates the k spots between the tiers.
+    // Post: Function value = up to k movies ordered from highest to lowest rating.
+    return PickedMovies(Picks());
+}
+
+vector<MovieId> TieredPolicy::ResultIds() const {
+    // Function: Gets the IDs of the movies Results returns.
+    // Post: Function value = their IDs, in the same order.
+    return PickedIds(Picks());
+}
+
+vector<PickedMovie> TieredPolicy::Picks() const {
+    // Function: Allocates the k spots between the tiers.
+    // Post: Function value = up to k picks ordered from highest to lowest rating.
+    vector<PickedMovie> recommended;
+    size_t spots = static_cast<size_t>(max(0, k));
+
+    /* First fill the spots of the favorite directors (Consider kept only their quotas) */
+    for (const PickedMovie& pick : directorSuggested) {
+        if (recommended.size() >= spots)
+            break;
+        recommended.push_back(pick);
+    }
+
+    // Fill any remaining spots with highly-rated genre matches
+    for (const PickedMovie& pick : genreSuggested) {
+        if (recommended.size() < spots)
+            recommended.push_back(pick);
+    }
+
+    // Fill any remaining spots now with unwatched movies from preferred genres
+    for (const PickedMovie& pick : genreFallback) {
+        if (recommended.size() >= spots)
+            break;
+        bool movieAlreadyRecommended = false;
+        for (const PickedMovie& rhs : recommended) {
+            if (pick.first == rhs.first) {
+                movieAlreadyRecommended = true;
+                break;
+            }
+        }
+        if (!movieAlreadyRecommended)
+            recommended.push_back(pick);
+    }
+
+    // Sort recommendations (highest to lowest rating), keeping ties in tier order
+    stable_sort(recommended.begin(), recommended.end(), [](const PickedMovie& lhs, const PickedMovie& rhs) {
+        return lhs.first.GetRating() > rhs.first.GetRating();
+    });
+    return recommended;
+}
+
+/* Weighted sum of the rating and the genre/director match bonuses */
+class WeightedLinearPolicy {
+public:
+    WeightedLinearPolicy(const Viewer& viewer, const ScoringContext& context, int k);
+
+    void Consider(const Movie& movie, MovieId id);
+    // Function: Scores an unwatched movie.
+    // Post: Movies matching a preferred genre or favorite director are offered
+    //       to the top k with score = rating, genre and director terms weighted.
+
+    vector<Movie> Results() const;
+    // Function: Gets the best scoring movies.
+    // Post: Function value = up to k movies ordered from highest to lowest score.
+
+    vector<MovieId> ResultIds() const;
+    // Function: Gets the IDs of the movies Results returns.
+    // Post: Function value = their IDs, in the same order.
+
+private:
+    ScoringContext context;             // weights of each term
+    vector<string> preferredGenres;     // copied once instead of once per movie
+    vector<string> favoriteDirectors;   // copied once instead of once per movie
+    TopKMovies best;                    // best scoring movies so far
+};
+
+WeightedLinearPolicy::WeightedLinearPolicy(const Viewer& viewer, const ScoringContext& context, int k)
+    : context(context), preferredGenres(viewer.GetPreferredGenres()),
+      favoriteDirectors(viewer.GetFavoriteDirectors()), best(k) {
+}
+
+void WeightedLinearPolicy::Consider(const Movie& movie, MovieId id) {
+    // Function: Scores an unwatched movie.
+    // Post: Movies matching a preferred genre or favorite director are offered
+    //       to the top k with score = rating, genre and director terms weighted.
+    bool MatchGenre = ContainsString(preferredGenres, movie.GetGenre());
+    bool MatchDirector = ContainsString(favoriteDirectors, movie.GetDirector());
+    if (!MatchGenre && !MatchDirector)
+        return;
+
+    double score = context.ratingWeight * movie.GetRating();
+    if (MatchGenre)
+        score += context.genreWeight;
+    if (MatchDirector)
+        score += context.directorWeight;
+    best.Offer(movie, id, score);
+}
+
+vector<Movie> WeightedLinearPolicy::Results() const {
+    // Function: Gets the best scoring movies.
+    // Post: Function value = up to k movies ordered from highest to lowest score.
+    return PickedMovies(best.Results());
+}
+
+vector<MovieId> WeightedLinearPolicy::ResultIds() const {
+    // Function: Gets the IDs of the movies Results returns.
+    // Post: Function value = their IDs, in the same order.
+    return PickedIds(best.Results());
+}
+
+/* Rating blended with a popularity signal */
+class PopularityBlendedPolicy {
+public:
+    PopularityBlendedPolicy(const Viewer& viewer, const ScoringContext& context, int k);
+
+    void Consider(const Movie& movie, MovieId id);
+    // Function: Scores an unwatched movie.
+    // Post: Movies matching a preferred genre or favorite director are offered
+    //       to the top k with score = (1 - w) * rating + w * popularity.
+    //       Without a popularity source the score is the rating alone.
+
+    vector<Movie> Results() const;
+    // Function: Gets the best scoring movies.
+    // Post: Function value = up to k movies ordered from highest to lowest score.
+
+    vector<MovieId> ResultIds() const;
+    // Function: Gets the IDs of the movies Results returns.
+    // Post: Function value = their IDs, in the same order.
+
+private:
+    double weight;                      // share of the score taken by popularity
+    const PopularitySource* popularity; // popularity signal (may be null)
+    vector<string> preferredGenres;     // copied once instead of once per movie
+    vector<string> favoriteDirectors;   // copied once instead of once per movie
+    TopKMovies best;                    // best scoring movies so far
+};
+
+PopularityBlendedPolicy::PopularityBlendedPolicy(const Viewer& viewer, const ScoringContext& context, int k)
+    : weight(context.popularity ? context.popularityWeight : 0.0), popularity(context.popularity),
+      preferredGenres(viewer.GetPreferredGenres()),
+      favoriteDirectors(viewer.GetFavoriteDirectors()), best(k) {
+}
+
+void PopularityBlendedPolicy::Consider(const Movie& movie, MovieId id) {
+    // Function: Scores an unwatched movie.
+    // Post: Movies matching a preferred genre or favorite director are offered
+    //       to the top k with score = (1 - w) * rating + w * popularity.
+    //       Without a popularity source the score is the rating alone.
+    if (!ContainsString(preferredGenres, movie.GetGenre()) &&
+        !ContainsString(favoriteDirectors, movie.GetDirector()))
+        return;
+
+    double score = (1.0 - weight) * movie.GetRating();
+    if (popularity)  // only matching movies pay for the popularity lookup
+        score += weight * popularity->GetPopularity(movie);
+    best.Offer(movie, id, score);
+}
+
+vector<Movie> PopularityBlendedPolicy::Results() const {
+    // Function: Gets the best scoring movies.
+    // Post: Function value = up to k movies ordered from highest to lowest score.
+    return PickedMovies(best.Results());
+}
+
+vector<MovieId> PopularityBlendedPolicy::ResultIds() const {
+    // Function: Gets the IDs of the movies Results returns.
+    // Post: Function value = their IDs, in the same order.
+    return PickedIds(best.Results());
+}
+/* What a catalog split across shards needs to know about a policy */
+template <class Policy>
+int PolicyShardFetch(const Viewer&, int k) {
+    // Function: Gets how many picks each shard must return so the policy, run
+    //           again over the union of the shards' picks in ID order, picks
+    //           what it would pick over the whole catalog.
+    // Post: Function value = k, enough for a policy that keeps the first k
+    //       movies of one fixed order (TopKMovies). Policies whose picks
+    //       depend on more than that specialize this function.
+    return k;
+}
+
+template <>
+int PolicyShardFetch<TieredPolicy>(const Viewer& viewer, int k) {
+    // Function: Gets how many picks each shard must return for the tiered rules.
+    // Post: Function value = k plus twice the most director and genre picks.
+    //       A shard may spend that many spots on its picks and skip as many
+    //       fallback movies equal to a pick, and still return every fallback
+    //       movie of its own the merged run can reach.
+    return k + 2 * (TIERED_DIRECTOR_SPOTS + static_cast<int>(viewer.GetPreferredGenres().size()));
+}
+
+template <class Policy>
+bool PolicyBlendsPopularity() {
+    // Function: Checks if a policy's score is (1 - w) * rating + w * popularity.
+    // Post: Returns true only for policies that specialize this function.
+    return false;
+}
+
+template <>
+bool PolicyBlendsPopularity<PopularityBlendedPolicy>() {
+    // Function: Checks if a policy's score is (1 - w) * rating + w * popularity.
+    return true;
+}
+#endif
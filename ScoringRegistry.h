@@ -0,0 +1,224 @@
+/**
+ * ScoringRegistry.h
+ * The ScoringRegistry class maps scoring policy names to the pre-instantiated
+ * HashType::GetRecommendations specializations. Picking a policy by name costs
+ * one lookup per request; the table scan itself stays fully inlined, which
+ * lets scoring variants be A/B tested without slowing the scan down.
+ **/
+
+#ifndef SCORINGREGISTRY_H
+#define SCORINGREGISTRY_H
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include "HashType.h"
+#include "ScoringPolicy.h"
+
+using namespace std;
+
+// Signature shared by every GetRecommendations specialization
+typedef vector<Movie> (HashType::*RecommendFunction)(const Viewer&, const ScoringContext&, int) const;
+// Signature shared by every GetRecommendationIds specialization
+typedef vector<MovieId> (HashType::*RecommendIdsFunction)(const Viewer&, const ScoringContext&, int) const;
+// Signature shared by every GetRecommendationIdsFrom specialization
+typedef vector<MovieId> (HashType::*RecommendFromFunction)(const vector<MovieId>&, const Viewer&,
+    const ScoringContext&, int) const;
+// Signature shared by every RankCandidates specialization
+typedef vector<Movie> (*RankFunction)(const vector<Movie>&, const vector<MovieId>&, const Viewer&,
+    const ScoringContext&, int);
+// Signature shared by every PolicyShardFetch specialization
+typedef int (*FetchFunction)(const Viewer&, int);
+
+class ScoringRegistry {
+public:
+    // Class constructor, registers the built-in policies
+    ScoringRegistry();
+
+    template <class Policy>
+    void Register(const string& name);
+    // Function: Adds a scoring policy under a name.
+    // Pre:  Policy follows the interface described in ScoringPolicy.h.
+    // Post: Requests for name are dispatched to the Policy specializations.
+    //       An existing policy with the same name is replaced.
+
+    bool Contains(const string& name) const;
+    // Function: Checks if a scoring policy has been registered.
+    // Post: Returns true if name is registered. Otherwise, returns false.
+
+    vector<string> GetPolicyNames() const;
+    // Function: Gets the names of all registered policies.
+    // Post: Function value = policy names in registration order.
+
+    vector<Movie> Recommend(const HashType& table, const string& name, const Viewer& viewer,
+        const ScoringContext& context, int k) const;
+    // Function: Gets recommendations for a Viewer using the named policy.
+    // Pre:  Hash table has been initialized.
+    // Post: Function value = up to k recommendations chosen by the policy.
+    //       An unknown name prints an error and returns no recommendations.
+
+    vector<MovieId> RecommendIds(const HashType& table, const string& name, const Viewer& viewer,
+        const ScoringContext& context, int k) const;
+    // Function: Same as Recommend, returning movie IDs.
+
+    vector<MovieId> RecommendFrom(const HashType& table, const string& name, const vector<MovieId>& candidates,
+        const Viewer& viewer, const ScoringContext& context, int k) const;
+    // Function: Lets the named policy pick recommendations from given movies
+    //           of a table, such as a shard's candidates in catalog order.
+    // Pre:  Every ID in candidates names a movie in table.
+    // Post: Function value = the IDs of up to k recommendations chosen by
+    //       the policy (see HashType::GetRecommendationIdsFrom).
+    //       An unknown name prints an error and returns no recommendations.
+
+    vector<Movie> Rank(const string& name, const vector<Movie>& candidates, const vector<MovieId>& candidateIds,
+        const Viewer& viewer, const ScoringContext& context, int k) const;
+    // Function: Lets the named policy pick recommendations from a list of candidates,
+    //           such as the partial results gathered from several catalog shards.
+    // Pre:  candidateIds[i] is the catalog ID of candidates[i], or NO_MOVIE.
+    // Post: Function value = up to k recommendations chosen by the policy
+    //       among the candidates the Viewer has not watched.
+    //       An unknown name prints an error and returns no recommendations.
+
+    int GetShardFetch(const string& name, const Viewer& viewer, int k) const;
+    // Function: Gets how many picks each catalog shard must return for the
+    //           named policy (see PolicyShardFetch).
+    // Post: Function value = picks per shard; k for an unknown name.
+
+    bool BlendsPopularity(const string& name) const;
+    // Function: Checks if the named policy scores (1 - w) * rating + w * popularity.
+    // Post: Returns true if it does (see PolicyBlendsPopularity).
+
+private:
+    int Find(const string& name) const;
+    // Function: Finds the position of a registered policy.
+    // Post: Function value = index of name, or -1 (with an error) if unknown.
+
+    vector<string> names;                      // registered policy names
+    vector<RecommendFunction> functions;       // table scan specialization for each name
+    vector<RecommendIdsFunction> idFunctions;  // table scan returning IDs for each name
+    vector<RecommendFromFunction> pickers;     // given-movies specialization for each name
+    vector<RankFunction> rankers;              // candidate list specialization for each name
+    vector<FetchFunction> fetchers;            // picks per shard for each name
+    vector<bool> blends;                       // whether each name blends in popularity
+};
+
+// Class constructor
+ScoringRegistry::ScoringRegistry() {
+    Register<TieredPolicy>("tiered");
+    Register<WeightedLinearPolicy>("weighted");
+    Register<PopularityBlendedPolicy>("popularity");
+}
+
+template <class Policy>
+void ScoringRegistry::Register(const string& name) {
+    // Function: Adds a scoring policy under a name.
+    // Pre:  Policy follows the interface described in ScoringPolicy.h.
+    // Post: Requests for name are dispatched to the Policy specializations.
+    //       An existing policy with the same name is replaced.
+    for (size_t i = 0; i < names.size(); i++) {
+        if (names[i] == name) {
+            functions[i] = &HashType::GetRecommendations<Policy>;
+            idFunctions[i] = &HashType::GetRecommendationIds<Policy>;
+            pickers[i] = &HashType::GetRecommendationIdsFrom<Policy>;
+            rankers[i] = &RankCandidates<Policy>;
+            fetchers[i] = &PolicyShardFetch<Policy>;
+            blends[i] = PolicyBlendsPopularity<Policy>();
+            return;
+        }
+    }
+    names.push_back(name);
+    functions.push_back(&HashType::GetRecommendations<Policy>);
+    idFunctions.push_back(&HashType::GetRecommendationIds<Policy>);
+    pickers.push_back(&HashType::GetRecommendationIdsFrom<Policy>);
+    rankers.push_back(&RankCandidates<Policy>);
+    fetchers.push_back(&PolicyShardFetch<Policy>);
+    blends.push_back(PolicyBlendsPopularity<Policy>());
+}
+
+bool ScoringRegistry::Contains(const string& name) const {
+    // Function: Checks if a scoring policy has been registered.
+    // Post: Returns true if name is registered. Otherwise, returns false.
+    return ContainsString(names, name);
+}
+
+vector<string> ScoringRegistry::GetPolicyNames() const {
+    // Function: Gets the names of all registered policies.
+    // Post: Function value = policy names in registration order.
+    return names;
+}
+
+vector<Movie> ScoringRegistry::Recommend(const HashType& table, const string& name, const Viewer& viewer,
+    const ScoringContext& context, int k) const {
+    // Function: Gets recommendations for a Viewer using the named policy.
+    // Pre:  Hash table has been initialized.
+    // Post: Function value = up to k recommendations chosen by the policy.
+    //       An unknown name prints an error and returns no recommendations.
+    int index = Find(name);
+    if (index < 0)
+        return vector<Movie>();
+    return (table.*functions[index])(viewer, context, k);
+}
+
+vector<MovieId> ScoringRegistry::RecommendIds(const HashType& table, const string& name, const Viewer& viewer,
+    const ScoringContext& context, int k) const {
+    // Function: Same as Recommend, returning movie IDs.
+    int index = Find(name);
+    if (index < 0)
+        return vector<MovieId>();
+    return (table.*idFunctions[index])(viewer, context, k);
+}
+
+vector<MovieId> ScoringRegistry::RecommendFrom(const HashType& table, const string& name,
+    const vector<MovieId>& candidates, const Viewer& viewer, const ScoringContext& context, int k) const {
+    // Function: Lets the named policy pick recommendations from given movies
+    //           of a table, such as a shard's candidates in catalog order.
+    // Pre:  Every ID in candidates names a movie in table.
+    // Post: Function value = the IDs of up to k recommendations chosen by
+    //       the policy (see HashType::GetRecommendationIdsFrom).
+    //       An unknown name prints an error and returns no recommendations.
+    int index = Find(name);
+    if (index < 0)
+        return vector<MovieId>();
+    return (table.*pickers[index])(candidates, viewer, context, k);
+}
+
+vector<Movie> ScoringRegistry::Rank(const string& name, const vector<Movie>& candidates,
+    const vector<MovieId>& candidateIds, const Viewer& viewer, const ScoringContext& context, int k) const {
+    // Function: Lets the named policy pick recommendations from a list of candidates,
+    //           such as the partial results gathered from several catalog shards.
+    // Pre:  candidateIds[i] is the catalog ID of candidates[i], or NO_MOVIE.
+    // Post: Function value = up to k recommendations chosen by the policy
+    //       among the candidates the Viewer has not watched.
+    //       An unknown name prints an error and returns no recommendations.
+    int index = Find(name);
+    if (index < 0)
+        return vector<Movie>();
+    return rankers[index](candidates, candidateIds, viewer, context, k);
+}
+
+int ScoringRegistry::GetShardFetch(const string& name, const Viewer& viewer, int k) const {
+    // Function: Gets how many picks each catalog shard must return for the
+    //           named policy (see PolicyShardFetch).
+    // Post: Function value = picks per shard; k for an unknown name.
+    int index = Find(name);
+    return index < 0 ? k : fetchers[index](viewer, k);
+}
+
+bool ScoringRegistry::BlendsPopularity(const string& name) const {
+    // Function: Checks if the named policy scores (1 - w) * rating + w * popularity.
+    // Post: Returns true if it does (see PolicyBlendsPopularity).
+    int index = Find(name);
+    return index >= 0 && blends[index];
+}
+
+int ScoringRegistry::Find(const string& name) const {
+    // Function: Finds the position of a registered policy.
+    // Post: Function value = index of name, or -1 (with an error) if unknown.
+    for (size_t i = 0; i < names.size(); i++) {
+        if (names[i] == name)
+            return static_cast<int>(i);
+    }
+    cerr << "Error: Unknown scoring policy - " << name << endl;
+    return -1;
+}
+#endif
@@ -0,0 +1,790 @@
+/**
+ * ShardedCatalog.h
+ * The ShardedCatalog class splits the movie catalog across several local shard
+ * processes, each holding its own HashType. The coordinator talks to every
+ * shard over a Unix domain socket pair, routes inserts, lookups and deletes to
+ * the shard that owns a movie's key, and fans recommendation requests out to
+ * all shards at once before merging their partial lists.
+ * The coordinator gives every movie a catalog-wide ID, handed out as HashType
+ * hands out its IDs (counting up, never reused), so a viewer's watched IDs
+ * mean the same movies on every shard. Each shard offers its candidates to the
+ * policy in ID order and returns its picks with their IDs; the coordinator
+ * runs the policy again over the union of the picks in ID order. The result
+ * is what one table holding the whole catalog would give:
+ *   - a policy keeping the first k movies of one fixed order needs k picks
+ *     per shard, and the tiered rules a few more (PolicyShardFetch);
+ *   - a popularity source stays in the coordinator, so shards rank by rating
+ *     alone. The coordinator rescores their picks with popularity; if a movie
+ *     a shard left out could still beat the k-th, it asks once more for every
+ *     movie rated high enough to do so.
+ * Keys are placed by jump consistent hashing, so changing the shard count
+ * moves only the movies whose owner changes, about 1/n of them per shard
+ * added.
+ **/
+
+#ifndef SHARDEDCATALOG_H
+#define SHARDEDCATALOG_H
+
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "HashType.h"
+#include "ScoringRegistry.h"
+#include "WireFormat.h"
+
+using namespace std;
+
+/* Requests understood by a shard process */
+const char SHARD_INSERT = 'I';     // insert every movie in the body under its catalog ID
+const char SHARD_RETRIEVE = 'G';   // look up one movie key
+const char SHARD_DELETE = 'D';     // delete one movie key, returning its catalog ID
+const char SHARD_RECOMMEND = 'R';  // partial top-K for a viewer
+const char SHARD_EXTRACT = 'X';    // remove and return movies owned by another shard
+const char SHARD_COUNT = 'C';      // number of movies stored
+const char SHARD_PLAN = 'P';       // room left and movies each shard of a new count would take
+const char SHARD_ERROR = '\x15';   // first byte of a reply to a malformed request (never starts a record)
+
+const double RATING_SLACK = 1e-9;  // margin keeping rounding from dropping a movie at a rating cut-off
+
+bool WriteFrame(int fd, const string& payload) {
+    // Function: Sends one length-prefixed message on a socket.
+    // Post: Returns true if the whole message was written. Otherwise, returns false.
+    uint32_t length = static_cast<uint32_t>(payload.size());
+    string frame(reinterpret_cast<const char*>(&length), sizeof(length));
+    frame += payload;
+
+    size_t sent = 0;
+    while (sent < frame.size()) {
+        ssize_t n = send(fd, frame.data() + sent, frame.size() - sent, MSG_NOSIGNAL);
+        if (n <= 0)
+            return false;
+        sent += static_cast<size_t>(n);
+    }
+    return true;
+}
+
+bool ReadExactly(int fd, char* buffer, size_t length) {
+    // Function: Reads exactly length bytes from a socket.
+    // Post: Returns true if every byte arrived. Otherwise (closed or failed), returns false.
+    size_t received = 0;
+    while (received < length) {
+        ssize_t n = recv(fd, buffer + received, length - received, 0);
+        if (n <= 0)
+            return false;
+        received += static_cast<size_t>(n);
+    }
+    return true;
+}
+
+bool ReadFrame(int fd, string& payload) {
+    // Function: Receives one length-prefixed message from a socket.
+    // Post: Returns true and sets payload if a whole message arrived.
+    //       Otherwise, returns false.
+    uint32_t length;
+    if (!ReadExactly(fd, reinterpret_cast<char*>(&length), sizeof(length)))
+        return false;
+    payload.assign(length, '\0');
+    return length == 0 || ReadExactly(fd, &payload[0], length);
+}
+
+int ShardOf(const Movie& movie, int numShards) {
+    // Function: Picks the shard that owns a movie's key (title, year and genre).
+    // Pre:  numShards > 0.
+    // Post: Function value = shard index in [0, numShards). Going from n to
+    //       n + 1 shards moves only the keys the new shard takes, about
+    //       1 / (n + 1) of them; going back moves only those keys again.
+    uint64_t hash = 1469598103934665603ULL;  // FNV-1a offset basis
+    string key = movie.GetTitle() + to_string(movie.GetYear()) + movie.GetGenre();
+    for (char c : key) {
+        hash ^= static_cast<unsigned char>(c);
+        hash *= 1099511628211ULL;  // FNV-1a prime
+    }
+
+    // Jump consistent hash (Lamping and Veach): the key jumps forward through
+    // the shards, and each jump lands past shard n with probability 1 - n / (n + 1)
+    int64_t shard = -1;
+    int64_t next = 0;
+    while (next < numShards) {
+        shard = next;
+        hash = hash * 2862933555777941757ULL + 1;
+        double jump = static_cast<double>(1LL << 31) / static_cast<double>((hash >> 33) + 1);
+        next = static_cast<int64_t>((shard + 1) * jump);
+    }
+    return static_cast<int>(shard);
+}
+
+string EncodeContext(const ScoringContext& context) {
+    // Function: Encodes the numeric settings of a ScoringContext.
+    // Post: Function value = the cut-off and weights separated by FIELD_SEPARATOR.
+    //       The popularity source stays behind in the coordinator process,
+    //       which rescores the shards' picks with it.
+    string t(1, FIELD_SEPARATOR);
+    return EncodeRating(context.highRatingCutoff) + t + EncodeRating(context.ratingWeight) + t +
+        EncodeRating(context.genreWeight) + t + EncodeRating(context.directorWeight) + t +
+        EncodeRating(context.popularityWeight);
+}
+
+bool DecodeContext(const string& record, ScoringContext& context) {
+    // Function: Decodes a record written by EncodeContext.
+    // Post: Returns true and sets context if record is well formed.
+    //       Otherwise, returns false.
+    vector<string> fields = SplitString(record, FIELD_SEPARATOR);
+    if (fields.size() != 5)
+        return false;
+    try {
+        context.highRatingCutoff = stod(fields[0]);
+        context.ratingWeight = stod(fields[1]);
+        context.genreWeight = stod(fields[2]);
+        context.directorWeight = stod(fields[3]);
+        context.popularityWeight = stod(fields[4]);
+    }
+    catch (const exception&) {
+        return false;
+    }
+    return true;
+}
+
+bool DecodeNumber(const string& field, double& value) {
+    // Function: Decodes a number sent in a request.
+    // Post: Returns true and sets value if field is a number.
+    //       Otherwise, returns false.
+    try {
+        size_t used;
+        value = stod(field, &used);
+        return used == field.size();
+    }
+    catch (const exception&) {
+        return false;
+    }
+}
+
+bool DecodeNumber(const string& field, long& value) {
+    // Function: Decodes a whole number sent in a request.
+    // Post: Returns true and sets value if field is a whole number.
+    //       Otherwise, returns false.
+    try {
+        size_t used;
+        value = stol(field, &used);
+        return used == field.size();
+    }
+    catch (const exception&) {
+        return false;
+    }
+}
+
+string EncodeMovieList(const vector<Movie>& movies, const vector<MovieId>& ids) {
+    // Function: Encodes a list of movies with their catalog IDs, one record per line.
+    // Pre:  ids has one entry per movie.
+    // Post: Function value = each ID and encoded movie, separated by
+    //       FIELD_SEPARATOR, one pair per line.
+    string text;
+    for (size_t i = 0; i < movies.size(); i++) {
+        text += to_string(ids[i]);
+        text += FIELD_SEPARATOR;
+        text += EncodeMovie(movies[i]);
+        text += '\n';
+    }
+    return text;
+}
+
+void DecodeMovieList(const string& text, vector<Movie>& movies, vector<MovieId>& ids) {
+    // Function: Decodes a list written by EncodeMovieList.
+    // Post: movies and ids hold the well formed records in order.
+    movies.clear();
+    ids.clear();
+    for (const string& record : SplitString(text, '\n')) {
+        size_t separator = record.find(FIELD_SEPARATOR);
+        Movie movie;
+        if (separator == string::npos || !DecodeMovie(record.substr(separator + 1), movie))
+            continue;
+        try {
+            ids.push_back(static_cast<MovieId>(stoul(record.substr(0, separator))));
+        }
+        catch (const exception&) {
+            continue;
+        }
+        movies.push_back(movie);
+    }
+}
+
+class ShardedCatalog {
+public:
+    // Class constructor, starts numShards shard processes
+    ShardedCatalog(int numShards);
+
+    // Class destructor, stops every shard process
+    ~ShardedCatalog();
+
+    int GetNumShards() const;
+    // Function: Determines the number of shard processes.
+    // Post: Function value = number of shards.
+
+    int GetNumItems() const;
+    // Function: Determines the number of movies across all shards.
+    // Post: Function value = sum of the shards' item counts.
+
+    vector<int> GetShardSizes() const;
+    // Function: Determines the number of movies held by each shard.
+    // Post: Function value = item count of each shard in shard order.
+
+    MovieId InsertMovie(const Movie& movie);
+    // Function: Adds a Movie to the shard that owns its key.
+    // Pre:  Owning shard is not full.
+    // Post: Movie object is in the catalog.
+    //       Function value = its catalog ID, given as HashType::InsertMovie
+    //       would give it, or NO_MOVIE if it could not be added.
+
+    vector<MovieId> InsertMovies(const vector<Movie>& movieList);
+    // Function: Adds many movies, sending one batch to each shard.
+    // Post: Every movie is in the catalog (a full shard reports an error).
+    //       Function value = the catalog ID of each movie, in list order
+    //       (NO_MOVIE for a movie a full shard turned away).
+
+    void RetrieveMovie(const Movie& searchMovie, bool& found, Movie& retrievedMovie) const;
+    // Function: Looks up a movie key on its owning shard.
+    // Post: Same contract as HashType::RetrieveMovie.
+
+    void DeleteMovie(const Movie& movie);
+    // Function: Deletes a movie key from its owning shard.
+    // Post: No shard holds a movie matching movie's key. Its catalog ID
+    //       is not given to another movie.
+
+    vector<Movie> Recommend(const string& policy, const Viewer& viewer,
+        const ScoringContext& context, int k) const;
+    // Function: Gets recommendations by scattering the request to every shard
+    //           and merging their partial lists.
+    // Pre:  policy is registered in ScoringRegistry.
+    //       The Viewer's watched IDs are catalog IDs.
+    // Post: Function value = up to k recommendations chosen by the policy,
+    //       the same as from one HashType given the same inserts and deletes.
+
+    bool Rebalance(int newNumShards);
+    // Function: Changes the number of shard processes.
+    // Pre:  newNumShards > 0.
+    // Post: Returns true if every movie now lives on the shard ShardOf picks
+    //       for newNumShards; movies whose owner did not change were not
+    //       moved. If some shard could not take its new movies, reports an
+    //       error and returns false with nothing moved.
+
+private:
+    void StartShard();
+    // Function: Forks one more shard process connected by a socket pair.
+    // Post: The new shard is the last entry of sockets and pids.
+
+    void StopShard(int index);
+    // Function: Closes a shard's socket and waits for its process to exit.
+    // Post: The shard process has exited.
+
+    string Call(int shard, char op, const string& body) const;
+    // Function: Sends a request to one shard and waits for its reply.
+    // Post: Function value = reply body (empty if the shard is gone or
+    //       refused the request).
+
+    vector<string> Broadcast(char op, const vector<string>& bodies) const;
+    // Function: Sends one request to every shard, then gathers every reply,
+    //           so the shards work on their parts at the same time.
+    // Pre:  bodies has one entry per shard.
+    // Post: Function value = reply body of each shard in shard order
+    //       (empty for a shard that is gone or refused the request).
+
+    void SendMovies(const vector<Movie>& movieList, vector<MovieId>& ids);
+    // Function: Sends movies to the shards that own them under catalog IDs.
+    // Post: Every movie is on its owning shard. A movie a full shard turned
+    //       away has its ID set to NO_MOVIE in ids.
+
+    vector<int> sockets;   // coordinator end of each shard's socket pair
+    vector<pid_t> pids;    // process id of each shard
+    ScoringRegistry registry;  // merges partial results by policy name
+    MovieId nextId;            // catalog ID after the highest given so far
+};
+
+void RunShard(int fd) {
+    // Function: Serves requests for one shard until the coordinator hangs up.
+    // Pre:  fd is the shard end of a socket pair.
+    // Post: The shard's hash table is discarded.
+    HashType table;
+    vector<MovieId> catalogIds;  // catalog ID of each entry of table
+    unordered_map<MovieId, MovieId> entryOf;  // catalog ID -> entry of table
+    ScoringRegistry registry;
+    string request;
+
+    // Adds a movie under its catalog ID
+    auto insert = [&](const Movie& movie, MovieId catalogId) {
+        MovieId id = table.InsertMovie(movie);
+        if (id == NO_MOVIE)
+            return false;
+        if (id >= catalogIds.size())
+            catalogIds.resize(id + 1, NO_MOVIE);
+        catalogIds[id] = catalogId;
+        entryOf[catalogId] = id;
+        return true;
+    };
+
+    while (ReadFrame(fd, request)) {
+        char op = request.empty() ? '\0' : request[0];
+        string body = request.size() > 1 ? request.substr(1) : "";
+        string reply;
+
+        if (op == SHARD_INSERT) {
+            // reply: the catalog IDs of the movies that did not fit
+            vector<Movie> movies;
+            vector<MovieId> ids;
+            DecodeMovieList(body, movies, ids);
+            vector<string> rejected;
+            for (size_t i = 0; i < movies.size(); i++) {
+                if (table.IsFull() || !insert(movies[i], ids[i]))
+                    rejected.push_back(to_string(ids[i]));
+            }
+            reply = JoinStrings(rejected, LIST_SEPARATOR);
+        }
+        else if (op == SHARD_RETRIEVE) {
+            Movie key, retrieved;
+            bool found = false;
+            if (DecodeMovie(body, key))
+                table.RetrieveMovie(key, found, retrieved);
+            reply = found ? EncodeMovie(retrieved) : "";
+        }
+        else if (op == SHARD_DELETE) {
+            // reply: the deleted movie with its catalog ID, or nothing
+            Movie key;
+            MovieId id = DecodeMovie(body, key) ? table.FindMovieId(key) : NO_MOVIE;
+            if (id != NO_MOVIE) {
+                reply = EncodeMovieList(vector<Movie>(1, table.GetMovie(id)), vector<MovieId>(1, catalogIds[id]));
+                entryOf.erase(catalogIds[id]);
+                table.DeleteMovie(key);
+            }
+        }
+        else if (op == SHARD_RECOMMEND) {
+            // body: policy, k, minimum rating, context and viewer on separate lines
+            vector<string> parts = SplitString(body, '\n');
+            ScoringContext context;
+            Viewer viewer("");
+            long fetch;
+            double minRating;
+            if (parts.size() != 5 || !DecodeNumber(parts[1], fetch) || !DecodeNumber(parts[2], minRating) ||
+                !DecodeContext(parts[3], context) || !DecodeViewer(parts[4], viewer))
+                reply = string(1, SHARD_ERROR) + "malformed recommendation request";
+            else {
+                // The watched IDs are catalog IDs; map those held here to entries
+                Viewer local(viewer.GetViewerName(), viewer.GetViewerAge());
+                for (const string& genre : viewer.GetPreferredGenres())
+                    local.AddPreferredGenre(genre);
+                for (const string& director : viewer.GetFavoriteDirectors())
+                    local.AddFavoriteDirector(director);
+                for (const string& title : viewer.GetWatchlist())
+                    local.AddToWatchlist(title);
+                for (MovieId watched : viewer.GetWatchedMovies()) {
+                    unordered_map<MovieId, MovieId>::const_iterator found = entryOf.find(watched);
+                    if (found != entryOf.end())
+                        local.AddWatchedMovie(found->second);
+                }
+
+                // Offer the candidates in catalog ID order, as one table would
+                vector<pair<MovieId, MovieId>> order;  // (catalog ID, entry)
+                table.GetCandidateSet(local).ForEach([&](uint32_t id) {
+                    if (table.GetMovie(id).GetRating() >= minRating)
+                        order.push_back(make_pair(catalogIds[id], id));
+                });
+                sort(order.begin(), order.end());
+                vector<MovieId> candidates;
+                for (const pair<MovieId, MovieId>& candidate : order)
+                    candidates.push_back(candidate.second);
+
+                int k = static_cast<int>(min<long>(fetch, static_cast<long>(candidates.size())));
+                vector<Movie> picks;
+                vector<MovieId> pickIds;
+                for (MovieId id : registry.RecommendFrom(table, parts[0], candidates, local, context, k)) {
+                    picks.push_back(table.GetMovie(id));
+                    pickIds.push_back(catalogIds[id]);
+                }
+                reply = EncodeMovieList(picks, pickIds);
+            }
+        }
+        else if (op == SHARD_EXTRACT) {
+            // body: new shard count and this shard's index
+            vector<string> parts = SplitString(body, FIELD_SEPARATOR);
+            long newNumShards, self;
+            if (parts.size() != 2 || !DecodeNumber(parts[0], newNumShards) || !DecodeNumber(parts[1], self) ||
+                newNumShards <= 0 || newNumShards > numeric_limits<int>::max())
+                reply = string(1, SHARD_ERROR) + "malformed extract request";
+            else {
+                vector<Movie> staying, leaving;
+                vector<MovieId> stayingIds, leavingIds;
+                for (MovieId id = 0; id < catalogIds.size(); id++) {
+                    if (!table.HasMovie(id))
+                        continue;
+                    const Movie& movie = table.GetMovie(id);
+                    bool stays = ShardOf(movie, static_cast<int>(newNumShards)) == self;
+                    (stays ? staying : leaving).push_back(movie);
+                    (stays ? stayingIds : leavingIds).push_back(catalogIds[id]);
+                }
+                // Rebuild rather than delete one by one, so the moved entries are not left behind as holes
+                if (!leaving.empty()) {
+                    table.MakeEmpty();
+                    catalogIds.clear();
+                    entryOf.clear();
+                    for (size_t i = 0; i < staying.size(); i++)
+                        insert(staying[i], stayingIds[i]);
+                }
+                reply = EncodeMovieList(leaving, leavingIds);
+            }
+        }
+        else if (op == SHARD_PLAN) {
+            // body: new shard count; reply: room left, then the number of
+            // movies this shard would hand to each shard of the new count
+            long newNumShards;
+            if (!DecodeNumber(body, newNumShards) || newNumShards <= 0 || newNumShards > numeric_limits<int>::max())
+                reply = string(1, SHARD_ERROR) + "malformed plan request";
+            else {
+                vector<long> taking(newNumShards, 0);
+                for (MovieId id = 0; id < catalogIds.size(); id++) {
+                    if (table.HasMovie(id))
+                        taking[ShardOf(table.GetMovie(id), static_cast<int>(newNumShards))]++;
+                }
+                vector<string> fields(1, to_string(table.GetMaxItems() - table.GetNumItems()));
+                for (long count : taking)
+                    fields.push_back(to_string(count));
+                reply = JoinStrings(fields, FIELD_SEPARATOR);
+            }
+        }
+        else if (op == SHARD_COUNT)
+            reply = to_string(table.GetNumItems());
+        else
+            reply = string(1, SHARD_ERROR) + "unknown request";
+
+        if (!WriteFrame(fd, reply))
+            break;
+    }
+}
+
+// Class constructor
+ShardedCatalog::ShardedCatalog(int numShards) : nextId(0) {
+    for (int i = 0; i < max(1, numShards); i++)
+        StartShard();
+}
+
+// Class destructor
+ShardedCatalog::~ShardedCatalog() {
+    while (!sockets.empty())
+        StopShard(static_cast<int>(sockets.size()) - 1);
+}
+
+void ShardedCatalog::StartShard() {
+    // Function: Forks one more shard process connected by a socket pair.
+    // Post: The new shard is the last entry of sockets and pids.
+    int ends[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, ends) != 0) {
+        cerr << "Error: Could not create a shard socket!" << endl;
+        return;
+    }
+
+    cout.flush();  // keep buffered output from being printed twice
+    pid_t pid = fork();
+    if (pid < 0) {
+        cerr << "Error: Could not start a shard process!" << endl;
+        close(ends[0]);
+        close(ends[1]);
+        return;
+    }
+    if (pid == 0) {
+        // Shard process: drop the coordinator's sockets so hang-ups are noticed
+        close(ends[0]);
+        for (int fd : sockets)
+            close(fd);
+        RunShard(ends[1]);
+        close(ends[1]);
+        _exit(0);
+    }
+
+    close(ends[1]);
+    sockets.push_back(ends[0]);
+    pids.push_back(pid);
+}
+
+void ShardedCatalog::StopShard(int index) {
+    // Function: Closes a shard's socket and waits for its process to exit.
+    // Post: The shard process has exited.
+    close(sockets[index]);
+    waitpid(pids[index], nullptr, 0);
+    sockets.erase(sockets.begin() + index);
+    pids.erase(pids.begin() + index);
+}
+
+string ShardedCatalog::Call(int shard, char op, const string& body) const {
+    // Function: Sends a request to one shard and waits for its reply.
+    // Post: Function value = reply body (empty if the shard is gone or
+    //       refused the request).
+    string reply;
+    if (!WriteFrame(sockets[shard], string(1, op) + body) || !ReadFrame(sockets[shard], reply))
+        cerr << "Error: Shard " << shard << " is not responding!" << endl;
+    else if (!reply.empty() && reply[0] == SHARD_ERROR) {
+        cerr << "Error: Shard " << shard << " refused a request - " << reply.substr(1) << endl;
+        reply.clear();
+    }
+    return reply;
+}
+
+vector<string> ShardedCatalog::Broadcast(char op, const vector<string>& bodies) const {
+    // Function: Sends one request to every shard, then gathers every reply,
+    //           so the shards work on their parts at the same time.
+    // Pre:  bodies has one entry per shard.
+    // Post: Function value = reply body of each shard in shard order
+    //       (empty for a shard that is gone or refused the request).
+    vector<bool> sent(sockets.size());
+    for (size_t i = 0; i < sockets.size(); i++)
+        sent[i] = WriteFrame(sockets[i], string(1, op) + bodies[i]);
+
+    vector<string> replies(sockets.size());
+    for (size_t i = 0; i < sockets.size(); i++) {
+        if (!sent[i] || !ReadFrame(sockets[i], replies[i]))
+            cerr << "Error: Shard " << i << " is not responding!" << endl;
+        else if (!replies[i].empty() && replies[i][0] == SHARD_ERROR) {
+            cerr << "Error: Shard " << i << " refused a request - " << replies[i].substr(1) << endl;
+            replies[i].clear();
+        }
+    }
+    return replies;
+}
+
+int ShardedCatalog::GetNumShards() const {
+    // Function: Determines the number of shard processes.
+    // Post: Function value = number of shards.
+    return static_cast<int>(sockets.size());
+}
+
+vector<int> ShardedCatalog::GetShardSizes() const {
+    // Function: Determines the number of movies held by each shard.
+    // Post: Function value = item count of each shard in shard order.
+    vector<int> sizes;
+    for (const string& reply : Broadcast(SHARD_COUNT, vector<string>(sockets.size())))
+        sizes.push_back(reply.empty() ? 0 : stoi(reply));
+    return sizes;
+}
+
+int ShardedCatalog::GetNumItems() const {
+    // Function: Determines the number of movies across all shards.
+    // Post: Function value = sum of the shards' item counts.
+    int total = 0;
+    for (int size : GetShardSizes())
+        total += size;
+    return total;
+}
+
+MovieId ShardedCatalog::InsertMovie(const Movie& movie) {
+    // Function: Adds a Movie to the shard that owns its key.
+    // Pre:  Owning shard is not full.
+    // Post: Movie object is in the catalog.
+    //       Function value = its catalog ID, given as HashType::InsertMovie
+    //       would give it, or NO_MOVIE if it could not be added.
+    return InsertMovies(vector<Movie>(1, movie))[0];
+}
+
+vector<MovieId> ShardedCatalog::InsertMovies(const vector<Movie>& movieList) {
+    // Function: Adds many movies, sending one batch to each shard.
+    // Post: Every movie is in the catalog (a full shard reports an error).
+    //       Function value = the catalog ID of each movie, in list order
+    //       (NO_MOVIE for a movie a full shard turned away).
+    vector<MovieId> ids;
+    for (size_t i = 0; i < movieList.size(); i++)
+        ids.push_back(nextId++);
+    SendMovies(movieList, ids);
+    return ids;
+}
+
+void ShardedCatalog::SendMovies(const vector<Movie>& movieList, vector<MovieId>& ids) {
+    // Function: Sends movies to the shards that own them under catalog IDs.
+    // Post: Every movie is on its owning shard. A movie a full shard turned
+    //       away has its ID set to NO_MOVIE in ids.
+    vector<string> batches(sockets.size());
+    for (size_t i = 0; i < movieList.size(); i++)
+        batches[ShardOf(movieList[i], GetNumShards())] += EncodeMovieList(vector<Movie>(1, movieList[i]),
+            vector<MovieId>(1, ids[i]));
+
+    vector<string> replies = Broadcast(SHARD_INSERT, batches);
+    for (size_t i = 0; i < replies.size(); i++) {
+        vector<string> rejected = SplitString(replies[i], LIST_SEPARATOR);
+        if (rejected.empty())
+            continue;
+        cerr << "Error: Shard " << i << " is full, " << rejected.size() << " movies were not inserted." << endl;
+        for (const string& text : rejected) {
+            long id;
+            if (DecodeNumber(text, id))
+                replace(ids.begin(), ids.end(), static_cast<MovieId>(id), NO_MOVIE);
+        }
+    }
+}
+
+void ShardedCatalog::RetrieveMovie(const Movie& searchMovie, bool& found, Movie& retrievedMovie) const {
+    // Function: Looks up a movie key on its owning shard.
+    // Post: Same contract as HashType::RetrieveMovie.
+    string reply = Call(ShardOf(searchMovie, GetNumShards()), SHARD_RETRIEVE, EncodeMovie(searchMovie));
+    retrievedMovie = Movie();
+    found = DecodeMovie(reply, retrievedMovie);
+}
+
+void ShardedCatalog::DeleteMovie(const Movie& movie) {
+    // Function: Deletes a movie key from its owning shard.
+    // Post: No shard holds a movie matching movie's key. Its catalog ID
+    //       is not given to another movie.
+    string reply = Call(ShardOf(movie, GetNumShards()), SHARD_DELETE, EncodeMovie(movie));
+    vector<Movie> deleted;
+    vector<MovieId> ids;
+    DecodeMovieList(reply, deleted, ids);
+    if (ids.empty())
+        cout << "Movie to delete not found." << endl;
+}
+
+vector<Movie> ShardedCatalog::Recommend(const string& policy, const Viewer& viewer,
+    const ScoringContext& context, int k) const {
+    // Function: Gets recommendations by scattering the request to every shard
+    //           and merging their partial lists.
+    // Pre:  policy is registered in ScoringRegistry.
+    //       The Viewer's watched IDs are catalog IDs.
+    // Post: Function value = up to k recommendations chosen by the policy,
+    //       the same as from one HashType given the same inserts and deletes.
+    if (!registry.Contains(policy)) {
+        cerr << "Error: Unknown scoring policy - " << policy << endl;
+        return vector<Movie>();
+    }
+    if (k <= 0)
+        return vector<Movie>();
+
+    // Shards score without the popularity source, so a blended policy ranks
+    // by rating alone there and is rescored here
+    bool rescore = context.popularity != nullptr && registry.BlendsPopularity(policy);
+    double weight = context.popularityWeight;
+    int fetch = registry.GetShardFetch(policy, viewer, k);
+    double minRating = -numeric_limits<double>::infinity();
+    while (true) {
+        string body = policy + "\n" + to_string(fetch) + "\n" + EncodeRating(minRating) + "\n" +
+            EncodeContext(context) + "\n" + EncodeViewer(viewer);
+        vector<pair<MovieId, Movie>> merged;
+        bool truncated = false;  // some shard filled every spot
+        double bound = -numeric_limits<double>::infinity();  // best score a left-out movie could have
+        for (const string& reply : Broadcast(SHARD_RECOMMEND, vector<string>(sockets.size(), body))) {
+            vector<Movie> partial;
+            vector<MovieId> ids;
+            DecodeMovieList(reply, partial, ids);
+            for (size_t i = 0; i < partial.size(); i++)
+                merged.push_back(make_pair(ids[i], partial[i]));
+            // A shard that filled every spot may have left out movies rated
+            // no higher than the lowest it returned
+            if (static_cast<int>(partial.size()) >= fetch) {
+                truncated = true;
+                double lowest = partial[0].GetRating();
+                for (const Movie& movie : partial)
+                    lowest = min(lowest, movie.GetRating());
+                bound = max(bound, (1.0 - weight) * lowest + weight * MAX_POPULARITY);
+            }
+        }
+
+        // Offer the picks in catalog ID order, as one table would
+        sort(merged.begin(), merged.end(),
+            [](const pair<MovieId, Movie>& lhs, const pair<MovieId, Movie>& rhs) { return lhs.first < rhs.first; });
+        vector<Movie> candidates;
+        vector<MovieId> candidateIds;
+        for (const pair<MovieId, Movie>& candidate : merged) {
+            candidateIds.push_back(candidate.first);
+            candidates.push_back(candidate.second);
+        }
+        vector<Movie> picks = registry.Rank(policy, candidates, candidateIds, viewer, context, k);
+        if (!rescore || !truncated)
+            return picks;
+
+        // Done once no left-out movie can reach the k-th score (a tie would
+        // go to it if its ID is lower). Otherwise ask for every movie whose
+        // rating could, with the highest popularity, beat the k-th score;
+        // or, without a k-th movie, for every movie.
+        fetch = numeric_limits<int>::max();
+        minRating = -numeric_limits<double>::infinity();
+        if (static_cast<int>(picks.size()) >= k) {
+            const Movie& last = picks[k - 1];
+            double kth = (1.0 - weight) * last.GetRating() + weight * context.popularity->GetPopularity(last);
+            if (bound < kth)
+                return picks;
+            if (weight < 1.0)
+                minRating = (kth - weight * MAX_POPULARITY) / (1.0 - weight) - RATING_SLACK;
+        }
+    }
+}
+
+bool ShardedCatalog::Rebalance(int newNumShards) {
+    // Function: Changes the number of shard processes.
+    // Pre:  newNumShards > 0.
+    // Post: Returns true if every movie now lives on the shard ShardOf picks
+    //       for newNumShards; movies whose owner did not change were not
+    //       moved. If some shard could not take its new movies, reports an
+    //       error and returns false with nothing moved.
+    newNumShards = max(1, newNumShards);
+    int oldNumShards = GetNumShards();
+    if (newNumShards == oldNumShards)
+        return true;
+
+    while (GetNumShards() < newNumShards)
+        StartShard();
+
+    // Check that every shard of the new count has room for what it takes
+    // before any movie leaves its shard, so a full shard loses nothing
+    vector<long> room(newNumShards, 0);    // movies each shard can still take
+    vector<long> taking(newNumShards, 0);  // movies each shard would take from the others
+    vector<string> replies = Broadcast(SHARD_PLAN, vector<string>(sockets.size(), to_string(newNumShards)));
+    bool planned = true;
+    for (size_t i = 0; i < replies.size(); i++) {
+        vector<string> fields = SplitString(replies[i], FIELD_SEPARATOR);
+        vector<long> counts(fields.size(), 0);
+        for (size_t f = 0; f < fields.size(); f++)
+            planned = DecodeNumber(fields[f], counts[f]) && planned;
+        if (!planned || counts.size() != static_cast<size_t>(newNumShards) + 1) {
+            planned = false;
+            break;
+        }
+
+        long leaving = 0;
+        for (int t = 0; t < newNumShards; t++) {
+            if (t != static_cast<int>(i)) {
+                taking[t] += counts[t + 1];
+                leaving += counts[t + 1];
+            }
+        }
+        if (static_cast<int>(i) < newNumShards)
+            room[i] = counts[0] + leaving;  // the movies it hands on free room too
+    }
+    for (int t = 0; planned && t < newNumShards; t++)
+        planned = taking[t] <= room[t];
+    if (!planned) {
+        cerr << "Error: The shards cannot hold the catalog as " << newNumShards << " shards, it was not rebalanced." << endl;
+        while (GetNumShards() > oldNumShards)
+            StopShard(GetNumShards() - 1);
+        return false;
+    }
+
+    // Every old shard gives up the movies it no longer owns
+    vector<string> bodies;
+    for (int i = 0; i < GetNumShards(); i++)
+        bodies.push_back(to_string(newNumShards) + FIELD_SEPARATOR + to_string(i));
+    vector<Movie> moving;
+    vector<MovieId> movingIds;
+    for (const string& reply : Broadcast(SHARD_EXTRACT, bodies)) {
+        vector<Movie> leaving;
+        vector<MovieId> ids;
+        DecodeMovieList(reply, leaving, ids);
+        moving.insert(moving.end(), leaving.begin(), leaving.end());
+        movingIds.insert(movingIds.end(), ids.begin(), ids.end());
+    }
+
+    // Shards past the new count are now empty and can be stopped
+    while (GetNumShards() > newNumShards)
+        StopShard(GetNumShards() - 1);
+
+    SendMovies(moving, movingIds);
+    return true;
+}
+#endif
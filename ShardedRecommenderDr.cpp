@@ -0,0 +1,188 @@
+/***********************************************************************************************
+ * Name:        ShardedRecommenderDr.cpp
+ * Description: This driver tests the sharded movie catalog on a single machine. It splits
+ *              the CSV catalog across local shard processes, compares scatter-gather
+ *              recommendations with a single in-process hash table, and then changes the
+ *              shard count to show the catalog being rebalanced. Every registered policy,
+ *              with and without a popularity source, is then checked against the single
+ *              table for random viewers with watch histories, before and after movies are
+ *              deleted and inserted in both. The driver exits non-zero on any mismatch.
+ *              Usage: ShardedRecommender [numShards] [csvFile] [numViewers]
+***********************************************************************************************/
+#include <iostream>
+#include <random>
+#include "Movie.h"
+#include "Viewer.h"
+#include "HashType.h"
+#include "ScoringRegistry.h"
+#include "ShardedCatalog.h"
+#include "WireFormat.h"
+
+using namespace std;
+
+/* A fixed popularity drawn from each title, to check rescoring in the coordinator */
+class TitlePopularity : public PopularitySource {
+public:
+    double GetPopularity(const Movie& movie) const {
+        return static_cast<double>(hash<string>()(movie.GetTitle()) % 1001) / 100.0;
+    }
+};
+
+// Function prototypes
+bool sameMovies(const vector<Movie>& lhs, const vector<Movie>& rhs);
+void printShardSizes(const ShardedCatalog& catalog);
+int countMismatches(const ShardedCatalog& catalog, const HashType& movieTable, const vector<Movie>& movieList,
+    int numViewers, mt19937& random);
+
+int main(int argc, char* argv[]) {
+    int numShards = argc > 1 ? atoi(argv[1]) : 4;
+    string filename = argc > 2 ? argv[2] : "movieData.csv";
+    int numViewers = argc > 3 ? atoi(argv[3]) : 50;
+
+    vector<Movie> movieList = ReadMovieCSV(filename);
+
+    // The single-process table is the reference the sharded catalog must agree with
+    HashType movieTable;
+    for (const Movie& movie : movieList)
+        movieTable.InsertMovie(movie);
+
+    ShardedCatalog catalog(numShards);
+    bool sameIds = catalog.InsertMovies(movieList) == movieTable.FindMovieIds(movieList);
+    cout << "Loaded " << catalog.GetNumItems() << " movies into " << catalog.GetNumShards() << " shards." << endl;
+    printShardSizes(catalog);
+
+    Viewer dan("Dan", 15);
+    dan.AddPreferredGenre("Action");
+    dan.AddPreferredGenre("Comedy");
+    dan.AddFavoriteDirector("Joss Whedon");
+    dan.AddToWatchlist("Avengers: Infinity War");
+    dan.AddToWatchlist("The Hunger Games: Catching Fire");
+
+    ScoringRegistry registry;
+    for (int round = 0; round < 2; round++) {
+        for (const string& policy : registry.GetPolicyNames()) {
+            vector<Movie> sharded = catalog.Recommend(policy, dan, ScoringContext(), NUM_RECOMMENDATIONS);
+            vector<Movie> single = registry.Recommend(movieTable, policy, dan, ScoringContext(), NUM_RECOMMENDATIONS);
+            cout << "\nScoring policy: " << policy << " (matches single table: "
+                << (sameMovies(sharded, single) ? "yes" : "no") << ")" << endl;
+            movieTable.PrintRecommendations(dan, sharded);
+        }
+
+        if (round == 0) {
+            cout << "\nRebalancing from " << catalog.GetNumShards() << " to " << numShards + 2 << " shards..." << endl;
+            if (!catalog.Rebalance(numShards + 2))
+                cout << "The catalog was not rebalanced." << endl;
+            cout << "The catalog still has " << catalog.GetNumItems() << " movies." << endl;
+            printShardSizes(catalog);
+        }
+    }
+
+    // Lookups and deletes are routed to the owning shard
+    bool found;
+    Movie retrieved;
+    Movie key("Serenity", 2005, "Action", "", "", 0, 0.0);
+    catalog.RetrieveMovie(key, found, retrieved);
+    cout << "\nLookup of Serenity (2005): " << (found ? "found" : "not found") << endl;
+    catalog.DeleteMovie(key);
+    catalog.RetrieveMovie(key, found, retrieved);
+    cout << "Lookup after delete: " << (found ? "found" : "not found") << endl;
+    movieTable.DeleteMovie(key);
+
+    // Every policy must agree with the single table for any viewer, also
+    // once deletes have left gaps in the IDs that later inserts skip
+    mt19937 random(27);
+    int mismatches = countMismatches(catalog, movieTable, movieList, numViewers, random);
+    for (int i = 0; i < 200; i++) {
+        const Movie& movie = movieList[random() % movieList.size()];
+        bool inTable;
+        Movie stored;
+        movieTable.RetrieveMovie(movie, inTable, stored);
+        if (inTable) {
+            catalog.DeleteMovie(movie);
+            movieTable.DeleteMovie(movie);
+        }
+        else
+            sameIds = sameIds && catalog.InsertMovie(movie) == movieTable.InsertMovie(movie);
+    }
+    mismatches += countMismatches(catalog, movieTable, movieList, numViewers, random);
+    cout << "\nCatalog IDs match the single table: " << (sameIds ? "yes" : "NO") << endl;
+    cout << "Recommendations differing from the single table: " << mismatches << endl;
+    return sameIds && mismatches == 0 ? 0 : 1;
+}
+
+/**
+ * Compares the sharded catalog with the single table for random viewers.
+ * Each viewer prefers one or two genres, follows up to three directors and
+ * has watched up to 200 movies, some also on the watchlist by title. Every
+ * registered policy is asked for several k, without and with a popularity
+ * source.
+ *
+ * @param catalog The sharded catalog.
+ * @param movieTable The single table holding the same movies under the same IDs.
+ * @param movieList The movies genres, directors and titles are drawn from.
+ * @param numViewers The number of viewers.
+ * @param random The random number generator.
+ * @return The number of requests whose recommendations differ.
+ */
+int countMismatches(const ShardedCatalog& catalog, const HashType& movieTable, const vector<Movie>& movieList,
+    int numViewers, mt19937& random) {
+    const int sizes[] = { 1, NUM_RECOMMENDATIONS, 10, 40 };
+    TitlePopularity popularity;
+    ScoringContext withPopularity;
+    withPopularity.popularity = &popularity;
+    ScoringRegistry registry;
+    int mismatches = 0;
+    for (int v = 0; v < numViewers; v++) {
+        Viewer viewer("Viewer" + to_string(v), 20 + v % 40);
+        for (int i = 0; i <= v % 2; i++)
+            viewer.AddPreferredGenre(movieList[random() % movieList.size()].GetGenre());
+        for (int i = 0; i < v % 4; i++)
+            viewer.AddFavoriteDirector(movieList[random() % movieList.size()].GetDirector());
+        int watched = static_cast<int>(random() % 200);
+        for (int i = 0; i < watched; i++)
+            viewer.AddWatchedMovie(static_cast<MovieId>(random() % movieList.size()));
+        for (int i = 0; i < 3; i++)
+            viewer.AddToWatchlist(movieList[random() % movieList.size()].GetTitle());
+
+        for (const string& policy : registry.GetPolicyNames()) {
+            for (int k : sizes) {
+                for (const ScoringContext& context : { ScoringContext(), withPopularity }) {
+                    if (!sameMovies(catalog.Recommend(policy, viewer, context, k),
+                        registry.Recommend(movieTable, policy, viewer, context, k)))
+                        mismatches++;
+                }
+            }
+        }
+    }
+    return mismatches;
+}
+
+/**
+ * Checks if two recommendation lists hold the same movies in the same order.
+ *
+ * @param lhs The first list.
+ * @param rhs The second list.
+ * @return True if the lists are equal.
+ */
+bool sameMovies(const vector<Movie>& lhs, const vector<Movie>& rhs) {
+    if (lhs.size() != rhs.size())
+        return false;
+    for (size_t i = 0; i < lhs.size(); i++) {
+        if (!(lhs[i] == rhs[i]))
+            return false;
+    }
+    return true;
+}
+
+/**
+ * Prints how many movies each shard holds.
+ *
+ * @param catalog The sharded catalog.
+ */
+void printShardSizes(const ShardedCatalog& catalog) {
+    vector<int> sizes = catalog.GetShardSizes();
+    cout << "Shard sizes:";
+    for (int size : sizes)
+        cout << " " << size;
+    cout << endl;
+}
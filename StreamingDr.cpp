@@ -0,0 +1,167 @@
+/***********************************************************************************************
+ * Name:        StreamingDr.cpp
+ * Description: This driver tests the streaming recommender. Without a catalog file it writes
+ *              a large one by repeating the CSV catalog under new release years. It then makes
+ *              numViewers viewers with random preferred genres and favorite directors, streams
+ *              the file once through the reader, parser and evaluator threads, and reports rows
+ *              per second and how busy each stage was. When the file is small enough to load,
+ *              the streamed recommendations are checked against RankCandidates over the whole
+ *              catalog in memory.
+ *              Usage: Streaming [catalogFile|-] [numViewers] [policy] [k] [numEvaluators] [copies]
+***********************************************************************************************/
+#include <iostream>
+#include <cstdio>
+#include <random>
+#include <sys/stat.h>
+#include "Movie.h"
+#include "Viewer.h"
+#include "ScoringPolicy.h"
+#include "StreamingRecommender.h"
+#include "WireFormat.h"
+
+using namespace std;
+
+const size_t MAX_CHECKED_BYTES = 256 << 20;  // largest file loaded whole to check the results
+
+// Function prototypes
+bool writeSyntheticCatalog(const string& filename, const vector<Movie>& catalog, int copies);
+vector<Viewer> makeViewers(const vector<Movie>& catalog, int numViewers);
+template <class Policy>
+bool streamCatalog(const string& filename, const vector<Viewer>& viewers, int k, int numEvaluators);
+
+int main(int argc, char* argv[]) {
+    string filename = argc > 1 ? argv[1] : "";
+    int numViewers = argc > 2 ? atoi(argv[2]) : 100;
+    string policy = argc > 3 ? argv[3] : "weighted";
+    int k = argc > 4 ? atoi(argv[4]) : NUM_RECOMMENDATIONS;
+    int numEvaluators = argc > 5 ? atoi(argv[5]) : 2;
+    int copies = argc > 6 ? atoi(argv[6]) : 50;
+
+    vector<Movie> catalog = ReadMovieCSV("movieData.csv");
+    if (catalog.empty())
+        return 1;
+    if (filename.empty()) {
+        filename = "streamCatalog.csv";
+        if (!writeSyntheticCatalog(filename, catalog, copies))
+            return 1;
+    }
+    vector<Viewer> viewers = makeViewers(catalog, numViewers);
+
+    if (policy == "tiered")
+        return streamCatalog<TieredPolicy>(filename, viewers, k, numEvaluators) ? 0 : 1;
+    if (policy == "popularity")
+        return streamCatalog<PopularityBlendedPolicy>(filename, viewers, k, numEvaluators) ? 0 : 1;
+    if (policy == "weighted")
+        return streamCatalog<WeightedLinearPolicy>(filename, viewers, k, numEvaluators) ? 0 : 1;
+    cerr << "Error: Unknown policy " << policy << " (tiered, weighted or popularity)!" << endl;
+    return 1;
+}
+
+/**
+ * Writes a catalog file made of copies of the catalog, each copy's movies
+ * released 10000 years after the previous copy's.
+ *
+ * @param filename The file to write.
+ * @param catalog The movies to repeat.
+ * @param copies The number of copies.
+ * @return True if the whole file was written.
+ */
+bool writeSyntheticCatalog(const string& filename, const vector<Movie>& catalog, int copies) {
+    FILE* file = fopen(filename.c_str(), "wb");
+    if (!file) {
+        cerr << "Error: Could not create " << filename << "!" << endl;
+        return false;
+    }
+    fputs("Title,Year,Genre,Director,Cast,Runtime,Rating\n", file);
+    for (int copy = 0; copy < copies; copy++) {
+        for (const Movie& movie : catalog) {
+            fprintf(file, "%s,%d,%s,%s,%s,%d,%s\n", movie.GetTitle().c_str(), movie.GetYear() + 10000 * copy,
+                movie.GetGenre().c_str(), movie.GetDirector().c_str(), movie.GetCast().c_str(),
+                movie.GetRuntime(), EncodeRating(movie.GetRating()).c_str());
+        }
+    }
+    bool written = !ferror(file);
+    written = fclose(file) == 0 && written;
+    if (!written)
+        cerr << "Error: Could not write " << filename << "!" << endl;
+    return written;
+}
+
+/**
+ * Makes viewers who each prefer two random genres, follow one random director,
+ * and have five random titles on their watchlist and five random rows of the
+ * catalog among their watched IDs.
+ *
+ * @param catalog The movies the genres and directors are taken from.
+ * @param numViewers The number of viewers.
+ * @return The viewers.
+ */
+vector<Viewer> makeViewers(const vector<Movie>& catalog, int numViewers) {
+    mt19937 random(23);
+    vector<Viewer> viewers;
+    for (int v = 0; v < numViewers; v++) {
+        Viewer viewer("Viewer" + to_string(v), 18 + v % 50);
+        viewer.AddPreferredGenre(catalog[random() % catalog.size()].GetGenre());
+        viewer.AddPreferredGenre(catalog[random() % catalog.size()].GetGenre());
+        viewer.AddFavoriteDirector(catalog[random() % catalog.size()].GetDirector());
+        for (int w = 0; w < 5; w++) {
+            viewer.AddToWatchlist(catalog[random() % catalog.size()].GetTitle());
+            viewer.AddWatchedMovie(static_cast<MovieId>(random() % catalog.size()));  // a row of the first copy
+        }
+        viewers.push_back(viewer);
+    }
+    return viewers;
+}
+
+/**
+ * Streams a catalog file through one policy for every viewer and prints the
+ * throughput, each stage's busy time and a sample of the recommendations.
+ *
+ * @param filename The catalog file, or "-" for standard input.
+ * @param viewers The viewers recommended to.
+ * @param k The recommendations per viewer.
+ * @param numEvaluators The evaluator threads.
+ * @return True if the file was streamed and any check passed.
+ */
+template <class Policy>
+bool streamCatalog(const string& filename, const vector<Viewer>& viewers, int k, int numEvaluators) {
+    StreamingRecommender<Policy> recommender(viewers, ScoringContext(), k, numEvaluators);
+    if (!recommender.Run(filename))
+        return false;
+
+    double seconds = recommender.GetSeconds();
+    cout << "Streamed " << recommender.GetNumRows() << " rows (" << recommender.GetNumBytes() / (1 << 20)
+        << " MB, " << recommender.GetNumBadRows() << " bad) for " << viewers.size() << " viewers in "
+        << seconds << " seconds: " << static_cast<long>(recommender.GetNumRows() / seconds) << " rows/s, "
+        << recommender.GetNumBytes() / seconds / (1 << 20) << " MB/s." << endl;
+    cout << "Busy seconds: reader " << recommender.GetBusySeconds(0) << ", parser " << recommender.GetBusySeconds(1)
+        << ", busiest of " << numEvaluators << " evaluators " << recommender.GetBusySeconds(2) << endl;
+    if (!viewers.empty()) {
+        cout << viewers[0].GetViewerName() << " gets:";
+        for (const Movie& movie : recommender.GetResults(0))
+            cout << " " << movie.GetTitle() << " (" << movie.GetYear() << ")";
+        cout << endl;
+    }
+
+    // Loading the whole file is what streaming avoids, so only check small ones
+    struct stat status;
+    if (filename == "-" || stat(filename.c_str(), &status) != 0
+        || static_cast<size_t>(status.st_size) > MAX_CHECKED_BYTES)
+        return true;
+    vector<Movie> movies = ReadMovieCSV(filename);
+    vector<MovieId> rows;  // a movie's ID is its row in the file
+    for (size_t i = 0; i < movies.size(); i++)
+        rows.push_back(static_cast<MovieId>(i));
+    size_t mismatches = 0;
+    for (size_t v = 0; v < viewers.size(); v++) {
+        vector<Movie> expected = RankCandidates<Policy>(movies, rows, viewers[v], ScoringContext(), k);
+        const vector<Movie>& actual = recommender.GetResults(v);
+        bool same = expected.size() == actual.size();
+        for (size_t i = 0; same && i < expected.size(); i++)
+            same = EncodeMovie(expected[i]) == EncodeMovie(actual[i]);
+        mismatches += !same;
+    }
+    cout << "Matches RankCandidates over the loaded catalog for " << viewers.size() - mismatches << " of "
+        << viewers.size() << " viewers." << endl;
+    return mismatches == 0;
+}
@@ -0,0 +1,430 @@
+/**
+ * StreamingRecommender.h
+ * The StreamingRecommender class recommends movies to a set of viewers in one
+ * pass over a catalog CSV file, without building a HashType. The file flows
+ * through a pipeline of threads joined by bounded queues:
+ *   reader     reads blocks of whole lines (STREAM_BLOCK_BYTES at a time);
+ *   parser     turns each block into a batch of Movies;
+ *   evaluators each own a share of the viewers and offer every movie of
+ *              every batch to their viewers' scoring policies.
+ * A full queue stops the stage feeding it, so at most STREAM_QUEUE_DEPTH
+ * blocks and batches per queue are in memory however large the file is.
+ * Every policy keeps O(k) movies per viewer (TieredPolicy also one per
+ * preferred genre), so the whole run needs memory for the queues and that
+ * much per viewer. A movie's ID is its row: its position among the parsed
+ * rows of the file, counting from 0. Movies reach each policy in file order
+ * and skip the viewer's watched IDs and watchlist titles, so the results
+ * equal those of RankCandidates over the whole file with rows as IDs.
+ **/
+
+#ifndef STREAMINGRECOMMENDER_H
+#define STREAMINGRECOMMENDER_H
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+#include <fcntl.h>
+#include "Movie.h"
+#include "Viewer.h"
+#include "RoaringBitmap.h"
+#include "ScoringPolicy.h"
+#include "WireFormat.h"
+
+using namespace std;
+
+const size_t STREAM_BLOCK_BYTES = 1 << 20;  // bytes the reader hands on at a time
+const size_t STREAM_QUEUE_DEPTH = 8;        // blocks or batches waiting between two stages
+
+template <class T>
+class BoundedQueue {
+public:
+    // Class constructor, for a queue holding at most capacity items
+    BoundedQueue(size_t capacity);
+
+    bool Push(T item);
+    // Function: Adds an item, waiting while the queue is full.
+    // Post: Returns true if the item was queued; false if the queue is closed.
+
+    bool Pop(T& item);
+    // Function: Takes the oldest item, waiting while the queue is empty.
+    // Post: Returns true and sets item if there was one; false once the
+    //       queue is closed and empty.
+
+    void Close();
+    // Function: Tells consumers no more items will come.
+    // Post: Pop returns false once the queue is drained.
+
+private:
+    size_t capacity;             // most items held at once
+    deque<T> items;              // queued items, oldest first
+    bool closed;                 // no more items will be pushed
+    mutex queueMutex;            // guards the fields above
+    condition_variable notFull;  // signalled when an item is taken
+    condition_variable notEmpty; // signalled when an item is added or on Close
+};
+
+template <class T>
+BoundedQueue<T>::BoundedQueue(size_t capacity) : capacity(max<size_t>(1, capacity)), closed(false) {
+}
+
+template <class T>
+bool BoundedQueue<T>::Push(T item) {
+    // Function: Adds an item, waiting while the queue is full.
+    // Post: Returns true if the item was queued; false if the queue is closed.
+    {
+        unique_lock<mutex> lock(queueMutex);
+        notFull.wait(lock, [this] { return closed || items.size() < capacity; });
+        if (closed)
+            return false;
+        items.push_back(move(item));
+    }
+    notEmpty.notify_one();
+    return true;
+}
+
+template <class T>
+bool BoundedQueue<T>::Pop(T& item) {
+    // Function: Takes the oldest item, waiting while the queue is empty.
+    // Post: Returns true and sets item if there was one; false once the
+    //       queue is closed and empty.
+    {
+        unique_lock<mutex> lock(queueMutex);
+        notEmpty.wait(lock, [this] { return closed || !items.empty(); });
+        if (items.empty())
+            return false;
+        item = move(items.front());
+        items.pop_front();
+    }
+    notFull.notify_one();
+    return true;
+}
+
+template <class T>
+void BoundedQueue<T>::Close() {
+    // Function: Tells consumers no more items will come.
+    // Post: Pop returns false once the queue is drained.
+    {
+        lock_guard<mutex> lock(queueMutex);
+        closed = true;
+    }
+    notEmpty.notify_all();
+    notFull.notify_all();
+}
+
+template <class Policy>
+class StreamingRecommender {
+public:
+    // Class constructor, for k recommendations per viewer spread over numEvaluators threads
+    StreamingRecommender(const vector<Viewer>& viewers, const ScoringContext& context, int k, int numEvaluators = 1);
+
+    bool Run(const string& filename);
+    // Function: Streams a catalog CSV file through the viewers' policies.
+    // Pre:  The first line of the file is a header. "-" reads standard input.
+    // Post: Returns true if the whole file was read; every viewer's results
+    //       are then ready. Otherwise, prints an error and returns false.
+
+    const vector<Movie>& GetResults(size_t viewer) const;
+    // Function: Gets the recommendations of one viewer after Run.
+    // Pre:  viewer < number of viewers given to the constructor.
+    // Post: Function value = up to k movies chosen by Policy, best first.
+
+    size_t GetNumRows() const;
+    // Function: Gets the number of catalog rows the last Run parsed.
+
+    size_t GetNumBadRows() const;
+    // Function: Gets the number of rows the last Run could not parse.
+
+    size_t GetNumBytes() const;
+    // Function: Gets the number of bytes the last Run read.
+
+    double GetSeconds() const;
+    // Function: Gets the wall time of the last Run.
+
+    double GetBusySeconds(int stage) const;
+    // Function: Gets the time a stage spent working rather than waiting on a
+    //           queue: 0 = reader, 1 = parser, 2 = the busiest evaluator.
+
+private:
+    struct MovieBatch {
+        size_t firstRow;       // row of the first movie
+        vector<Movie> movies;  // parsed rows, in file order
+    };
+    typedef shared_ptr<const MovieBatch> Batch;
+
+    void ReadBlocks(FILE* file, BoundedQueue<string>& blocks);
+    // Function: Reads the file in blocks that end on a line break.
+    // Post: blocks is closed once the file is read or a read fails.
+
+    void ParseBlocks(BoundedQueue<string>& blocks, vector<unique_ptr<BoundedQueue<Batch>>>& batches);
+    // Function: Parses blocks into batches of movies and hands every batch
+    //           to every evaluator.
+    // Post: Every batch queue is closed once blocks is drained.
+
+    void Evaluate(int evaluator, BoundedQueue<Batch>& batches);
+    // Function: Offers each movie the viewer has not watched to the policies
+    //           of the evaluator's viewers.
+    // Post: The evaluator's viewers have their results.
+
+    struct ViewerState {
+        Policy policy;                   // running top k for the viewer
+        unordered_set<string> watched;   // the viewer's watchlist
+        RoaringBitmap watchedRows;       // the viewer's watched IDs, as rows
+        vector<Movie> results;           // set once the stream is done
+
+        ViewerState(const Viewer& viewer, const ScoringContext& context, int k);
+    };
+
+    vector<Viewer> viewers;          // the viewers recommended to
+    ScoringContext context;          // weights shared by the policies
+    int k;                           // recommendations per viewer
+    int numEvaluators;               // evaluator threads
+    vector<ViewerState> states;      // one per viewer
+    size_t numRows;                  // rows parsed
+    size_t numBadRows;               // rows that did not parse
+    size_t numBytes;                 // bytes read
+    bool readFailed;                 // the reader hit an error
+    double seconds;                  // wall time of Run
+    double busySeconds[3];           // working time of reader, parser, busiest evaluator
+    vector<double> evaluatorSeconds; // working time of each evaluator
+};
+
+template <class Policy>
+StreamingRecommender<Policy>::ViewerState::ViewerState(const Viewer& viewer, const ScoringContext& context, int k)
+    : policy(viewer, context, k), watchedRows(viewer.GetWatchedSet()) {
+    for (const string& title : viewer.GetWatchlist())
+        watched.insert(title);
+}
+
+template <class Policy>
+StreamingRecommender<Policy>::StreamingRecommender(const vector<Viewer>& viewers, const ScoringContext& context,
+    int k, int numEvaluators)
+    : viewers(viewers), context(context), k(k), numEvaluators(max(1, numEvaluators)) {
+    numRows = numBadRows = numBytes = 0;
+    readFailed = false;
+    seconds = 0.0;
+    busySeconds[0] = busySeconds[1] = busySeconds[2] = 0.0;
+}
+
+template <class Policy>
+bool StreamingRecommender<Policy>::Run(const string& filename) {
+    // Function: Streams a catalog CSV file through the viewers' policies.
+    // Pre:  The first line of the file is a header. "-" reads standard input.
+    // Post: Returns true if the whole file was read; every viewer's results
+    //       are then ready. Otherwise, prints an error and returns false.
+    FILE* file = filename == "-" ? stdin : fopen(filename.c_str(), "rb");
+    if (!file) {
+        cerr << "Error: Could not open the catalog " << filename << "!" << endl;
+        return false;
+    }
+    // The file is read once from start to end; let the kernel read ahead
+    posix_fadvise(fileno(file), 0, 0, POSIX_FADV_SEQUENTIAL);
+
+    states.clear();
+    states.reserve(viewers.size());
+    for (const Viewer& viewer : viewers)
+        states.push_back(ViewerState(viewer, context, k));
+    numRows = numBadRows = numBytes = 0;
+    readFailed = false;
+    evaluatorSeconds.assign(numEvaluators, 0.0);
+
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    BoundedQueue<string> blocks(STREAM_QUEUE_DEPTH);
+    vector<unique_ptr<BoundedQueue<Batch>>> batches;
+    for (int e = 0; e < numEvaluators; e++)
+        batches.push_back(unique_ptr<BoundedQueue<Batch>>(new BoundedQueue<Batch>(STREAM_QUEUE_DEPTH)));
+
+    vector<thread> evaluators;
+    for (int e = 0; e < numEvaluators; e++)
+        evaluators.push_back(thread(&StreamingRecommender::Evaluate, this, e, ref(*batches[e])));
+    thread parser(&StreamingRecommender::ParseBlocks, this, ref(blocks), ref(batches));
+    ReadBlocks(file, blocks);
+    parser.join();
+    for (thread& evaluator : evaluators)
+        evaluator.join();
+    if (file != stdin)
+        fclose(file);
+
+    seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    busySeconds[2] = *max_element(evaluatorSeconds.begin(), evaluatorSeconds.end());
+    if (readFailed)
+        cerr << "Error: Could not read the catalog " << filename << "!" << endl;
+    return !readFailed;
+}
+
+template <class Policy>
+void StreamingRecommender<Policy>::ReadBlocks(FILE* file, BoundedQueue<string>& blocks) {
+    // Function: Reads the file in blocks that end on a line break.
+    // Post: blocks is closed once the file is read or a read fails.
+    double busy = 0.0;
+    string carry;  // the start of a line cut off by the end of the last block
+    while (true) {
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        string block;
+        block.reserve(carry.size() + STREAM_BLOCK_BYTES);
+        block.swap(carry);
+        size_t previous = block.size();
+        block.resize(previous + STREAM_BLOCK_BYTES);
+        size_t n = fread(&block[previous], 1, STREAM_BLOCK_BYTES, file);
+        block.resize(previous + n);
+        numBytes += n;
+        if (n == 0) {
+            readFailed = ferror(file) != 0;
+            busy += chrono::duration<double>(chrono::steady_clock::now() - start).count();
+            if (!block.empty())
+                blocks.Push(move(block));
+            break;
+        }
+
+        // Keep the partial last line for the next block
+        size_t lastBreak = block.rfind('\n');
+        if (lastBreak != string::npos) {
+            carry.assign(block, lastBreak + 1, string::npos);
+            block.resize(lastBreak + 1);
+        }
+        else {
+            carry.swap(block);  // no line break yet: keep reading
+            continue;
+        }
+        busy += chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        blocks.Push(move(block));
+    }
+    blocks.Close();
+    busySeconds[0] = busy;
+}
+
+template <class Policy>
+void StreamingRecommender<Policy>::ParseBlocks(BoundedQueue<string>& blocks,
+    vector<unique_ptr<BoundedQueue<Batch>>>& batches) {
+    // Function: Parses blocks into batches of movies and hands every batch
+    //           to every evaluator.
+    // Post: Every batch queue is closed once blocks is drained.
+    double busy = 0.0;
+    bool header = true;
+    string block;
+    while (blocks.Pop(block)) {
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        shared_ptr<MovieBatch> batch = make_shared<MovieBatch>();
+        batch->firstRow = numRows;
+        vector<Movie>& movies = batch->movies;
+        const char* line = block.data();
+        const char* end = line + block.size();
+        while (line < end) {
+            const char* lineEnd = static_cast<const char*>(memchr(line, '\n', end - line));
+            if (!lineEnd)
+                lineEnd = end;
+            const char* rowEnd = lineEnd > line && lineEnd[-1] == '\r' ? lineEnd - 1 : lineEnd;
+            if (header)
+                header = false;  // skip the header line
+            else if (rowEnd > line) {
+                Movie movie;
+                if (ParseMovieCSVRow(line, rowEnd, movie))
+                    movies.push_back(move(movie));
+                else
+                    numBadRows++;
+            }
+            line = lineEnd + 1;
+        }
+        numRows += movies.size();
+        busy += chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+        for (unique_ptr<BoundedQueue<Batch>>& queue : batches)
+            queue->Push(batch);
+    }
+    for (unique_ptr<BoundedQueue<Batch>>& queue : batches)
+        queue->Close();
+    busySeconds[1] = busy;
+}
+
+template <class Policy>
+void StreamingRecommender<Policy>::Evaluate(int evaluator, BoundedQueue<Batch>& batches) {
+    // Function: Offers each movie the viewer has not watched to the policies
+    //           of the evaluator's viewers.
+    // Post: The evaluator's viewers have their results.
+    double busy = 0.0;
+    // Titles and rows any of the evaluator's viewers watched; most movies are
+    // on none, so one lookup per movie spares a lookup per viewer
+    unordered_set<string> anyWatched;
+    RoaringBitmap anyWatchedRows;
+    for (size_t v = evaluator; v < states.size(); v += numEvaluators) {
+        anyWatched.insert(states[v].watched.begin(), states[v].watched.end());
+        anyWatchedRows = anyWatchedRows.Or(states[v].watchedRows);
+    }
+
+    Batch batch;
+    vector<char> maybeWatched;
+    while (batches.Pop(batch)) {
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        const vector<Movie>& movies = batch->movies;
+        maybeWatched.assign(movies.size(), 0);
+        if (!anyWatched.empty() || !anyWatchedRows.IsEmpty()) {
+            for (size_t i = 0; i < movies.size(); i++) {
+                maybeWatched[i] = anyWatched.count(movies[i].GetTitle()) > 0 ||
+                    anyWatchedRows.Contains(static_cast<uint32_t>(batch->firstRow + i));
+            }
+        }
+        // Viewer by viewer, so each policy's state stays in cache for the whole batch
+        for (size_t v = evaluator; v < states.size(); v += numEvaluators) {
+            ViewerState& state = states[v];
+            for (size_t i = 0; i < movies.size(); i++) {
+                if (!maybeWatched[i] ||
+                    (!state.watchedRows.Contains(static_cast<uint32_t>(batch->firstRow + i)) &&
+                     state.watched.find(movies[i].GetTitle()) == state.watched.end()))
+                    state.policy.Consider(movies[i], static_cast<MovieId>(batch->firstRow + i));
+            }
+        }
+        busy += chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    }
+    for (size_t v = evaluator; v < states.size(); v += numEvaluators)
+        states[v].results = states[v].policy.Results();
+    evaluatorSeconds[evaluator] = busy;
+}
+
+template <class Policy>
+const vector<Movie>& StreamingRecommender<Policy>::GetResults(size_t viewer) const {
+    // Function: Gets the recommendations of one viewer after Run.
+    // Pre:  viewer < number of viewers given to the constructor.
+    // Post: Function value = up to k movies chosen by Policy, best first.
+    return states[viewer].results;
+}
+
+template <class Policy>
+size_t StreamingRecommender<Policy>::GetNumRows() const {
+    // Function: Gets the number of catalog rows the last Run parsed.
+    return numRows;
+}
+
+template <class Policy>
+size_t StreamingRecommender<Policy>::GetNumBadRows() const {
+    // Function: Gets the number of rows the last Run could not parse.
+    return numBadRows;
+}
+
+template <class Policy>
+size_t StreamingRecommender<Policy>::GetNumBytes() const {
+    // Function: Gets the number of bytes the last Run read.
+    return numBytes;
+}
+
+template <class Policy>
+double StreamingRecommender<Policy>::GetSeconds() const {
+    // Function: Gets the wall time of the last Run.
+    return seconds;
+}
+
+template <class Policy>
+double StreamingRecommender<Policy>::GetBusySeconds(int stage) const {
+    // Function: Gets the time a stage spent working rather than waiting on a
+    //           queue: 0 = reader, 1 = parser, 2 = the busiest evaluator.
+    return stage >= 0 && stage < 3 ? busySeconds[stage] : 0.0;
+}
+#endif
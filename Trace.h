@@ -0,0 +1,210 @@
+/**
+ * Trace.h
+ * Scoped trace spans for finding where a slow request spent its time. A span
+ * records its name, start and duration in nanoseconds into a ring buffer owned
+ * by the calling thread, so recording takes no locks and never waits on other
+ * threads. The buffers can be written out as Chrome trace JSON, which opens in
+ * chrome://tracing or Perfetto.
+ *
+ * Tracing is compiled in only when MOVIE_TRACE is defined; otherwise every
+ * macro below expands to nothing. When compiled in, TRACE_SAMPLED_REQUEST()
+ * at the top of a request records only one request in every N (see
+ * TRACE_SET_SAMPLING), so it can stay on under production traffic.
+ *   TRACE_SPAN("name");           time the rest of the enclosing scope
+ *   TRACE_SAMPLED_REQUEST();      decide whether this request is recorded
+ *   TRACE_SET_SAMPLING(n);        record one request in every n
+ *   TRACE_WRITE_CHROME("file");   export every thread's buffer
+ **/
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#ifdef MOVIE_TRACE
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+const size_t TRACE_BUFFER_EVENTS = 1 << 17;  // events kept per thread (a power of 2)
+
+struct TraceEvent {
+    const char* name;    // span name (a string literal)
+    uint64_t start;      // nanoseconds on the steady clock
+    uint64_t duration;   // nanoseconds
+};
+
+class TraceBuffer {
+public:
+    // Class constructor, for the thread numbered threadId
+    TraceBuffer(int threadId);
+
+    void Record(const char* name, uint64_t start, uint64_t duration);
+    // Function: Appends an event, overwriting the oldest one when full.
+    // Pre:  Called only by the owning thread.
+    // Post: The event is the newest one in the buffer.
+
+    vector<TraceEvent> Snapshot() const;
+    // Function: Copies the events currently held.
+    // Post: Function value = held events, oldest first. Events being
+    //       overwritten while the copy runs may be torn.
+
+    int GetThreadId() const;
+    // Function: Gets the number of the owning thread.
+
+private:
+    int threadId;                 // small number identifying the owning thread
+    atomic<uint64_t> head;        // number of events ever recorded
+    vector<TraceEvent> events;    // ring of the most recent events
+};
+
+TraceBuffer::TraceBuffer(int threadId) : threadId(threadId), head(0), events(TRACE_BUFFER_EVENTS) {
+}
+
+void TraceBuffer::Record(const char* name, uint64_t start, uint64_t duration) {
+    // Function: Appends an event, overwriting the oldest one when full.
+    // Pre:  Called only by the owning thread.
+    // Post: The event is the newest one in the buffer.
+    uint64_t position = head.load(memory_order_relaxed);
+    TraceEvent& event = events[position & (TRACE_BUFFER_EVENTS - 1)];
+    event.name = name;
+    event.start = start;
+    event.duration = duration;
+    head.store(position + 1, memory_order_release);  // publish to Snapshot
+}
+
+vector<TraceEvent> TraceBuffer::Snapshot() const {
+    // Function: Copies the events currently held.
+    // Post: Function value = held events, oldest first. Events being
+    //       overwritten while the copy runs may be torn.
+    uint64_t end = head.load(memory_order_acquire);
+    uint64_t begin = end > TRACE_BUFFER_EVENTS ? end - TRACE_BUFFER_EVENTS : 0;
+    vector<TraceEvent> copy;
+    copy.reserve(end - begin);
+    for (uint64_t position = begin; position < end; position++)
+        copy.push_back(events[position & (TRACE_BUFFER_EVENTS - 1)]);
+    return copy;
+}
+
+int TraceBuffer::GetThreadId() const {
+    // Function: Gets the number of the owning thread.
+    return threadId;
+}
+
+/* Every thread's buffer, kept alive after the thread exits so it can still be exported */
+mutex traceRegistryMutex;
+vector<shared_ptr<TraceBuffer>> traceBuffers;
+atomic<int> traceSampleEvery(1);   // record one request in every traceSampleEvery
+thread_local bool traceActive = true;  // spans on this thread are being recorded
+thread_local TraceBuffer* traceBuffer = nullptr;
+
+uint64_t TraceNow() {
+    // Function: Reads the steady clock.
+    // Post: Function value = nanoseconds since an arbitrary fixed point.
+    return static_cast<uint64_t>(chrono::duration_cast<chrono::nanoseconds>(
+        chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+TraceBuffer* GetTraceBuffer() {
+    // Function: Gets the calling thread's buffer, creating it on first use.
+    // Post: The buffer is registered for export.
+    if (!traceBuffer) {
+        lock_guard<mutex> lock(traceRegistryMutex);
+        traceBuffers.push_back(make_shared<TraceBuffer>(static_cast<int>(traceBuffers.size()) + 1));
+        traceBuffer = traceBuffers.back().get();
+    }
+    return traceBuffer;
+}
+
+class TraceSpan {
+public:
+    // Starts timing a span named name (a string literal)
+    TraceSpan(const char* name) : name(name), start(traceActive ? TraceNow() : 0) {}
+
+    // Records the span if this thread is being traced
+    ~TraceSpan() {
+        if (start != 0)
+            GetTraceBuffer()->Record(name, start, TraceNow() - start);
+    }
+
+private:
+    const char* name;   // span name
+    uint64_t start;     // start time, or 0 when not recording
+};
+
+class TraceSampleScope {
+public:
+    // Decides whether the request starting now is recorded
+    TraceSampleScope() : previous(traceActive) {
+        thread_local uint64_t requests = 0;
+        int every = traceSampleEvery.load(memory_order_relaxed);
+        traceActive = every > 0 && ++requests % static_cast<uint64_t>(every) == 0;
+    }
+
+    // Restores the thread's previous setting
+    ~TraceSampleScope() { traceActive = previous; }
+
+private:
+    bool previous;   // traceActive before the request
+};
+
+void SetTraceSampling(int every) {
+    // Function: Sets how many requests share one recorded request.
+    // Post: One request in every `every` is recorded; 0 records none.
+    traceSampleEvery = every;
+}
+
+bool WriteChromeTrace(const string& filename) {
+    // Function: Writes every thread's events as Chrome trace JSON.
+    // Post: Returns true if filename was written. Otherwise, prints an error.
+    ofstream file(filename);
+    if (!file.is_open()) {
+        cerr << "Error: Could not write the trace file " << filename << "!" << endl;
+        return false;
+    }
+
+    vector<shared_ptr<TraceBuffer>> buffers;
+    {
+        lock_guard<mutex> lock(traceRegistryMutex);
+        buffers = traceBuffers;
+    }
+
+    file << "{\"traceEvents\":[";
+    bool first = true;
+    file.setf(ios::fixed);
+    file.precision(3);
+    for (const shared_ptr<TraceBuffer>& buffer : buffers) {
+        for (const TraceEvent& event : buffer->Snapshot()) {
+            file << (first ? "\n" : ",\n") << "{\"name\":\"" << event.name
+                << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer->GetThreadId()
+                << ",\"ts\":" << event.start / 1000.0 << ",\"dur\":" << event.duration / 1000.0 << "}";
+            first = false;
+        }
+    }
+    file << "\n],\"displayTimeUnit\":\"ns\"}\n";
+    return true;
+}
+
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+#define TRACE_SPAN(name) TraceSpan TRACE_CONCAT(traceSpan, __LINE__)(name)
+#define TRACE_SAMPLED_REQUEST() TraceSampleScope TRACE_CONCAT(traceSample, __LINE__)
+#define TRACE_SET_SAMPLING(every) SetTraceSampling(every)
+#define TRACE_WRITE_CHROME(filename) WriteChromeTrace(filename)
+
+#else
+
+#define TRACE_SPAN(name) do {} while (0)
+#define TRACE_SAMPLED_REQUEST() do {} while (0)
+#define TRACE_SET_SAMPLING(every) do {} while (0)
+#define TRACE_WRITE_CHROME(filename) do {} while (0)
+
+#endif
+#endif
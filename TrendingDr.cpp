@@ -0,0 +1,126 @@
+/***********************************************************************************************
+ * Name:        TrendingDr.cpp
+ * Description: This driver feeds a stream of watch events into the trending signal and blends
+ *              the result into recommendations. Events are lines of viewer, title and timestamp
+ *              separated by tabs, read from a file or from standard input ("-"). Without an
+ *              event file, a synthetic week of events is written to watchEvents.tsv first: titles
+ *              follow a Zipf distribution, and a different set of titles trends in the last day.
+ *              The driver reports the ingest rate, the sketch's memory, the top trending titles,
+ *              and Dan's recommendations with and without the signal.
+ *              Usage: Trending [eventFile|-] [halfLifeHours] [numSyntheticEvents]
+***********************************************************************************************/
+#include <iostream>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include "Movie.h"
+#include "Viewer.h"
+#include "HashType.h"
+#include "TrendingSignal.h"
+#include "WireFormat.h"
+
+using namespace std;
+typedef chrono::steady_clock Clock;
+
+// Function prototypes
+bool writeSyntheticEvents(const string& filename, const vector<Movie>& catalog, long count);
+
+int main(int argc, char* argv[]) {
+    string eventFile = argc > 1 ? argv[1] : "";
+    double halfLifeHours = argc > 2 ? atof(argv[2]) : 24.0;
+    long numEvents = argc > 3 ? atol(argv[3]) : 5000000;
+
+    vector<Movie> catalog = ReadMovieCSV("movieData.csv");
+    HashType movieTable;
+    for (const Movie& movie : catalog)
+        movieTable.InsertMovie(movie);
+
+    if (eventFile.empty()) {
+        eventFile = "watchEvents.tsv";
+        cout << "Writing " << numEvents << " synthetic watch events to " << eventFile << "..." << endl;
+        if (!writeSyntheticEvents(eventFile, catalog, numEvents))
+            return 1;
+    }
+
+    TrendingSignal trending(halfLifeHours * 3600.0);
+    Clock::time_point start = Clock::now();
+    long added = trending.IngestFile(eventFile);
+    double seconds = chrono::duration<double>(Clock::now() - start).count();
+    if (added < 0)
+        return 1;
+
+    cout << "Ingested " << added << " events in " << seconds << " seconds ("
+        << added / seconds / 1e6 << " million events/second)." << endl;
+    cout << "Sketch and heavy hitters use " << trending.GetMemoryBytes() / 1024 << " KB." << endl;
+
+    cout << "\nTrending now (half-life " << halfLifeHours << " hours):" << endl;
+    for (const pair<string, double>& title : trending.GetTrending(10))
+        cout << "  " << title.first << " (" << title.second << " recent watches)" << endl;
+
+    Viewer dan("Dan", 15);
+    dan.AddPreferredGenre("Action");
+    dan.AddPreferredGenre("Comedy");
+    dan.AddFavoriteDirector("Joss Whedon");
+    dan.AddToWatchlist("Avengers: Infinity War");
+    dan.AddToWatchlist("The Hunger Games: Catching Fire");
+
+    ScoringContext context;
+    cout << "\nRating only:" << endl;
+    movieTable.PrintRecommendations(dan,
+        movieTable.GetRecommendations<PopularityBlendedPolicy>(dan, context, NUM_RECOMMENDATIONS));
+
+    context.popularity = &trending;
+    cout << "\nRating blended with trending popularity:" << endl;
+    movieTable.PrintRecommendations(dan,
+        movieTable.GetRecommendations<PopularityBlendedPolicy>(dan, context, NUM_RECOMMENDATIONS));
+    return 0;
+}
+
+/**
+ * Writes a week of synthetic watch events. Titles are drawn from a Zipf
+ * distribution over the catalog; in the last day every draw is moved 200
+ * places down the catalog, so a different set of titles starts trending.
+ *
+ * @param filename The file to write.
+ * @param catalog The movies whose titles are watched.
+ * @param count The number of events to write.
+ * @return True if the file was written. Otherwise, prints an error and returns false.
+ */
+bool writeSyntheticEvents(const string& filename, const vector<Movie>& catalog, long count) {
+    if (catalog.empty()) {
+        cerr << "Error: No movies to generate events for!" << endl;
+        return false;
+    }
+    FILE* file = fopen(filename.c_str(), "wb");
+    if (!file) {
+        cerr << "Error: Could not write the event file " << filename << "!" << endl;
+        return false;
+    }
+
+    // Cumulative Zipf weights with exponent 1.1
+    vector<double> cumulative(catalog.size());
+    double total = 0.0;
+    for (size_t rank = 0; rank < catalog.size(); rank++) {
+        total += 1.0 / pow(rank + 1.0, 1.1);
+        cumulative[rank] = total;
+    }
+
+    mt19937_64 random(2024);
+    uniform_real_distribution<double> uniform(0.0, total);
+    const int64_t weekStart = 1700000000;
+    const int64_t week = 7 * 86400;
+    const size_t trendShift = 200;  // ranks moved in the last day
+
+    for (long i = 0; i < count; i++) {
+        int64_t timestamp = weekStart + week * i / count;
+        size_t rank = lower_bound(cumulative.begin(), cumulative.end(), uniform(random)) - cumulative.begin();
+        if (timestamp >= weekStart + week - 86400)
+            rank = (rank + trendShift) % catalog.size();
+        fprintf(file, "viewer%ld\t%s\t%lld\n", static_cast<long>(random() % 1000000),
+            catalog[rank].GetTitle().c_str(), static_cast<long long>(timestamp));
+    }
+    fclose(file);
+    return true;
+}
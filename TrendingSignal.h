@@ -0,0 +1,385 @@
+/**
+ * TrendingSignal.h
+ * The TrendingSignal class turns a stream of watch events into a per-movie
+ * popularity score. Each event (viewer, title, timestamp) adds to a
+ * count-min sketch of watch counts, and a small heavy-hitters list keeps the
+ * most watched titles. Counts decay exponentially with a configurable
+ * half-life, so a burst of recent watches outweighs an old one. Memory is
+ * fixed when the signal is created and does not grow with the number of
+ * titles or events.
+ * Decay uses forward decay: an event at time t is added with weight
+ * 2^((t - landmark) / halfLife), and every count is divided by the same
+ * factor for the current time when it is read. Adding an event therefore
+ * never touches the other counters, and events may arrive out of order.
+ * Whenever a weight would pass DECAY_RESCALE, or the read-side factor drop
+ * below its inverse, the landmark moves to the current time and every
+ * counter is rescaled, so neither overflows nor underflows.
+ * Events are read as lines of viewer, title and timestamp (whole seconds)
+ * separated by tabs.
+ **/
+
+#ifndef TRENDINGSIGNAL_H
+#define TRENDINGSIGNAL_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "Movie.h"
+#include "ProbingPolicy.h"
+#include "ScoringPolicy.h"
+
+using namespace std;
+
+const int SKETCH_WIDTH = 1 << 16;   // default counters per sketch row (a power of 2)
+const int SKETCH_DEPTH = 4;         // default sketch rows
+const int TRENDING_TOP_K = 256;     // default heavy hitters kept
+const double DECAY_RESCALE = 1e100; // forward-decay weight at which counters are rescaled
+const size_t EVENT_READ_CHUNK = 1 << 20;  // bytes read from an event stream at a time
+
+class TrendingSignal : public PopularitySource {
+public:
+    // Class constructor, with counts halving every halfLifeSeconds
+    TrendingSignal(double halfLifeSeconds = 86400.0, int width = SKETCH_WIDTH,
+        int depth = SKETCH_DEPTH, int topK = TRENDING_TOP_K);
+
+    void AddEvent(const char* title, size_t length, int64_t timestamp);
+    // Function: Records one watch of a title.
+    // Post: The title's count includes the event. The current time is
+    //       advanced to timestamp if it is later.
+
+    void AddEvent(const string& title, int64_t timestamp);
+    // Function: Records one watch of a title.
+    // Post: Same as above.
+
+    long IngestStream(FILE* stream);
+    // Function: Reads watch events until the end of a stream.
+    // Pre:  stream is open for reading.
+    // Post: Function value = number of events added. Malformed lines are skipped.
+
+    long IngestFile(const string& filename);
+    // Function: Reads watch events from a file ("-" reads standard input).
+    // Post: Function value = number of events added, or -1 if the file could
+    //       not be opened (an error is printed).
+
+    void AdvanceTo(int64_t now);
+    // Function: Moves the current time forward without adding an event.
+    // Post: Counts are read as of now if now is later than the current time.
+
+    double GetCount(const string& title) const;
+    // Function: Estimates a title's decayed watch count at the current time.
+    // Post: Function value >= the true decayed count; it overestimates by at
+    //       most a small fraction of all decayed watches.
+
+    vector<pair<string, double>> GetTrending(int n) const;
+    // Function: Gets the most watched titles.
+    // Post: Function value = up to n (title, decayed count) pairs, highest first.
+
+    double GetPopularity(const Movie& movie) const override;
+    // Function: Gets how popular a movie currently is.
+    // Pre:  Movie has been initialized.
+    // Post: Function value = 10 * log(1 + count) / log(1 + top count), so the
+    //       most watched title scores 10 and unwatched titles score 0.
+    //       Function value = 0 if the top count has decayed to 0.
+
+    long GetNumEvents() const;
+    // Function: Gets the number of events added so far.
+
+    size_t GetMemoryBytes() const;
+    // Function: Gets the memory held by the sketch and the heavy hitters.
+    // Post: Function value is fixed at construction (titles aside).
+
+private:
+    struct HeavyHitter {
+        uint64_t hash;    // hash of the title
+        string title;     // title as first seen
+        double weight;    // forward-decayed count
+    };
+
+    double Estimate(uint64_t hash) const;
+    // Function: Reads a title's forward-decayed count from the sketch.
+
+    double Add(uint64_t hash, double weight);
+    // Function: Adds weight to a title with a conservative update.
+    // Post: Function value = the title's new forward-decayed count.
+
+    void OfferHeavyHitter(uint64_t hash, const char* title, size_t length, double weight);
+    // Function: Keeps a title among the heavy hitters if its count is high enough.
+
+    double Decay() const;
+    // Function: Gets the factor that turns a forward-decayed count into a count now.
+
+    void Rescale(int64_t newLandmark);
+    // Function: Moves the landmark so forward-decay weights stay in range.
+
+    double halfLife;        // seconds for a count to halve
+    int width;              // counters per row
+    int depth;              // number of rows
+    int topK;               // heavy hitters kept
+    int64_t landmark;       // time at which an event weighs 1
+    int64_t now;            // latest time seen
+    bool started;           // whether any event has been seen
+    long numEvents;         // events added
+    vector<double> counters;         // depth rows of width counters
+    vector<HeavyHitter> heavyHitters;        // at most topK titles
+    unordered_map<uint64_t, int> heavyIndex; // title hash -> position in heavyHitters
+    int minHeavy;           // position of the smallest heavy hitter
+    double topWeight;       // forward-decayed count of the largest heavy hitter
+};
+
+TrendingSignal::TrendingSignal(double halfLifeSeconds, int width, int depth, int topK)
+    : halfLife(max(1.0, halfLifeSeconds)), width(1), depth(max(1, depth)), topK(max(1, topK)),
+      landmark(0), now(0), started(false), numEvents(0), minHeavy(0), topWeight(0.0) {
+    while (this->width < width)
+        this->width *= 2;
+    counters.assign(static_cast<size_t>(this->width) * this->depth, 0.0);
+    heavyHitters.reserve(this->topK);
+    heavyIndex.reserve(this->topK * 2);
+}
+
+void TrendingSignal::AddEvent(const char* title, size_t length, int64_t timestamp) {
+    // Function: Records one watch of a title.
+    // Post: The title's count includes the event. The current time is
+    //       advanced to timestamp if it is later.
+    if (!started) {
+        landmark = now = timestamp;
+        started = true;
+    }
+    now = max(now, timestamp);
+
+    double weight = exp2((timestamp - landmark) / halfLife);
+    if (weight > DECAY_RESCALE) {
+        Rescale(timestamp);
+        weight = 1.0;
+    }
+
+    uint64_t hash = MixHash(title, length);
+    double count = Add(hash, weight);
+    OfferHeavyHitter(hash, title, length, count);
+    numEvents++;
+}
+
+void TrendingSignal::AddEvent(const string& title, int64_t timestamp) {
+    // Function: Records one watch of a title.
+    // Post: Same as above.
+    AddEvent(title.data(), title.size(), timestamp);
+}
+
+long TrendingSignal::IngestStream(FILE* stream) {
+    // Function: Reads watch events until the end of a stream.
+    // Pre:  stream is open for reading.
+    // Post: Function value = number of events added. Malformed lines are skipped.
+    long added = 0;
+    vector<char> buffer(EVENT_READ_CHUNK);
+    size_t kept = 0;  // bytes of an unfinished line carried over from the last read
+
+    while (true) {
+        if (kept == buffer.size())
+            buffer.resize(buffer.size() * 2);  // a single line longer than the buffer
+        size_t n = fread(buffer.data() + kept, 1, buffer.size() - kept, stream);
+        size_t end = kept + n;
+        bool last = n == 0;
+        if (last && end == 0)
+            break;
+
+        const char* p = buffer.data();
+        const char* limit = buffer.data() + end;
+        while (p < limit) {
+            const char* newline = static_cast<const char*>(memchr(p, '\n', limit - p));
+            if (!newline) {
+                if (!last)
+                    break;      // wait for the rest of the line
+                newline = limit;  // final line without a newline
+            }
+
+            // viewer <tab> title <tab> timestamp
+            const char* tab1 = static_cast<const char*>(memchr(p, '\t', newline - p));
+            const char* tab2 = tab1 ? static_cast<const char*>(memchr(tab1 + 1, '\t', newline - tab1 - 1)) : nullptr;
+            if (tab2) {
+                const char* digit = tab2 + 1;
+                const char* stop = newline > digit && newline[-1] == '\r' ? newline - 1 : newline;
+                bool negative = digit < stop && *digit == '-';
+                if (negative)
+                    digit++;
+                int64_t timestamp = 0;
+                bool valid = digit < stop;
+                for (; digit < stop; digit++) {
+                    if (*digit < '0' || *digit > '9') {
+                        valid = false;
+                        break;
+                    }
+                    timestamp = timestamp * 10 + (*digit - '0');
+                }
+                if (valid) {
+                    AddEvent(tab1 + 1, static_cast<size_t>(tab2 - tab1 - 1), negative ? -timestamp : timestamp);
+                    added++;
+                }
+            }
+            p = newline + 1;
+        }
+
+        if (last)
+            break;
+        kept = p < limit ? static_cast<size_t>(limit - p) : 0;
+        memmove(buffer.data(), p, kept);
+    }
+    return added;
+}
+
+long TrendingSignal::IngestFile(const string& filename) {
+    // Function: Reads watch events from a file ("-" reads standard input).
+    // Post: Function value = number of events added, or -1 if the file could
+    //       not be opened (an error is printed).
+    FILE* stream = filename == "-" ? stdin : fopen(filename.c_str(), "rb");
+    if (!stream) {
+        cerr << "Error: Could not open the event file " << filename << "!" << endl;
+        return -1;
+    }
+    long added = IngestStream(stream);
+    if (stream != stdin)
+        fclose(stream);
+    return added;
+}
+
+void TrendingSignal::AdvanceTo(int64_t now) {
+    // Function: Moves the current time forward without adding an event.
+    // Post: Counts are read as of now if now is later than the current time.
+    if (!started) {
+        landmark = this->now = now;
+        started = true;
+    }
+    this->now = max(this->now, now);
+
+    // Without new events the read-side factor shrinks; rescale before it underflows
+    if (Decay() < 1.0 / DECAY_RESCALE)
+        Rescale(this->now);
+}
+
+double TrendingSignal::GetCount(const string& title) const {
+    // Function: Estimates a title's decayed watch count at the current time.
+    // Post: Function value >= the true decayed count; it overestimates by at
+    //       most a small fraction of all decayed watches.
+    return Estimate(MixHash(title)) * Decay();
+}
+
+vector<pair<string, double>> TrendingSignal::GetTrending(int n) const {
+    // Function: Gets the most watched titles.
+    // Post: Function value = up to n (title, decayed count) pairs, highest first.
+    vector<pair<string, double>> trending;
+    double decay = Decay();
+    for (const HeavyHitter& hitter : heavyHitters)
+        trending.push_back(make_pair(hitter.title, hitter.weight * decay));
+    sort(trending.begin(), trending.end(), [](const pair<string, double>& a, const pair<string, double>& b) {
+        return a.second > b.second;
+    });
+    if (static_cast<int>(trending.size()) > n)
+        trending.resize(max(0, n));
+    return trending;
+}
+
+double TrendingSignal::GetPopularity(const Movie& movie) const {
+    // Function: Gets how popular a movie currently is.
+    // Pre:  Movie has been initialized.
+    // Post: Function value = 10 * log(1 + count) / log(1 + top count), so the
+    //       most watched title scores 10 and unwatched titles score 0.
+    //       Function value = 0 if the top count has decayed to 0.
+    if (topWeight <= 0.0)
+        return 0.0;
+
+    // Both counts are decayed to the current time before taking logs
+    double decay = Decay();
+    double denominator = log1p(topWeight * decay);
+    if (denominator <= 0.0)
+        return 0.0;
+    double count = min(Estimate(MixHash(movie.GetTitle())), topWeight);
+    return 10.0 * log1p(count * decay) / denominator;
+}
+
+long TrendingSignal::GetNumEvents() const {
+    // Function: Gets the number of events added so far.
+    return numEvents;
+}
+
+size_t TrendingSignal::GetMemoryBytes() const {
+    // Function: Gets the memory held by the sketch and the heavy hitters.
+    // Post: Function value is fixed at construction (titles aside).
+    return counters.capacity() * sizeof(double) + heavyHitters.capacity() * sizeof(HeavyHitter) +
+        heavyIndex.bucket_count() * sizeof(void*) + heavyIndex.size() * (sizeof(uint64_t) + sizeof(int) + sizeof(void*));
+}
+
+double TrendingSignal::Estimate(uint64_t hash) const {
+    // Function: Reads a title's forward-decayed count from the sketch.
+    uint32_t h1 = static_cast<uint32_t>(hash);
+    uint32_t h2 = static_cast<uint32_t>(hash >> 32) | 1;
+    double estimate = counters[h1 & (width - 1)];
+    for (int row = 1; row < depth; row++)
+        estimate = min(estimate, counters[static_cast<size_t>(row) * width + ((h1 + row * h2) & (width - 1))]);
+    return estimate;
+}
+
+double TrendingSignal::Add(uint64_t hash, double weight) {
+    // Function: Adds weight to a title with a conservative update.
+    // Post: Function value = the title's new forward-decayed count.
+    // Only counters below the new estimate are raised, which keeps the
+    // overestimate from other titles sharing a counter as small as possible
+    double count = Estimate(hash) + weight;
+    uint32_t h1 = static_cast<uint32_t>(hash);
+    uint32_t h2 = static_cast<uint32_t>(hash >> 32) | 1;
+    for (int row = 0; row < depth; row++) {
+        double& counter = counters[static_cast<size_t>(row) * width + ((h1 + row * h2) & (width - 1))];
+        counter = max(counter, count);
+    }
+    return count;
+}
+
+void TrendingSignal::OfferHeavyHitter(uint64_t hash, const char* title, size_t length, double weight) {
+    // Function: Keeps a title among the heavy hitters if its count is high enough.
+    topWeight = max(topWeight, weight);
+    // Counts only grow between rescales, so the smallest heavy hitter only
+    // changes when it is itself updated or replaced
+    unordered_map<uint64_t, int>::iterator found = heavyIndex.find(hash);
+    if (found != heavyIndex.end()) {
+        heavyHitters[found->second].weight = weight;
+        if (found->second != minHeavy)
+            return;
+    }
+    else if (static_cast<int>(heavyHitters.size()) < topK) {
+        heavyIndex[hash] = static_cast<int>(heavyHitters.size());
+        heavyHitters.push_back(HeavyHitter{ hash, string(title, length), weight });
+    }
+    else if (weight > heavyHitters[minHeavy].weight) {
+        heavyIndex.erase(heavyHitters[minHeavy].hash);
+        heavyIndex[hash] = minHeavy;
+        heavyHitters[minHeavy] = HeavyHitter{ hash, string(title, length), weight };
+    }
+    else
+        return;
+
+    minHeavy = 0;
+    for (int i = 1; i < static_cast<int>(heavyHitters.size()); i++) {
+        if (heavyHitters[i].weight < heavyHitters[minHeavy].weight)
+            minHeavy = i;
+    }
+}
+
+double TrendingSignal::Decay() const {
+    // Function: Gets the factor that turns a forward-decayed count into a count now.
+    return exp2(-(now - landmark) / halfLife);
+}
+
+void TrendingSignal::Rescale(int64_t newLandmark) {
+    // Function: Moves the landmark so forward-decay weights stay in range.
+    double factor = exp2(-(newLandmark - landmark) / halfLife);
+    for (double& counter : counters)
+        counter *= factor;
+    for (HeavyHitter& hitter : heavyHitters)
+        hitter.weight *= factor;
+    topWeight *= factor;
+    landmark = newLandmark;
+}
+#endif
@@ -11,6 +11,8 @@
 #include <iostream>
 #include <vector>
 #include <string>
+#include "Movie.h"
+#include "RoaringBitmap.h"
 
 using namespace std;
 
@@ -46,6 +48,21 @@ public:
     // Pre:  Viewer has been initialized.
     // Post: Function value = watchlist of the Viewer.
 
+    vector<MovieId> GetWatchedMovies() const;
+    // Function: Gets the IDs of the movies a Viewer object has seen.
+    // Pre:  Viewer has been initialized.
+    // Post: Function value = watched movie IDs in ascending order.
+
+    const RoaringBitmap& GetWatchedSet() const;
+    // Function: Gets the compressed set of movie IDs a Viewer object has seen.
+    // Pre:  Viewer has been initialized.
+    // Post: Function value = the watched movie IDs.
+
+    bool HasWatchedMovie(MovieId id) const;
+    // Function: Checks if a Viewer has seen the movie with a given ID.
+    // Pre:  Viewer has been initialized.
+    // Post: Returns true if id is among the watched movie IDs.
+
     //Setters
     void AddPreferredGenre(const string& genre);
     // Function: Adds a genre to a Viewer objects preferredGenres.
@@ -62,6 +79,12 @@ public:
     // Pre:  Viewer has been initialized.
     // Post: Movie title is added to the Viewer's watchlist.
 
+    void AddWatchedMovie(MovieId id);
+    // Function: Adds a movie ID to a Viewer objects watched movies.
+    // Pre:  Viewer has been initialized.
+    //       id was given by the hash table the Viewer is recommended from.
+    // Post: id is among the Viewer's watched movie IDs.
+
     //Overload operators and output
     bool operator==(const Viewer& rhs) const;
     // Function: Checks if two Viewer objects are equal
@@ -80,6 +103,7 @@ private:
     vector<string> preferredGenres;     // A list of genres the viewer prefers to watch
     vector<string> favoriteDirectors;   // A list of the viewers favorite directors
     vector<string> watchlist;           // A list of movies the viewer has seen
+    RoaringBitmap watchedMovies;        // IDs of movies the viewer has seen
 };
 
 // Constructor implementations
@@ -128,6 +152,14 @@ void Viewer::AddToWatchlist(const string& title) {
     watchlist.push_back(title);
 }
 
+void Viewer::AddWatchedMovie(MovieId id) {
+    // Function: Adds a movie ID to a Viewer objects watched movies.
+    // Pre:  Viewer has been initialized.
+    //       id was given by the hash table the Viewer is recommended from.
+    // Post: id is among the Viewer's watched movie IDs.
+    watchedMovies.Add(id);
+}
+
 vector<string> Viewer::GetPreferredGenres() const {
     // Function: Gets the preferred genres of a Viewer object.
     // Pre:  Viewer has been initialized.
@@ -149,6 +181,27 @@ vector<string> Viewer::GetWatchlist() const {
     return watchlist;
 }
 
+vector<MovieId> Viewer::GetWatchedMovies() const {
+    // Function: Gets the IDs of the movies a Viewer object has seen.
+    // Pre:  Viewer has been initialized.
+    // Post: Function value = watched movie IDs in ascending order.
+    return watchedMovies.ToVector();
+}
+
+const RoaringBitmap& Viewer::GetWatchedSet() const {
+    // Function: Gets the compressed set of movie IDs a Viewer object has seen.
+    // Pre:  Viewer has been initialized.
+    // Post: Function value = the watched movie IDs.
+    return watchedMovies;
+}
+
+bool Viewer::HasWatchedMovie(MovieId id) const {
+    // Function: Checks if a Viewer has seen the movie with a given ID.
+    // Pre:  Viewer has been initialized.
+    // Post: Returns true if id is among the watched movie IDs.
+    return watchedMovies.Contains(id);
+}
+
 bool Viewer::operator==(const Viewer& rhs) const {
     // Function: Checks if two Viewer objects are equal
     // Pre:  Both Viewer objects have been initialized.
@@ -0,0 +1,590 @@
+/**
+ * ViewerStore.h
+ * The ViewerStore class keeps millions of viewer profiles in a compact,
+ * memory-mapped file instead of as Viewer objects. Each profile is encoded as
+ * a genre bitset, a list of director IDs and a sorted list of watched-title
+ * IDs stored as delta varints; the strings themselves are interned once in a
+ * dictionary file next to the profile file ("<path>.dict", one appended line
+ * per new name, genre, director or title). Profiles are looked up by viewer name or
+ * ID, and a profile that still fits its block is updated in place when the
+ * viewer watches something new; one that outgrows it moves to a bigger block
+ * at the end of the file.
+ *
+ * Profile file layout:
+ *   header:  magic, version, bytes in use (64 bytes in total)
+ *   blocks:  viewer ID, capacity, length, then `capacity` payload bytes.
+ *            A block whose viewer ID is NO_VIEWER has been abandoned.
+ *
+ * Sync writes the dictionary to disk before the profile file, so a synced
+ * profile never names a string the dictionary lost. Profile pages may still
+ * reach the disk on their own between syncs, so Open drops any profile that
+ * names an ID the dictionary does not have.
+ **/
+
+#ifndef VIEWERSTORE_H
+#define VIEWERSTORE_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "Viewer.h"
+
+using namespace std;
+
+const uint32_t VIEWER_STORE_MAGIC = 0x56535452;   // "RTSV"
+const uint32_t VIEWER_STORE_VERSION = 1;
+const size_t VIEWER_STORE_HEADER = 64;            // bytes reserved for the header
+const size_t BLOCK_HEADER = 3 * sizeof(uint32_t); // viewer ID, capacity, length
+const size_t MIN_BLOCK_CAPACITY = 16;             // smallest payload a block holds
+const uint32_t NO_VIEWER = UINT32_MAX;            // "no such viewer" / abandoned block
+const int MAX_STORE_GENRES = 64;                  // genres fit in one 64-bit set
+
+/* Varint helpers (7 bits per byte, high bit = more bytes follow) */
+void AppendVarint(string& out, uint64_t value) {
+    while (value >= 0x80) {
+        out += static_cast<char>((value & 0x7F) | 0x80);
+        value >>= 7;
+    }
+    out += static_cast<char>(value);
+}
+
+bool ReadVarint(const unsigned char*& cursor, const unsigned char* end, uint64_t& value) {
+    value = 0;
+    for (int shift = 0; cursor < end && shift < 64; shift += 7) {
+        unsigned char byte = *cursor++;
+        value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+        if (!(byte & 0x80))
+            return true;
+    }
+    return false;
+}
+
+class ViewerStore {
+public:
+    // Class constructor
+    ViewerStore();
+
+    // Class destructor, syncs and closes the store
+    ~ViewerStore();
+
+    bool Open(const string& path);
+    // Function: Opens the store at path, creating it if it does not exist.
+    // Post: Returns true if the profile and dictionary files are ready.
+    //       Otherwise, prints an error and returns false.
+
+    void Close();
+    // Function: Writes the store back to disk and unmaps it.
+    // Post: The store is closed.
+
+    bool Sync() const;
+    // Function: Flushes the dictionary, then changed pages of the profile file, to disk.
+    // Post: Returns true if both flushes succeeded.
+
+    int GetNumViewers() const;
+    // Function: Determines the number of stored profiles.
+    // Post: Function value = number of viewers.
+
+    size_t GetFileBytes() const;
+    // Function: Determines the size of the profile data.
+    // Post: Function value = bytes of the profile file in use.
+
+    uint32_t AddViewer(const Viewer& viewer);
+    // Function: Stores a Viewer's profile, replacing any profile with the same name.
+    // Pre:  Store is open.
+    // Post: Function value = the viewer's ID (NO_VIEWER if the store is not open).
+
+    uint32_t FindViewer(const string& name) const;
+    // Function: Looks up a viewer ID by name.
+    // Post: Function value = the viewer's ID, or NO_VIEWER if not stored.
+
+    bool GetViewer(uint32_t id, Viewer& viewer) const;
+    // Function: Rebuilds a Viewer object from a stored profile.
+    // Post: Returns true and sets viewer if id is stored. Otherwise, returns false.
+    //       The watchlist comes back in title ID order.
+
+    bool AddWatched(uint32_t id, const string& title);
+    // Function: Records that a viewer watched a title.
+    // Pre:  Store is open.
+    // Post: Returns true if id is stored; the title is then in its watchlist.
+    //       The profile is rewritten in place when it still fits its block.
+
+    bool HasWatched(uint32_t id, const string& title) const;
+    // Function: Checks if a viewer has watched a title.
+    // Post: Returns true if title is in the viewer's watchlist.
+
+private:
+    struct Profile {
+        int age = -1;               // viewer's age
+        uint64_t genres = 0;        // bit i set = genre ID i is preferred
+        vector<uint32_t> directors; // director IDs in order of preference
+        vector<uint32_t> watched;   // sorted title IDs
+    };
+
+    uint32_t Intern(vector<string>& names, unordered_map<string, uint32_t>& ids, char kind, const string& value);
+    // Function: Gets the ID of a string, adding it to a dictionary if it is new.
+    // Post: New strings are appended to the dictionary file.
+
+    static uint32_t Lookup(const unordered_map<string, uint32_t>& ids, const string& value);
+    // Function: Gets the ID of a string without adding it.
+    // Post: Function value = the ID, or NO_VIEWER if the string is unknown.
+
+    static string EncodeProfile(const Profile& profile);
+    // Function: Encodes a profile as varints.
+    // Post: Function value = the payload bytes.
+
+    bool DecodeProfile(uint32_t id, Profile& profile) const;
+    // Function: Decodes the stored payload of a viewer.
+    // Post: Returns true and sets profile if id is stored.
+
+    bool InDictionary(const Profile& profile) const;
+    // Function: Checks that every ID in a profile names a dictionary string.
+    // Post: Returns true if all director and title IDs are in range.
+
+    void WriteProfile(uint32_t id, const Profile& profile);
+    // Function: Stores a profile, in place if it fits its current block.
+    // Post: offsets[id] points at a block holding profile. If the store
+    //       cannot grow, reports an error and keeps the old profile.
+
+    bool Reserve(size_t bytes);
+    // Function: Makes sure the mapping can hold bytes more data.
+    // Post: Returns true if the file and mapping were grown as needed.
+
+    uint32_t* BlockAt(uint64_t offset) const;
+    // Function: Gets the header words of the block at offset.
+
+    string path;                 // profile file path
+    int fd;                      // profile file descriptor
+    char* base;                  // start of the mapping
+    size_t mappedBytes;          // size of the mapping (and of the file)
+    size_t usedBytes;            // bytes of the file holding header and blocks
+    ofstream dictionary;         // dictionary file, opened for appending
+    int dictionaryFd;            // dictionary file descriptor, for fsync
+    vector<uint64_t> offsets;    // block offset of each viewer ID
+
+    vector<string> viewerNames;  unordered_map<string, uint32_t> viewerIds;
+    vector<string> genreNames;   unordered_map<string, uint32_t> genreIds;
+    vector<string> directorNames; unordered_map<string, uint32_t> directorIds;
+    vector<string> titleNames;   unordered_map<string, uint32_t> titleIds;
+};
+
+// Class constructor
+ViewerStore::ViewerStore() {
+    fd = -1;
+    dictionaryFd = -1;
+    base = nullptr;
+    mappedBytes = 0;
+    usedBytes = 0;
+}
+
+// Class destructor
+ViewerStore::~ViewerStore() {
+    Close();
+}
+
+bool ViewerStore::Open(const string& storePath) {
+    // Function: Opens the store at path, creating it if it does not exist.
+    // Post: Returns true if the profile and dictionary files are ready.
+    //       Otherwise, prints an error and returns false.
+    Close();
+    path = storePath;
+
+    // Read the dictionary back in the order it was written, so IDs are unchanged
+    ifstream existing(path + ".dict");
+    string line;
+    while (getline(existing, line)) {
+        if (line.size() < 2)
+            continue;
+        string value = line.substr(2);
+        if (line[0] == 'V') { viewerIds[value] = static_cast<uint32_t>(viewerNames.size()); viewerNames.push_back(value); }
+        else if (line[0] == 'G') { genreIds[value] = static_cast<uint32_t>(genreNames.size()); genreNames.push_back(value); }
+        else if (line[0] == 'D') { directorIds[value] = static_cast<uint32_t>(directorNames.size()); directorNames.push_back(value); }
+        else if (line[0] == 'T') { titleIds[value] = static_cast<uint32_t>(titleNames.size()); titleNames.push_back(value); }
+    }
+    existing.close();
+    dictionary.open(path + ".dict", ios::app);
+    dictionaryFd = open((path + ".dict").c_str(), O_RDONLY);
+
+    fd = open(path.c_str(), O_RDWR | O_CREAT, 0644);
+    struct stat info;
+    if (fd < 0 || fstat(fd, &info) != 0 || !dictionary.is_open() || dictionaryFd < 0) {
+        cerr << "Error: Could not open the viewer store " << path << "!" << endl;
+        Close();
+        return false;
+    }
+
+    mappedBytes = static_cast<size_t>(info.st_size);
+    bool fresh = mappedBytes < VIEWER_STORE_HEADER;
+    if (fresh) {
+        mappedBytes = 1 << 20;
+        if (ftruncate(fd, static_cast<off_t>(mappedBytes)) != 0) {
+            cerr << "Error: Could not size the viewer store " << path << "!" << endl;
+            Close();
+            return false;
+        }
+    }
+    void* mapping = mmap(nullptr, mappedBytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (mapping == MAP_FAILED) {
+        cerr << "Error: Could not map the viewer store " << path << "!" << endl;
+        base = nullptr;
+        Close();
+        return false;
+    }
+    base = static_cast<char*>(mapping);
+
+    uint32_t* header = reinterpret_cast<uint32_t*>(base);
+    if (fresh) {
+        memset(base, 0, VIEWER_STORE_HEADER);
+        header[0] = VIEWER_STORE_MAGIC;
+        header[1] = VIEWER_STORE_VERSION;
+        usedBytes = VIEWER_STORE_HEADER;
+        memcpy(base + 8, &usedBytes, sizeof(uint64_t));
+    }
+    else {
+        if (header[0] != VIEWER_STORE_MAGIC || header[1] != VIEWER_STORE_VERSION) {
+            cerr << "Error: " << path << " is not a viewer store!" << endl;
+            Close();
+            return false;
+        }
+        memcpy(&usedBytes, base + 8, sizeof(uint64_t));
+        if (usedBytes < VIEWER_STORE_HEADER || usedBytes > mappedBytes) {
+            cerr << "Error: " << path << " is corrupt (bytes in use past the end of the file)!" << endl;
+            Close();
+            return false;
+        }
+    }
+
+    // Find the live block of every viewer. A block must lie within the bytes
+    // in use; one naming a viewer the dictionary lacks is ignored.
+    offsets.assign(viewerNames.size(), 0);
+    for (uint64_t offset = VIEWER_STORE_HEADER; offset < usedBytes;) {
+        uint32_t* block = BlockAt(offset);
+        if (usedBytes - offset < BLOCK_HEADER || usedBytes - offset - BLOCK_HEADER < block[1] ||
+            block[2] > block[1]) {
+            cerr << "Error: " << path << " is corrupt (block at byte " << offset << " overruns the file)!" << endl;
+            Close();
+            return false;
+        }
+        if (block[0] != NO_VIEWER && block[0] < offsets.size())
+            offsets[block[0]] = offset;
+        offset += BLOCK_HEADER + block[1];
+    }
+
+    // Drop profiles that name directors or titles the dictionary lacks
+    int dropped = 0;
+    Profile profile;
+    for (uint32_t id = 0; id < offsets.size(); id++) {
+        if (offsets[id] != 0 && (!DecodeProfile(id, profile) || !InDictionary(profile))) {
+            offsets[id] = 0;
+            dropped++;
+        }
+    }
+    if (dropped > 0)
+        cerr << "Warning: Dropped " << dropped << " profiles of " << path << " that the dictionary does not match!" << endl;
+    return true;
+}
+
+void ViewerStore::Close() {
+    // Function: Writes the store back to disk and unmaps it.
+    // Post: The store is closed.
+    if (base) {
+        Sync();
+        munmap(base, mappedBytes);
+    }
+    if (fd >= 0)
+        close(fd);
+    if (dictionaryFd >= 0)
+        close(dictionaryFd);
+    if (dictionary.is_open())
+        dictionary.close();
+    fd = -1;
+    dictionaryFd = -1;
+    base = nullptr;
+    mappedBytes = usedBytes = 0;
+    offsets.clear();
+    viewerNames.clear(); viewerIds.clear();
+    genreNames.clear(); genreIds.clear();
+    directorNames.clear(); directorIds.clear();
+    titleNames.clear(); titleIds.clear();
+}
+
+bool ViewerStore::Sync() const {
+    // Function: Flushes the dictionary, then changed pages of the profile file, to disk.
+    // Post: Returns true if both flushes succeeded.
+    if (!base)
+        return false;
+
+    // Profiles refer to dictionary IDs, so the dictionary must be durable first
+    ofstream& names = const_cast<ofstream&>(dictionary);
+    if (!names.flush() || fsync(dictionaryFd) != 0)
+        return false;
+    return msync(base, usedBytes, MS_SYNC) == 0;
+}
+
+int ViewerStore::GetNumViewers() const {
+    // Function: Determines the number of stored profiles.
+    // Post: Function value = number of viewers.
+    return static_cast<int>(viewerNames.size());
+}
+
+size_t ViewerStore::GetFileBytes() const {
+    // Function: Determines the size of the profile data.
+    // Post: Function value = bytes of the profile file in use.
+    return usedBytes;
+}
+
+uint32_t* ViewerStore::BlockAt(uint64_t offset) const {
+    // Function: Gets the header words of the block at offset.
+    return reinterpret_cast<uint32_t*>(base + offset);
+}
+
+uint32_t ViewerStore::Intern(vector<string>& names, unordered_map<string, uint32_t>& ids, char kind,
+    const string& value) {
+    // Function: Gets the ID of a string, adding it to a dictionary if it is new.
+    // Post: New strings are appended to the dictionary file.
+    auto found = ids.find(value);
+    if (found != ids.end())
+        return found->second;
+    uint32_t id = static_cast<uint32_t>(names.size());
+    names.push_back(value);
+    ids[value] = id;
+    dictionary << kind << '\t' << value << '\n';
+    return id;
+}
+
+uint32_t ViewerStore::Lookup(const unordered_map<string, uint32_t>& ids, const string& value) {
+    // Function: Gets the ID of a string without adding it.
+    // Post: Function value = the ID, or NO_VIEWER if the string is unknown.
+    auto found = ids.find(value);
+    return found == ids.end() ? NO_VIEWER : found->second;
+}
+
+string ViewerStore::EncodeProfile(const Profile& profile) {
+    // Function: Encodes a profile as varints.
+    // Post: Function value = the payload bytes.
+    string out;
+    AppendVarint(out, static_cast<uint64_t>(profile.age + 1));  // -1 (unknown) becomes 0
+    AppendVarint(out, profile.genres);
+
+    // Directors keep their order of preference, which the tiered rules rely on
+    AppendVarint(out, profile.directors.size());
+    for (uint32_t id : profile.directors)
+        AppendVarint(out, id);
+
+    // Watched titles are sorted, so each is stored as the gap from the previous one
+    AppendVarint(out, profile.watched.size());
+    uint32_t previous = 0;
+    for (uint32_t id : profile.watched) {
+        AppendVarint(out, id - previous);
+        previous = id;
+    }
+    return out;
+}
+
+bool ViewerStore::DecodeProfile(uint32_t id, Profile& profile) const {
+    // Function: Decodes the stored payload of a viewer.
+    // Post: Returns true and sets profile if id is stored.
+    if (!base || id >= offsets.size() || offsets[id] == 0)
+        return false;
+
+    uint32_t* block = BlockAt(offsets[id]);
+    const unsigned char* cursor = reinterpret_cast<const unsigned char*>(block) + BLOCK_HEADER;
+    const unsigned char* end = cursor + block[2];
+
+    uint64_t value;
+    if (!ReadVarint(cursor, end, value))
+        return false;
+    profile.age = static_cast<int>(value) - 1;
+    if (!ReadVarint(cursor, end, profile.genres))
+        return false;
+
+    uint64_t count;
+    if (!ReadVarint(cursor, end, count) || count > static_cast<uint64_t>(end - cursor))
+        return false;
+    profile.directors.clear();
+    for (uint64_t i = 0; i < count; i++) {
+        if (!ReadVarint(cursor, end, value))
+            return false;
+        profile.directors.push_back(static_cast<uint32_t>(value));
+    }
+
+    // Every ID takes at least one byte, which bounds a damaged count
+    if (!ReadVarint(cursor, end, count) || count > static_cast<uint64_t>(end - cursor))
+        return false;
+    profile.watched.clear();
+    profile.watched.reserve(count);
+    uint32_t previous = 0;
+    for (uint64_t i = 0; i < count; i++) {
+        if (!ReadVarint(cursor, end, value))
+            return false;
+        previous += static_cast<uint32_t>(value);
+        profile.watched.push_back(previous);
+    }
+    return true;
+}
+
+bool ViewerStore::InDictionary(const Profile& profile) const {
+    // Function: Checks that every ID in a profile names a dictionary string.
+    // Post: Returns true if all director and title IDs are in range.
+    for (uint32_t director : profile.directors) {
+        if (director >= directorNames.size())
+            return false;
+    }
+    for (uint32_t title : profile.watched) {
+        if (title >= titleNames.size())
+            return false;
+    }
+    return true;
+}
+
+bool ViewerStore::Reserve(size_t bytes) {
+    // Function: Makes sure the mapping can hold bytes more data.
+    // Post: Returns true if the file and mapping were grown as needed.
+    if (usedBytes + bytes <= mappedBytes)
+        return true;
+
+    size_t newSize = max(mappedBytes * 2, usedBytes + bytes);
+    if (ftruncate(fd, static_cast<off_t>(newSize)) != 0)
+        return false;
+    void* mapping = mremap(base, mappedBytes, newSize, MREMAP_MAYMOVE);
+    if (mapping == MAP_FAILED)
+        return false;
+    base = static_cast<char*>(mapping);
+    mappedBytes = newSize;
+    return true;
+}
+
+void ViewerStore::WriteProfile(uint32_t id, const Profile& profile) {
+    // Function: Stores a profile, in place if it fits its current block.
+    // Post: offsets[id] points at a block holding profile. If the store
+    //       cannot grow, reports an error and keeps the old profile.
+    string payload = EncodeProfile(profile);
+    if (offsets.size() <= id)
+        offsets.resize(id + 1, 0);
+
+    if (offsets[id] != 0) {
+        uint32_t* block = BlockAt(offsets[id]);
+        if (payload.size() <= block[1]) {  // still fits: rewrite in place
+            memcpy(reinterpret_cast<char*>(block) + BLOCK_HEADER, payload.data(), payload.size());
+            block[2] = static_cast<uint32_t>(payload.size());
+            return;
+        }
+    }
+
+    // Leave room to grow so most later updates stay in place
+    size_t capacity = max(MIN_BLOCK_CAPACITY, payload.size() + payload.size() / 2);
+    capacity = (capacity + 3) & ~static_cast<size_t>(3);  // keep blocks 4-byte aligned
+    if (!Reserve(BLOCK_HEADER + capacity)) {
+        cerr << "Error: Could not grow the viewer store " << path << "!" << endl;
+        return;
+    }
+
+    uint64_t offset = usedBytes;
+    uint32_t* block = BlockAt(offset);
+    block[0] = id;
+    block[1] = static_cast<uint32_t>(capacity);
+    block[2] = static_cast<uint32_t>(payload.size());
+    memcpy(reinterpret_cast<char*>(block) + BLOCK_HEADER, payload.data(), payload.size());
+    usedBytes += BLOCK_HEADER + capacity;
+    memcpy(base + 8, &usedBytes, sizeof(uint64_t));
+
+    // Only now that the new block is written is the outgrown one abandoned
+    // (Reserve may have moved the mapping, so it is looked up again)
+    if (offsets[id] != 0)
+        BlockAt(offsets[id])[0] = NO_VIEWER;
+    offsets[id] = offset;
+}
+
+uint32_t ViewerStore::AddViewer(const Viewer& viewer) {
+    // Function: Stores a Viewer's profile, replacing any profile with the same name.
+    // Pre:  Store is open.
+    // Post: Function value = the viewer's ID (NO_VIEWER if the store is not open).
+    if (!base)
+        return NO_VIEWER;
+
+    Profile profile;
+    profile.age = viewer.GetViewerAge();
+    for (const string& genre : viewer.GetPreferredGenres()) {
+        uint32_t genreId = Intern(genreNames, genreIds, 'G', genre);
+        if (genreId < MAX_STORE_GENRES)
+            profile.genres |= 1ULL << genreId;
+        else
+            cerr << "Error: The viewer store holds at most " << MAX_STORE_GENRES << " genres!" << endl;
+    }
+    for (const string& director : viewer.GetFavoriteDirectors())
+        profile.directors.push_back(Intern(directorNames, directorIds, 'D', director));
+    for (const string& title : viewer.GetWatchlist())
+        profile.watched.push_back(Intern(titleNames, titleIds, 'T', title));
+
+    // Directors keep their order of preference; only watched titles need sorting
+    sort(profile.watched.begin(), profile.watched.end());
+    profile.watched.erase(unique(profile.watched.begin(), profile.watched.end()), profile.watched.end());
+
+    uint32_t id = Intern(viewerNames, viewerIds, 'V', viewer.GetViewerName());
+    WriteProfile(id, profile);
+    return id;
+}
+
+uint32_t ViewerStore::FindViewer(const string& name) const {
+    // Function: Looks up a viewer ID by name.
+    // Post: Function value = the viewer's ID, or NO_VIEWER if not stored.
+    return Lookup(viewerIds, name);
+}
+
+bool ViewerStore::GetViewer(uint32_t id, Viewer& viewer) const {
+    // Function: Rebuilds a Viewer object from a stored profile.
+    // Post: Returns true and sets viewer if id is stored. Otherwise, returns false.
+    //       The watchlist comes back in title ID order.
+    Profile profile;
+    if (id >= viewerNames.size() || !DecodeProfile(id, profile) || !InDictionary(profile))
+        return false;
+
+    Viewer rebuilt(viewerNames[id], profile.age);
+    for (size_t g = 0; g < genreNames.size() && g < MAX_STORE_GENRES; g++) {
+        if (profile.genres & (1ULL << g))
+            rebuilt.AddPreferredGenre(genreNames[g]);
+    }
+    for (uint32_t director : profile.directors)
+        rebuilt.AddFavoriteDirector(directorNames[director]);
+    for (uint32_t title : profile.watched)
+        rebuilt.AddToWatchlist(titleNames[title]);
+    viewer = rebuilt;
+    return true;
+}
+
+bool ViewerStore::AddWatched(uint32_t id, const string& title) {
+    // Function: Records that a viewer watched a title.
+    // Pre:  Store is open.
+    // Post: Returns true if id is stored; the title is then in its watchlist.
+    //       The profile is rewritten in place when it still fits its block.
+    Profile profile;
+    if (!DecodeProfile(id, profile))
+        return false;
+
+    uint32_t titleId = Intern(titleNames, titleIds, 'T', title);
+    auto position = lower_bound(profile.watched.begin(), profile.watched.end(), titleId);
+    if (position != profile.watched.end() && *position == titleId)
+        return true;  // already watched
+    profile.watched.insert(position, titleId);
+    WriteProfile(id, profile);
+    return true;
+}
+
+bool ViewerStore::HasWatched(uint32_t id, const string& title) const {
+    // Function: Checks if a viewer has watched a title.
+    // Post: Returns true if title is in the viewer's watchlist.
+    uint32_t titleId = Lookup(titleIds, title);
+    Profile profile;
+    if (titleId == NO_VIEWER || !DecodeProfile(id, profile))
+        return false;
+    return binary_search(profile.watched.begin(), profile.watched.end(), titleId);
+}
+#endif
@@ -0,0 +1,149 @@
+/***********************************************************************************************
+ * Name:        ViewerStoreDr.cpp
+ * Description: This driver builds and exercises a persistent viewer store. It imports viewer
+ *              profiles from a file (or generates synthetic ones), compares the store's size
+ *              with the same profiles held as Viewer objects, times lookups by name and ID,
+ *              records newly watched titles in place, and reopens the store to show that the
+ *              profiles persist.
+ *              Usage: ViewerStore [storePath] [numViewers] [profileFile]
+***********************************************************************************************/
+#include <iostream>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include "Viewer.h"
+#include "ViewerStore.h"
+#include "WireFormat.h"
+
+using namespace std;
+typedef chrono::steady_clock Clock;
+
+// Function prototypes
+Viewer makeSyntheticViewer(int index, mt19937& random);
+size_t viewerObjectBytes(const Viewer& viewer);
+double secondsSince(Clock::time_point start);
+
+int main(int argc, char* argv[]) {
+    string storePath = argc > 1 ? argv[1] : "viewers.store";
+    int numViewers = argc > 2 ? atoi(argv[2]) : 1000000;
+    string profileFile = argc > 3 ? argv[3] : "";
+
+    // Start from an empty store so the numbers below describe this run
+    remove(storePath.c_str());
+    remove((storePath + ".dict").c_str());
+
+    ViewerStore store;
+    if (!store.Open(storePath))
+        return 1;
+
+    mt19937 random(7);
+    size_t objectBytes = 0;
+    Clock::time_point start = Clock::now();
+    if (profileFile.empty()) {
+        for (int i = 0; i < numViewers; i++) {
+            Viewer viewer = makeSyntheticViewer(i, random);
+            objectBytes += viewerObjectBytes(viewer);
+            store.AddViewer(viewer);
+        }
+    }
+    else {
+        for (const Viewer& viewer : ReadViewerProfiles(profileFile)) {
+            objectBytes += viewerObjectBytes(viewer);
+            store.AddViewer(viewer);
+        }
+    }
+    numViewers = store.GetNumViewers();
+    cout << "Stored " << numViewers << " profiles in " << secondsSince(start) << " seconds." << endl;
+    cout << "As Viewer objects: " << objectBytes / (1 << 20) << " MB ("
+        << objectBytes / max(1, numViewers) << " bytes per viewer)" << endl;
+    cout << "In the viewer store: " << store.GetFileBytes() / (1 << 20) << " MB ("
+        << store.GetFileBytes() / max(1, numViewers) << " bytes per viewer)" << endl;
+    if (numViewers == 0)
+        return 0;
+
+    // Look profiles up by name and rebuild them
+    int lookups = min(numViewers, 100000);
+    Viewer viewer("");
+    start = Clock::now();
+    for (int i = 0; i < lookups; i++) {
+        uint32_t id = store.FindViewer("Viewer" + to_string(random() % numViewers));
+        if (id != NO_VIEWER)
+            store.GetViewer(id, viewer);
+    }
+    cout << "Lookups by name: " << lookups / secondsSince(start) << " per second" << endl;
+
+    start = Clock::now();
+    for (int i = 0; i < lookups; i++)
+        store.GetViewer(static_cast<uint32_t>(random() % numViewers), viewer);
+    cout << "Lookups by ID: " << lookups / secondsSince(start) << " per second" << endl;
+
+    // Viewers keep watching; most updates fit the block they already have
+    size_t before = store.GetFileBytes();
+    start = Clock::now();
+    for (int i = 0; i < lookups; i++)
+        store.AddWatched(static_cast<uint32_t>(random() % numViewers), "Title" + to_string(random() % 20000));
+    cout << "Watch updates: " << lookups / secondsSince(start) << " per second (file grew by "
+        << (store.GetFileBytes() - before) / 1024 << " KB)" << endl;
+
+    // Reopen to show the profiles persisted
+    store.AddWatched(0, "The Notebook");
+    store.Close();
+    ViewerStore reopened;
+    if (!reopened.Open(storePath))
+        return 1;
+    reopened.GetViewer(0, viewer);
+    cout << "\nAfter reopening, " << reopened.GetNumViewers() << " profiles are stored. Viewer 0:";
+    viewer.Print();
+    cout << "Has watched The Notebook: " << (reopened.HasWatched(0, "The Notebook") ? "yes" : "no") << endl;
+    return 0;
+}
+
+/**
+ * Builds a viewer with random preferences and a watchlist of 5 to 200 titles.
+ *
+ * @param index The viewer's number, used for its name.
+ * @param random The random number generator.
+ * @return The generated viewer.
+ */
+Viewer makeSyntheticViewer(int index, mt19937& random) {
+    static const vector<string> genres = { "Drama", "Comedy", "Action", "Mystery", "Art&Foreign",
+        "Romance", "Horror", "SciFi", "Documentary", "Classics", "Kids&Family" };
+
+    Viewer viewer("Viewer" + to_string(index), 10 + static_cast<int>(random() % 70));
+    int numGenres = 1 + static_cast<int>(random() % 3);
+    for (int g = 0; g < numGenres; g++)
+        viewer.AddPreferredGenre(genres[random() % genres.size()]);
+    if (random() % 2 == 0)
+        viewer.AddFavoriteDirector("Director" + to_string(random() % 5000));
+    int numWatched = 5 + static_cast<int>(random() % 196);
+    for (int w = 0; w < numWatched; w++)
+        viewer.AddToWatchlist("Title" + to_string(random() % 20000));
+    return viewer;
+}
+
+/**
+ * Estimates the heap and object bytes a Viewer occupies.
+ *
+ * @param viewer The viewer to measure.
+ * @return The approximate number of bytes.
+ */
+size_t viewerObjectBytes(const Viewer& viewer) {
+    size_t bytes = sizeof(Viewer) + viewer.GetViewerName().capacity();
+    for (const vector<string>& list : { viewer.GetPreferredGenres(), viewer.GetFavoriteDirectors(),
+        viewer.GetWatchlist() }) {
+        bytes += list.capacity() * sizeof(string);
+        for (const string& item : list)
+            bytes += item.size() > 15 ? item.capacity() + 1 : 0;  // short strings live inline
+    }
+    return bytes;
+}
+
+/**
+ * Measures the time elapsed since a starting point.
+ *
+ * @param start The starting point.
+ * @return The elapsed time in seconds.
+ */
+double secondsSince(Clock::time_point start) {
+    return chrono::duration<double>(Clock::now() - start).count();
+}
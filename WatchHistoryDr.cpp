@@ -0,0 +1,232 @@
+/***********************************************************************************************
+ * Name:        WatchHistoryDr.cpp
+ * Description: This driver measures watch histories kept as compressed bitmaps. It fills a
+ *              hash table with the CSV catalog repeated under new release years, then builds
+ *              viewers who have watched 10 to 100,000 random movies and compares three ways of
+ *              keeping and using a history: a list of titles checked once per candidate (as
+ *              IsMovieWatched does), sorted movie IDs searched once per candidate, and a
+ *              RoaringBitmap subtracted from the candidate set with one AndNot. For each size
+ *              it prints the memory of each history and the time to find a viewer's unwatched
+ *              Drama and Comedy candidates. Title checks on long histories are timed on a
+ *              sample of the candidates and scaled up. Before timing, it checks Add, Remove,
+ *              Or and AndNot against a std::set while containers cross the 4096-value line
+ *              between array and bitmap containers in both directions.
+ *              Usage: WatchHistory [copies]
+***********************************************************************************************/
+#include <iostream>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <set>
+#include "Movie.h"
+#include "Viewer.h"
+#include "HashType.h"
+#include "RoaringBitmap.h"
+#include "WireFormat.h"
+
+using namespace std;
+typedef chrono::steady_clock Clock;
+
+// Function prototypes
+bool checkAgainstSet(mt19937& random);
+bool sameContents(const RoaringBitmap& bitmap, const set<uint32_t>& reference);
+size_t titleListBytes(const vector<string>& titles);
+double microsecondsSince(Clock::time_point start);
+
+int main(int argc, char* argv[]) {
+    int copies = argc > 1 ? atoi(argv[1]) : 5;
+    const int historySizes[] = { 10, 100, 1000, 10000, 100000 };
+    const int rounds = 20;
+
+    vector<Movie> catalog = ReadMovieCSV("movieData.csv");
+    if (catalog.empty())
+        return 1;
+    int numMovies = static_cast<int>(catalog.size()) * copies;
+    HashType movieTable(numMovies * 3 / 2);
+    for (int copy = 0; copy < copies; copy++) {
+        for (const Movie& base : catalog) {
+            movieTable.InsertMovie(Movie(base.GetTitle(), base.GetYear() + 10000 * copy, base.GetGenre(),
+                base.GetDirector(), base.GetCast(), base.GetRuntime(), base.GetRating()));
+        }
+    }
+    numMovies = movieTable.GetNumItems();
+    cout << "Table holds " << numMovies << " movies." << endl;
+
+    mt19937 random(17);
+    bool checked = checkAgainstSet(random);
+    cout << "RoaringBitmap matches std::set across the array/bitmap boundary: " << (checked ? "yes" : "NO") << endl;
+
+    // Everyone prefers the two biggest genres, so there are many candidates to filter
+    Viewer profile("Viewer", 30);
+    profile.AddPreferredGenre("Drama");
+    profile.AddPreferredGenre("Comedy");
+    vector<MovieId> candidates = movieTable.GetCandidateSet(profile).ToVector();
+    cout << profile.GetPreferredGenres()[0] << " and " << profile.GetPreferredGenres()[1] << " hold "
+        << candidates.size() << " candidates.\n" << endl;
+
+    printf("%8s %11s %9s %11s %14s %14s %14s %6s\n", "history", "titles KB", "ids KB", "bitmap KB",
+        "title check us", "id search us", "bitmap us", "same");
+    for (int size : historySizes) {
+        if (size > numMovies)
+            break;
+
+        // A random history, held three ways
+        vector<MovieId> ids;
+        for (MovieId id = 0; id < static_cast<MovieId>(numMovies); id++)
+            ids.push_back(id);
+        shuffle(ids.begin(), ids.end(), random);
+        ids.resize(size);
+        sort(ids.begin(), ids.end());
+
+        Viewer viewer = profile;
+        vector<string> titles;
+        for (MovieId id : ids) {
+            viewer.AddWatchedMovie(id);
+            titles.push_back(movieTable.GetMovie(id).GetTitle());
+        }
+        Viewer titleViewer = profile;
+        for (const string& title : titles)
+            titleViewer.AddToWatchlist(title);
+
+        // Titles: one linear watchlist check per candidate. Long histories are
+        // timed on a sample of the candidates and scaled to all of them.
+        size_t sample = min(candidates.size(), max<size_t>(100, 20000000 / size));
+        size_t unwatchedTitles = 0;
+        Clock::time_point start = Clock::now();
+        for (size_t i = 0; i < sample; i++)
+            unwatchedTitles += !movieTable.IsMovieWatched(titleViewer, movieTable.GetMovie(candidates[i]).GetTitle());
+        double titleTime = microsecondsSince(start) * candidates.size() / sample;
+
+        // Sorted IDs: one binary search per candidate
+        vector<MovieId> unwatchedIds;
+        start = Clock::now();
+        for (int round = 0; round < rounds; round++) {
+            unwatchedIds.clear();
+            for (MovieId id : candidates) {
+                if (!binary_search(ids.begin(), ids.end(), id))
+                    unwatchedIds.push_back(id);
+            }
+        }
+        double idTime = microsecondsSince(start) / rounds;
+
+        // Bitmaps: the genre sets' union minus the watched set
+        RoaringBitmap unwatched;
+        start = Clock::now();
+        for (int round = 0; round < rounds; round++)
+            unwatched = movieTable.GetCandidateSet(viewer);
+        double bitmapTime = microsecondsSince(start) / rounds;
+
+        bool same = unwatched.ToVector() == unwatchedIds;
+        printf("%8d %11.1f %9.1f %11.1f %14.0f %14.1f %14.1f %6s\n", size, titleListBytes(titles) / 1024.0,
+            ids.size() * sizeof(MovieId) / 1024.0, viewer.GetWatchedSet().GetMemoryBytes() / 1024.0,
+            titleTime, idTime, bitmapTime, same ? "yes" : "NO");
+        fflush(stdout);
+        checked = checked && same;
+    }
+    return checked ? 0 : 1;
+}
+
+/**
+ * Checks RoaringBitmap against a std::set holding the same values. Values
+ * are drawn from two 65536-value chunks, so each container grows past
+ * ROARING_ARRAY_MAX values (array to bitmap) and shrinks below it again
+ * (bitmap to array), and both sets are compared after every phase.
+ *
+ * @param random The random number generator.
+ * @return True if every operation agreed with the std::set.
+ */
+bool checkAgainstSet(mt19937& random) {
+    const uint32_t chunks[] = { 0, 3u << 16 };  // high halves of the values used
+    uniform_int_distribution<uint32_t> low(0, 0xFFFF);
+    auto draw = [&]() { return chunks[random() % 2] + low(random); };
+
+    RoaringBitmap bitmap, other;
+    set<uint32_t> reference, otherReference;
+    bool same = true;
+    // Grow both chunks past the array limit, then shrink them below it, twice
+    for (int phase = 0; phase < 4; phase++) {
+        bool growing = phase % 2 == 0;
+        for (uint32_t i = 0; i < 3 * ROARING_ARRAY_MAX; i++) {
+            uint32_t value = draw();
+            if (growing) {
+                bitmap.Add(value);
+                reference.insert(value);
+            }
+            else if (!reference.empty()) {
+                // Remove mostly values that are present, some that are not
+                if (random() % 4 != 0)
+                    value = *reference.lower_bound(value < *reference.rbegin() ? value : 0);
+                bitmap.Remove(value);
+                reference.erase(value);
+            }
+            if (i % 1024 == 0) {
+                uint32_t probe = draw();
+                same = same && bitmap.Contains(probe) == (reference.count(probe) > 0);
+            }
+        }
+        same = same && sameContents(bitmap, reference);
+
+        // A second set around the same size to combine with
+        other.Clear();
+        otherReference.clear();
+        size_t otherSize = random() % (2 * ROARING_ARRAY_MAX + 2);
+        for (size_t i = 0; i < otherSize; i++) {
+            uint32_t value = draw();
+            other.Add(value);
+            otherReference.insert(value);
+        }
+        set<uint32_t> expected;
+        set_difference(reference.begin(), reference.end(), otherReference.begin(), otherReference.end(),
+            inserter(expected, expected.end()));
+        same = same && sameContents(bitmap.AndNot(other), expected);
+        expected = reference;
+        expected.insert(otherReference.begin(), otherReference.end());
+        same = same && sameContents(bitmap.Or(other), expected);
+    }
+    return same;
+}
+
+/**
+ * Checks if a bitmap holds exactly the values of a std::set.
+ *
+ * @param bitmap The bitmap.
+ * @param reference The expected values.
+ * @return True if the values, their count and every membership test agree.
+ */
+bool sameContents(const RoaringBitmap& bitmap, const set<uint32_t>& reference) {
+    vector<uint32_t> values = bitmap.ToVector();
+    if (bitmap.GetCardinality() != reference.size() || !equal(values.begin(), values.end(), reference.begin(),
+        reference.end()))
+        return false;
+    for (uint32_t value : reference) {
+        if (!bitmap.Contains(value))
+            return false;
+    }
+    return true;
+}
+
+/**
+ * Measures the memory of a watchlist kept as a vector of titles.
+ *
+ * @param titles The watchlist.
+ * @return The bytes of the vector and of every title too long for the string itself.
+ */
+size_t titleListBytes(const vector<string>& titles) {
+    size_t bytes = sizeof(titles) + titles.capacity() * sizeof(string);
+    for (const string& title : titles) {
+        if (title.capacity() > 15)  // longer titles live on the heap
+            bytes += title.capacity() + 1;
+    }
+    return bytes;
+}
+
+/**
+ * Measures the time since start.
+ *
+ * @param start The starting time.
+ * @return The microseconds elapsed.
+ */
+double microsecondsSince(Clock::time_point start) {
+    return chrono::duration<double, micro>(Clock::now() - start).count();
+}
@@ -0,0 +1,250 @@
+/**
+ * WireFormat.h
+ * Text encodings shared by the programs that pass movies and viewers between
+ * processes or read them from files. A record is one line of tab separated
+ * fields; list fields (genres, directors, watchlist, watched IDs) separate
+ * their items with '|'. The CSV catalog parser also lives here so every
+ * loader reads movieData.csv the same way.
+ **/
+
+#ifndef WIREFORMAT_H
+#define WIREFORMAT_H
+
+#include <cerrno>
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "Movie.h"
+#include "Viewer.h"
+
+using namespace std;
+
+const char FIELD_SEPARATOR = '\t';  // separates the fields of a record
+const char LIST_SEPARATOR = '|';    // separates the items of a list field
+
+vector<string> SplitString(const string& text, char separator) {
+    // Function: Splits text on a separator character.
+    // Post: Function value = the pieces of text in order. Empty text gives no pieces.
+    vector<string> pieces;
+    if (text.empty())
+        return pieces;
+
+    size_t start = 0;
+    while (true) {
+        size_t end = text.find(separator, start);
+        if (end == string::npos) {
+            pieces.push_back(text.substr(start));
+            return pieces;
+        }
+        pieces.push_back(text.substr(start, end - start));
+        start = end + 1;
+    }
+}
+
+string JoinStrings(const vector<string>& pieces, char separator) {
+    // Function: Joins strings with a separator character.
+    // Post: Function value = the pieces in order with separator between them.
+    string text;
+    for (size_t i = 0; i < pieces.size(); i++) {
+        if (i != 0)
+            text += separator;
+        text += pieces[i];
+    }
+    return text;
+}
+
+string EncodeRating(double rating) {
+    // Function: Formats a rating without losing precision.
+    // Post: Function value = rating as text that stod reads back exactly.
+    char buffer[32];
+    snprintf(buffer, sizeof(buffer), "%.17g", rating);
+    return buffer;
+}
+
+string EncodeMovie(const Movie& movie) {
+    // Function: Encodes a Movie as a single record.
+    // Post: Function value = title, year, genre, director, cast, runtime and
+    //       rating separated by FIELD_SEPARATOR.
+    string t(1, FIELD_SEPARATOR);
+    return movie.GetTitle() + t + to_string(movie.GetYear()) + t + movie.GetGenre() + t +
+        movie.GetDirector() + t + movie.GetCast() + t + to_string(movie.GetRuntime()) + t +
+        EncodeRating(movie.GetRating());
+}
+
+bool DecodeMovie(const string& record, Movie& movie) {
+    // Function: Decodes a record written by EncodeMovie.
+    // Post: Returns true and sets movie if record is well formed.
+    //       Otherwise, returns false and movie is unchanged.
+    vector<string> fields = SplitString(record, FIELD_SEPARATOR);
+    if (fields.size() != 7)
+        return false;
+
+    try {
+        movie = Movie(fields[0], stoi(fields[1]), fields[2], fields[3], fields[4],
+            stoi(fields[5]), stod(fields[6]));
+    }
+    catch (const exception&) {
+        return false;
+    }
+    return true;
+}
+
+string EncodeViewer(const Viewer& viewer) {
+    // Function: Encodes a Viewer's profile as a single record.
+    // Post: Function value = name, age, preferred genres, favorite directors,
+    //       watchlist and watched movie IDs separated by FIELD_SEPARATOR.
+    string t(1, FIELD_SEPARATOR);
+    vector<string> watched;
+    for (MovieId id : viewer.GetWatchedMovies())
+        watched.push_back(to_string(id));
+    return viewer.GetViewerName() + t + to_string(viewer.GetViewerAge()) + t +
+        JoinStrings(viewer.GetPreferredGenres(), LIST_SEPARATOR) + t +
+        JoinStrings(viewer.GetFavoriteDirectors(), LIST_SEPARATOR) + t +
+        JoinStrings(viewer.GetWatchlist(), LIST_SEPARATOR) + t +
+        JoinStrings(watched, LIST_SEPARATOR);
+}
+
+bool DecodeViewer(const string& record, Viewer& viewer) {
+    // Function: Decodes a record written by EncodeViewer.
+    // Post: Returns true and sets viewer if record is well formed.
+    //       Otherwise, returns false and viewer is unchanged.
+    //       Records without the watched IDs (older profiles) have none.
+    vector<string> fields = SplitString(record, FIELD_SEPARATOR);
+    fields.resize(max<size_t>(fields.size(), 6));  // trailing empty lists may be cut off
+    if (fields.size() != 6 || fields[0].empty())
+        return false;
+
+    int age;
+    vector<MovieId> watched;
+    try {
+        age = stoi(fields[1]);
+        for (const string& id : SplitString(fields[5], LIST_SEPARATOR))
+            watched.push_back(static_cast<MovieId>(stoul(id)));
+    }
+    catch (const exception&) {
+        return false;
+    }
+
+    Viewer decoded(fields[0], age);
+    for (const string& genre : SplitString(fields[2], LIST_SEPARATOR))
+        decoded.AddPreferredGenre(genre);
+    for (const string& director : SplitString(fields[3], LIST_SEPARATOR))
+        decoded.AddFavoriteDirector(director);
+    for (const string& title : SplitString(fields[4], LIST_SEPARATOR))
+        decoded.AddToWatchlist(title);
+    for (MovieId id : watched)
+        decoded.AddWatchedMovie(id);
+    viewer = decoded;
+    return true;
+}
+
+bool ParseMovieCSVRow(const char* begin, const char* end, Movie& movie) {
+    // Function: Parses one data row of the movie CSV file held in a buffer.
+    // Pre:  [begin, end) has the columns Title,Year,Genre,Director,Cast,Runtime,Rating
+    //       and no line break.
+    // Post: Returns true and sets movie if the row parses.
+    //       Otherwise, returns false and movie is unchanged.
+    const char* fields[7];
+    size_t lengths[7];
+    for (int f = 0; f < 7; f++) {
+        const char* comma = static_cast<const char*>(memchr(begin, ',', end - begin));
+        const char* fieldEnd = comma ? comma : end;
+        fields[f] = begin;
+        lengths[f] = fieldEnd - begin;
+        begin = comma ? comma + 1 : end;
+    }
+
+    // Numbers are read like stoi and stod: leading spaces and trailing text
+    // are allowed, but there must be digits and the value must fit
+    char number[64];
+    auto terminated = [&](int f) {
+        size_t length = min(lengths[f], sizeof(number) - 1);
+        memcpy(number, fields[f], length);
+        number[length] = '\0';
+        return number;
+    };
+    long values[2];
+    const int integerFields[2] = { 1, 5 };
+    for (int i = 0; i < 2; i++) {
+        char* parsedEnd;
+        errno = 0;
+        values[i] = strtol(terminated(integerFields[i]), &parsedEnd, 10);
+        if (parsedEnd == number || errno == ERANGE || values[i] < INT_MIN || values[i] > INT_MAX)
+            return false;
+    }
+    char* parsedEnd;
+    errno = 0;
+    double rating = strtod(terminated(6), &parsedEnd);
+    if (parsedEnd == number || errno == ERANGE)
+        return false;
+
+    movie = Movie(string(fields[0], lengths[0]), static_cast<int>(values[0]), string(fields[2], lengths[2]),
+        string(fields[3], lengths[3]), string(fields[4], lengths[4]), static_cast<int>(values[1]), rating);
+    return true;
+}
+
+bool ParseMovieCSVLine(const string& line, Movie& movie) {
+    // Function: Parses one data row of the movie CSV file.
+    // Pre:  line has the columns Title,Year,Genre,Director,Cast,Runtime,Rating.
+    // Post: Returns true and sets movie if the row parses.
+    //       Otherwise, returns false and movie is unchanged.
+    return ParseMovieCSVRow(line.data(), line.data() + line.size(), movie);
+}
+
+vector<Movie> ReadMovieCSV(const string& filename) {
+    // Function: Reads every movie of a CSV catalog file.
+    // Pre:  The first line of the file is a header.
+    // Post: Function value = the movies in file order. Rows that do not parse
+    //       and a missing file are reported on cerr.
+    vector<Movie> movieList;
+    ifstream file(filename);
+
+    if (!file.is_open()) {
+        cerr << "Error: Could not open the file!" << endl;
+        return movieList;
+    }
+
+    string line;
+    getline(file, line);  // Skip the header line
+
+    while (getline(file, line)) {
+        Movie movie;
+        if (ParseMovieCSVLine(line, movie))
+            movieList.push_back(movie);
+        else
+            cerr << "Error: Could not parse the line - " << line << endl;
+    }
+    return movieList;
+}
+
+vector<Viewer> ReadViewerProfiles(const string& filename) {
+    // Function: Reads viewer profiles, one EncodeViewer record per line.
+    // Post: Function value = the profiles in file order. Blank lines and lines
+    //       starting with '#' are skipped; malformed lines are reported on cerr.
+    vector<Viewer> viewers;
+    ifstream file(filename);
+
+    if (!file.is_open()) {
+        cerr << "Error: Could not open the file!" << endl;
+        return viewers;
+    }
+
+    string line;
+    while (getline(file, line)) {
+        if (line.empty() || line[0] == '#')
+            continue;
+        Viewer viewer("");
+        if (DecodeViewer(line, viewer))
+            viewers.push_back(viewer);
+        else
+            cerr << "Error: Could not parse the viewer - " << line << endl;
+    }
+    return viewers;
+}
+#endif
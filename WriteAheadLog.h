@@ -0,0 +1,564 @@
+/**
+ * WriteAheadLog.h
+ * The WriteAheadLog class is an append-only log of catalog mutations. Each
+ * record is framed with its length, a CRC-32 of its contents and a log
+ * sequence number (LSN), so a record cut short by a crash is detected and
+ * dropped on the next open. Appending only copies the record into a memory
+ * buffer; a flusher thread writes whatever has accumulated and makes it
+ * durable with one fdatasync (group commit), so the cost of a sync is shared
+ * by every mutation that arrived while the previous one was running.
+ * Callers that need a mutation on disk wait for its LSN to become durable.
+ *
+ * Log file layout:
+ *   header:  magic, version, base LSN (16 bytes in total). Records at or
+ *            below the base LSN were dropped by compaction.
+ *   records: payload length, CRC-32 of LSN + op + payload, LSN, op, payload.
+ *
+ * Snapshots use the same layout with their own magic; see DurableCatalog.h.
+ **/
+
+#ifndef WRITEAHEADLOG_H
+#define WRITEAHEADLOG_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+
+const uint32_t WAL_MAGIC = 0x4C41574D;        // "MWAL"
+const uint32_t WAL_VERSION = 2;               // 2: inserts carry the movie's ID
+const size_t WAL_HEADER = 16;                 // magic, version, base LSN
+const size_t WAL_RECORD_HEADER = 17;          // length, CRC, LSN, op
+
+/* Mutations recorded in the log */
+const char WAL_INSERT = 'I';   // payload: the new movie's ID, a tab, EncodeMovie of the movie
+const char WAL_DELETE = 'D';   // payload: EncodeMovie of the key to delete
+const char WAL_UPDATE = 'U';   // payload: EncodeMovie of the key, a tab, the new rating
+
+struct WalRecord {
+    uint64_t lsn;      // log sequence number, increasing from 1
+    char op;           // one of the WAL_ mutations
+    string payload;    // the mutation's arguments
+};
+
+uint32_t Crc32(const char* data, size_t length, uint32_t crc = 0) {
+    // Function: Computes the CRC-32 (IEEE) of a buffer.
+    // Post: Function value = the CRC, continuing from crc so buffers can be
+    //       checksummed in pieces.
+    static const vector<uint32_t> table = [] {
+        vector<uint32_t> values(256);
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t value = i;
+            for (int bit = 0; bit < 8; bit++)
+                value = (value & 1) ? 0xEDB88320u ^ (value >> 1) : value >> 1;
+            values[i] = value;
+        }
+        return values;
+    }();
+    crc = ~crc;
+    for (size_t i = 0; i < length; i++)
+        crc = table[(crc ^ static_cast<unsigned char>(data[i])) & 0xFF] ^ (crc >> 8);
+    return ~crc;
+}
+
+string EncodeWalHeader(uint32_t magic, uint64_t baseLsn) {
+    // Function: Builds the header of a log or snapshot file.
+    // Post: Function value = WAL_HEADER bytes.
+    string header(WAL_HEADER, '\0');
+    memcpy(&header[0], &magic, sizeof(uint32_t));
+    memcpy(&header[4], &WAL_VERSION, sizeof(uint32_t));
+    memcpy(&header[8], &baseLsn, sizeof(uint64_t));
+    return header;
+}
+
+bool DecodeWalHeader(const string& bytes, uint32_t magic, uint64_t& baseLsn) {
+    // Function: Checks the header of a log or snapshot file.
+    // Post: Returns true and sets baseLsn if bytes start with a header
+    //       carrying magic and the current version.
+    uint32_t fileMagic, version;
+    if (bytes.size() < WAL_HEADER)
+        return false;
+    memcpy(&fileMagic, &bytes[0], sizeof(uint32_t));
+    memcpy(&version, &bytes[4], sizeof(uint32_t));
+    memcpy(&baseLsn, &bytes[8], sizeof(uint64_t));
+    return fileMagic == magic && version == WAL_VERSION;
+}
+
+void AppendWalRecord(string& out, uint64_t lsn, char op, const string& payload) {
+    // Function: Frames a record and appends it to out.
+    // Post: out ends with the record's header and payload.
+    char header[WAL_RECORD_HEADER];
+    uint32_t length = static_cast<uint32_t>(payload.size());
+    memcpy(header, &length, sizeof(uint32_t));
+    memcpy(header + 8, &lsn, sizeof(uint64_t));
+    header[16] = op;
+    uint32_t crc = Crc32(payload.data(), payload.size(), Crc32(header + 8, 9));
+    memcpy(header + 4, &crc, sizeof(uint32_t));
+    out.append(header, WAL_RECORD_HEADER);
+    out += payload;
+}
+
+size_t ParseWalRecords(const string& bytes, size_t offset, vector<WalRecord>& records) {
+    // Function: Decodes the records of a log or snapshot file.
+    // Post: The intact records from offset on are appended to records, up to
+    //       the first short or corrupt one. Function value = the offset just
+    //       past the last intact record.
+    while (bytes.size() - offset >= WAL_RECORD_HEADER) {
+        const char* header = bytes.data() + offset;
+        uint32_t length, crc;
+        memcpy(&length, header, sizeof(uint32_t));
+        memcpy(&crc, header + 4, sizeof(uint32_t));
+        if (bytes.size() - offset - WAL_RECORD_HEADER < length)
+            break;
+        if (Crc32(header + WAL_RECORD_HEADER, length, Crc32(header + 8, 9)) != crc)
+            break;
+
+        WalRecord record;
+        memcpy(&record.lsn, header + 8, sizeof(uint64_t));
+        record.op = header[16];
+        record.payload.assign(header + WAL_RECORD_HEADER, length);
+        records.push_back(record);
+        offset += WAL_RECORD_HEADER + length;
+    }
+    return offset;
+}
+
+bool ReadFileBytes(int fd, size_t offset, size_t length, string& bytes) {
+    // Function: Reads part of an open file.
+    // Post: Returns true and sets bytes if all length bytes were read.
+    bytes.resize(length);
+    size_t done = 0;
+    while (done < length) {
+        ssize_t n = pread(fd, &bytes[done], length - done, static_cast<off_t>(offset + done));
+        if (n <= 0)
+            return false;
+        done += static_cast<size_t>(n);
+    }
+    return true;
+}
+
+bool WriteFileBytes(int fd, const char* data, size_t length) {
+    // Function: Writes a whole buffer to an open file.
+    // Post: Returns true if every byte was written.
+    while (length > 0) {
+        ssize_t n = write(fd, data, length);
+        if (n <= 0)
+            return false;
+        data += n;
+        length -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+bool SyncDirectoryOf(const string& path) {
+    // Function: Makes a rename or file creation in path's directory durable.
+    // Post: Returns true if the directory was synced.
+    size_t slash = path.rfind('/');
+    string directory = slash == string::npos ? "." : (slash == 0 ? "/" : path.substr(0, slash));
+    int fd = open(directory.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+    bool synced = fsync(fd) == 0;
+    close(fd);
+    return synced;
+}
+
+class WriteAheadLog {
+public:
+    // Class constructor
+    WriteAheadLog();
+
+    // Class destructor, makes every appended record durable and closes the log
+    ~WriteAheadLog();
+
+    bool Open(const string& path, vector<WalRecord>& records, uint64_t minLsn = 0);
+    // Function: Opens the log at path, creating it if it does not exist.
+    // Post: Returns true if the log is ready for appends; records holds every
+    //       intact record in LSN order. A torn tail left by a crash is cut off.
+    //       New records get LSNs above minLsn and above every existing one.
+    //       Otherwise, prints an error and returns false.
+
+    void Close();
+    // Function: Makes every appended record durable and closes the log.
+    // Post: The flusher has exited and the log is closed.
+
+    uint64_t Append(char op, const string& payload);
+    // Function: Adds a record to the log.
+    // Pre:  Log is open.
+    // Post: Function value = the record's LSN (0 if the log is closed or a
+    //       write has failed). The record is durable once GetDurableLsn()
+    //       reaches the LSN.
+
+    bool WaitDurable(uint64_t lsn);
+    // Function: Waits until every record up to lsn is on disk.
+    // Post: Returns true once they are; false if the log failed or closed.
+
+    bool Sync();
+    // Function: Waits until every record appended so far is on disk.
+    // Post: Same as WaitDurable(GetLastLsn()).
+
+    bool Compact(uint64_t baseLsn);
+    // Function: Drops the records at or below baseLsn.
+    // Pre:  Every mutation up to baseLsn is saved elsewhere (a snapshot).
+    // Post: Returns true if the log was rewritten with only the later records.
+    //       Appends carry on meanwhile; only the flusher waits while the
+    //       records written since the compaction began are copied.
+
+    void SetGroupWindow(int micros);
+    // Function: Sets how long the flusher lets records gather before a sync.
+    // Post: 0 syncs as soon as the previous sync finishes; a longer window
+    //       trades durability lag for fewer syncs.
+
+    uint64_t GetLastLsn() const;
+    // Function: Gets the LSN of the last appended record.
+
+    uint64_t GetDurableLsn() const;
+    // Function: Gets the LSN up to which every record is on disk.
+
+    size_t GetFileBytes() const;
+    // Function: Gets the size of the log file.
+
+    uint64_t GetNumSyncs() const;
+    // Function: Gets the number of fdatasync calls since the last ResetStats.
+
+    uint64_t GetNumFlushed() const;
+    // Function: Gets the number of records made durable since the last ResetStats.
+
+    double GetMeanLagMicros() const;
+    // Function: Gets the mean time from Append to durable, in microseconds.
+
+    double GetMaxLagMicros() const;
+    // Function: Gets the longest time from Append to durable, in microseconds.
+
+    void ResetStats();
+    // Function: Clears the sync and lag counters.
+
+private:
+    typedef chrono::steady_clock Clock;
+
+    void FlushLoop();
+    // Function: Writes and syncs buffered records until the log closes.
+    // Post: Every record appended before Close is durable (unless a write failed).
+
+    string path;                    // log file path
+    int fd;                         // log file, opened for appending
+    thread flusher;                 // group commit thread
+    atomic<int> groupMicros;        // time records gather before a sync
+
+    mutable mutex logMutex;         // guards the fields below, up to the stats
+    condition_variable workReady;   // signalled when pending has records or on Close
+    condition_variable durable;     // signalled after every sync
+    string pending;                 // framed records not yet written
+    vector<Clock::time_point> appendTimes;  // when each pending record was appended
+    uint64_t lastLsn;               // LSN of the last appended record
+    uint64_t durableLsn;            // LSN up to which the log is on disk
+    bool stopping;                  // Close has been called (or Open has not)
+    bool closed;                    // the flusher has exited
+    bool failed;                    // a write or sync failed; appends are refused
+    uint64_t numSyncs;              // syncs since ResetStats
+    uint64_t numFlushed;            // records made durable since ResetStats
+    double totalLagMicros;          // summed Append-to-durable time
+    double maxLagMicros;            // longest Append-to-durable time
+
+    mutable mutex fileMutex;        // held while the file is written or replaced
+    size_t fileBytes;               // size of the log file
+};
+
+// Class constructor
+WriteAheadLog::WriteAheadLog() : groupMicros(0) {
+    fd = -1;
+    lastLsn = durableLsn = 0;
+    stopping = closed = true;
+    failed = false;
+    fileBytes = 0;
+    ResetStats();
+}
+
+// Class destructor
+WriteAheadLog::~WriteAheadLog() {
+    Close();
+}
+
+bool WriteAheadLog::Open(const string& logPath, vector<WalRecord>& records, uint64_t minLsn) {
+    // Function: Opens the log at path, creating it if it does not exist.
+    // Post: Returns true if the log is ready for appends; records holds every
+    //       intact record in LSN order. A torn tail left by a crash is cut off.
+    //       New records get LSNs above minLsn and above every existing one.
+    //       Otherwise, prints an error and returns false.
+    Close();
+    path = logPath;
+    records.clear();
+
+    // O_APPEND keeps writes at the end of the file even after it is truncated
+    fd = open(path.c_str(), O_RDWR | O_CREAT | O_APPEND, 0644);
+    struct stat info;
+    if (fd < 0 || fstat(fd, &info) != 0) {
+        cerr << "Error: Could not open the log " << path << "!" << endl;
+        Close();
+        return false;
+    }
+
+    uint64_t baseLsn = 0;
+    string bytes;
+    size_t size = static_cast<size_t>(info.st_size);
+    if (size < WAL_HEADER) {
+        string header = EncodeWalHeader(WAL_MAGIC, minLsn);
+        if (ftruncate(fd, 0) != 0 || !WriteFileBytes(fd, header.data(), header.size()) || fdatasync(fd) != 0 ||
+            !SyncDirectoryOf(path)) {
+            cerr << "Error: Could not create the log " << path << "!" << endl;
+            Close();
+            return false;
+        }
+        baseLsn = minLsn;
+        size = WAL_HEADER;
+    }
+    else {
+        if (!ReadFileBytes(fd, 0, size, bytes) || !DecodeWalHeader(bytes, WAL_MAGIC, baseLsn)) {
+            cerr << "Error: " << path << " is not a write-ahead log!" << endl;
+            Close();
+            return false;
+        }
+        size_t valid = ParseWalRecords(bytes, WAL_HEADER, records);
+        if (valid < size) {
+            cerr << "Warning: Dropping " << size - valid << " bytes of torn records at the end of " << path << endl;
+            if (ftruncate(fd, static_cast<off_t>(valid)) != 0 || fdatasync(fd) != 0) {
+                cerr << "Error: Could not truncate the log " << path << "!" << endl;
+                Close();
+                return false;
+            }
+            size = valid;
+        }
+    }
+
+    fileBytes = size;
+    lastLsn = max(minLsn, baseLsn);
+    if (!records.empty())
+        lastLsn = max(lastLsn, records.back().lsn);
+    durableLsn = lastLsn;
+    stopping = closed = failed = false;
+    flusher = thread(&WriteAheadLog::FlushLoop, this);
+    return true;
+}
+
+void WriteAheadLog::Close() {
+    // Function: Makes every appended record durable and closes the log.
+    // Post: The flusher has exited and the log is closed.
+    if (flusher.joinable()) {
+        {
+            lock_guard<mutex> lock(logMutex);
+            stopping = true;
+        }
+        workReady.notify_all();
+        flusher.join();
+    }
+    if (fd >= 0)
+        close(fd);
+    fd = -1;
+    lock_guard<mutex> lock(logMutex);
+    stopping = closed = true;
+    durable.notify_all();
+}
+
+uint64_t WriteAheadLog::Append(char op, const string& payload) {
+    // Function: Adds a record to the log.
+    // Pre:  Log is open.
+    // Post: Function value = the record's LSN (0 if the log is closed or a
+    //       write has failed). The record is durable once GetDurableLsn()
+    //       reaches the LSN.
+    uint64_t lsn;
+    {
+        lock_guard<mutex> lock(logMutex);
+        if (stopping || failed)
+            return 0;
+        lsn = ++lastLsn;
+        AppendWalRecord(pending, lsn, op, payload);
+        appendTimes.push_back(Clock::now());
+    }
+    workReady.notify_one();
+    return lsn;
+}
+
+bool WriteAheadLog::WaitDurable(uint64_t lsn) {
+    // Function: Waits until every record up to lsn is on disk.
+    // Post: Returns true once they are; false if the log failed or closed.
+    unique_lock<mutex> lock(logMutex);
+    durable.wait(lock, [&] { return durableLsn >= lsn || failed || closed; });
+    return durableLsn >= lsn;
+}
+
+bool WriteAheadLog::Sync() {
+    // Function: Waits until every record appended so far is on disk.
+    // Post: Same as WaitDurable(GetLastLsn()).
+    return WaitDurable(GetLastLsn());
+}
+
+void WriteAheadLog::FlushLoop() {
+    // Function: Writes and syncs buffered records until the log closes.
+    // Post: Every record appended before Close is durable (unless a write failed).
+    string batch;
+    vector<Clock::time_point> batchTimes;
+    unique_lock<mutex> lock(logMutex);
+    while (true) {
+        workReady.wait(lock, [this] { return stopping || !pending.empty(); });
+        if (pending.empty())
+            return;  // stopping, and everything is written
+
+        // Let more records join the batch before paying for the sync
+        int window = groupMicros.load(memory_order_relaxed);
+        if (window > 0 && !stopping) {
+            lock.unlock();
+            this_thread::sleep_for(chrono::microseconds(window));
+            lock.lock();
+        }
+        batch.swap(pending);
+        batchTimes.swap(appendTimes);
+        uint64_t batchLsn = lastLsn;
+        lock.unlock();
+
+        bool written;
+        {
+            lock_guard<mutex> file(fileMutex);
+            written = WriteFileBytes(fd, batch.data(), batch.size()) && fdatasync(fd) == 0;
+            if (written)
+                fileBytes += batch.size();
+        }
+        Clock::time_point done = Clock::now();
+
+        lock.lock();
+        if (written) {
+            durableLsn = batchLsn;
+            numSyncs++;
+            numFlushed += batchTimes.size();
+            for (const Clock::time_point& appended : batchTimes) {
+                double lag = chrono::duration<double, micro>(done - appended).count();
+                totalLagMicros += lag;
+                maxLagMicros = max(maxLagMicros, lag);
+            }
+        }
+        else if (!failed) {
+            cerr << "Error: Could not write the log " << path << "; refusing further mutations!" << endl;
+            failed = true;
+        }
+        batch.clear();
+        batchTimes.clear();
+        durable.notify_all();
+    }
+}
+
+bool WriteAheadLog::Compact(uint64_t baseLsn) {
+    // Function: Drops the records at or below baseLsn.
+    // Pre:  Every mutation up to baseLsn is saved elsewhere (a snapshot).
+    // Post: Returns true if the log was rewritten with only the later records.
+    //       Appends carry on meanwhile; only the flusher waits while the
+    //       records written since the compaction began are copied.
+    if (fd < 0)
+        return false;
+
+    // Find the first record to keep without holding up the flusher. The file
+    // only grows at the end, so the prefix read here does not change.
+    size_t scanned;
+    {
+        lock_guard<mutex> file(fileMutex);
+        scanned = fileBytes;
+    }
+    string bytes;
+    vector<WalRecord> records;
+    if (!ReadFileBytes(fd, 0, scanned, bytes))
+        return false;
+    size_t cut = WAL_HEADER;
+    ParseWalRecords(bytes, WAL_HEADER, records);
+    for (const WalRecord& record : records) {
+        if (record.lsn > baseLsn)
+            break;
+        cut += WAL_RECORD_HEADER + record.payload.size();
+    }
+
+    // Copy the kept records into a new file and swap it in
+    lock_guard<mutex> file(fileMutex);
+    string tail;
+    if (!ReadFileBytes(fd, cut, fileBytes - cut, tail))
+        return false;
+    string compactPath = path + ".compact";
+    int compactFd = open(compactPath.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_APPEND, 0644);
+    string header = EncodeWalHeader(WAL_MAGIC, baseLsn);
+    if (compactFd < 0 || !WriteFileBytes(compactFd, header.data(), header.size()) ||
+        !WriteFileBytes(compactFd, tail.data(), tail.size()) || fdatasync(compactFd) != 0 ||
+        rename(compactPath.c_str(), path.c_str()) != 0 || !SyncDirectoryOf(path)) {
+        cerr << "Error: Could not compact the log " << path << "!" << endl;
+        if (compactFd >= 0)
+            close(compactFd);
+        return false;
+    }
+    close(fd);
+    fd = compactFd;
+    fileBytes = header.size() + tail.size();
+    return true;
+}
+
+void WriteAheadLog::SetGroupWindow(int micros) {
+    // Function: Sets how long the flusher lets records gather before a sync.
+    // Post: 0 syncs as soon as the previous sync finishes; a longer window
+    //       trades durability lag for fewer syncs.
+    groupMicros.store(max(0, micros), memory_order_relaxed);
+}
+
+uint64_t WriteAheadLog::GetLastLsn() const {
+    // Function: Gets the LSN of the last appended record.
+    lock_guard<mutex> lock(logMutex);
+    return lastLsn;
+}
+
+uint64_t WriteAheadLog::GetDurableLsn() const {
+    // Function: Gets the LSN up to which every record is on disk.
+    lock_guard<mutex> lock(logMutex);
+    return durableLsn;
+}
+
+size_t WriteAheadLog::GetFileBytes() const {
+    // Function: Gets the size of the log file.
+    lock_guard<mutex> file(fileMutex);
+    return fileBytes;
+}
+
+uint64_t WriteAheadLog::GetNumSyncs() const {
+    // Function: Gets the number of fdatasync calls since the last ResetStats.
+    lock_guard<mutex> lock(logMutex);
+    return numSyncs;
+}
+
+uint64_t WriteAheadLog::GetNumFlushed() const {
+    // Function: Gets the number of records made durable since the last ResetStats.
+    lock_guard<mutex> lock(logMutex);
+    return numFlushed;
+}
+
+double WriteAheadLog::GetMeanLagMicros() const {
+    // Function: Gets the mean time from Append to durable, in microseconds.
+    lock_guard<mutex> lock(logMutex);
+    return numFlushed == 0 ? 0.0 : totalLagMicros / numFlushed;
+}
+
+double WriteAheadLog::GetMaxLagMicros() const {
+    // Function: Gets the longest time from Append to durable, in microseconds.
+    lock_guard<mutex> lock(logMutex);
+    return maxLagMicros;
+}
+
+void WriteAheadLog::ResetStats() {
+    // Function: Clears the sync and lag counters.
+    lock_guard<mutex> lock(logMutex);
+    numSyncs = numFlushed = 0;
+    totalLagMicros = maxLagMicros = 0.0;
+}
+#endif